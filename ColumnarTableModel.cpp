@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ColumnarTableModel.h"
+#include "UpdateQueue.h"
+
+static const double EmptyValue = std::numeric_limits<double>::quiet_NaN();
+
+ColumnarTableModel::ColumnarTableModel(int rows, int columns, QObject *parent)
+    : QAbstractTableModel(parent), m_rows(qMax(rows, 0))
+{
+    m_columns.fill(makeColumn(), qMax(columns, 0));
+}
+
+ColumnarTableModel::Column ColumnarTableModel::makeColumn() const
+{
+    Column column;
+    column.numbers.fill(EmptyValue, m_rows);
+    return column;
+}
+
+int ColumnarTableModel::internText(Column &column, const QString &text) const
+{
+    if (text.isEmpty())
+        return 0;
+    const auto it = column.textIds.constFind(text);
+    if (it != column.textIds.constEnd())
+        return it.value();
+    // 整理后池中的文本不超过行数，下次整理前至少再加入行数个文本，均摊O(1)
+    if (column.texts.size() >= 2 * qMax(m_rows, 32))
+        compactTexts(column);
+    column.texts.append(text);
+    column.textIds.insert(text, column.texts.size());
+    return column.texts.size();
+}
+
+void ColumnarTableModel::compactTexts(Column &column)
+{
+    QVector<int> remap(column.texts.size() + 1, 0);
+    QVector<QString> texts;
+    column.textIds.clear();
+    for (int &label : column.labels)
+    {
+        if (label <= 0)
+            continue;
+        if (remap[label] == 0)
+        {
+            texts.append(column.texts.at(label - 1));
+            remap[label] = texts.size();
+            column.textIds.insert(texts.last(), texts.size());
+        }
+        label = remap[label];
+    }
+    column.texts = texts;
+}
+
+int ColumnarTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows;
+}
+
+int ColumnarTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_columns.size();
+}
+
+QVariant ColumnarTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::EditRole))
+        return QVariant();
+    const Column &column = m_columns.at(index.column());
+    if (!column.labels.isEmpty() && column.labels.at(index.row()) > 0)
+        return column.texts.at(column.labels.at(index.row()) - 1);
+    const double value = column.numbers.at(index.row());
+    return std::isnan(value) ? QVariant() : QVariant(value);
+}
+
+bool ColumnarTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::EditRole))
+        return false;
+    Column &column = m_columns[index.column()];
+    const int row = index.row();
+    if (value.type() == QVariant::String)
+    {
+        if (column.labels.isEmpty())
+            column.labels.fill(0, m_rows);
+        // 先清掉本格的旧文本，整理时不用保留它
+        column.labels[row] = 0;
+        column.labels[row] = internText(column, value.toString());
+        column.numbers[row] = EmptyValue;
+    }
+    else
+    {
+        bool ok = false;
+        const double number = value.toDouble(&ok);
+        column.numbers[row] = ok ? number : EmptyValue;
+        if (!column.labels.isEmpty())
+            column.labels[row] = 0;
+    }
+    emit dataChanged(index, index, { Qt::DisplayRole, Qt::EditRole });
+    return true;
+}
+
+Qt::ItemFlags ColumnarTableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+}
+
+bool ColumnarTableModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || row < 0 || row > m_rows || count <= 0)
+        return false;
+    beginInsertRows(parent, row, row + count - 1);
+    for (Column &column : m_columns)
+    {
+        column.numbers.insert(row, count, EmptyValue);
+        if (!column.labels.isEmpty())
+            column.labels.insert(row, count, 0);
+    }
+    m_rows += count;
+    endInsertRows();
+    return true;
+}
+
+bool ColumnarTableModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || row < 0 || count <= 0 || row + count > m_rows)
+        return false;
+    beginRemoveRows(parent, row, row + count - 1);
+    for (Column &column : m_columns)
+    {
+        column.numbers.remove(row, count);
+        if (!column.labels.isEmpty())
+            column.labels.remove(row, count);
+    }
+    m_rows -= count;
+    endRemoveRows();
+    return true;
+}
+
+bool ColumnarTableModel::insertColumns(int column, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || column < 0 || column > m_columns.size() || count <= 0)
+        return false;
+    beginInsertColumns(parent, column, column + count - 1);
+    m_columns.insert(column, count, makeColumn());
+    endInsertColumns();
+    return true;
+}
+
+bool ColumnarTableModel::removeColumns(int column, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || column < 0 || count <= 0 || column + count > m_columns.size())
+        return false;
+    beginRemoveColumns(parent, column, column + count - 1);
+    m_columns.remove(column, count);
+    endRemoveColumns();
+    return true;
+}
+
+ColumnarTableModel::ColumnSlice ColumnarTableModel::columnSlice(int column, int firstRow, int count) const
+{
+    ColumnSlice slice;
+    if (column < 0 || column >= m_columns.size() || firstRow < 0 || firstRow >= m_rows)
+        return slice;
+    const Column &data = m_columns.at(column);
+    slice.count = qMin(count, m_rows - firstRow);
+    slice.numbers = data.numbers.constData() + firstRow;
+    if (!data.labels.isEmpty())
+    {
+        slice.labels = data.labels.constData() + firstRow;
+        slice.texts = data.texts.constData();
+    }
+    return slice;
+}
+
+void ColumnarTableModel::setColumnValues(int column, int firstRow, const QVector<double> &values)
+{
+    if (column < 0 || column >= m_columns.size() || firstRow < 0 || firstRow >= m_rows || values.isEmpty())
+        return;
+    Column &data = m_columns[column];
+    const int count = qMin(values.size(), m_rows - firstRow);
+    std::copy(values.constBegin(), values.constBegin() + count, data.numbers.begin() + firstRow);
+    if (!data.labels.isEmpty())
+        std::fill(data.labels.begin() + firstRow, data.labels.begin() + firstRow + count, 0);
+    emit dataChanged(index(firstRow, column), index(firstRow + count - 1, column), { Qt::DisplayRole, Qt::EditRole });
+}
+
+void ColumnarTableModel::applyUpdates(const CellUpdate *updates, int count)
+{
+    int top = m_rows, bottom = -1, left = m_columns.size(), right = -1;
+    for (int i = 0; i < count; ++i)
+    {
+        const CellUpdate &update = updates[i];
+        if (update.row < 0 || update.row >= m_rows || update.column < 0 || update.column >= m_columns.size())
+            continue;
+        Column &column = m_columns[update.column];
+        column.numbers[update.row] = update.value;
+        if (!column.labels.isEmpty())
+            column.labels[update.row] = 0;
+        top = qMin(top, int(update.row));
+        bottom = qMax(bottom, int(update.row));
+        left = qMin(left, int(update.column));
+        right = qMax(right, int(update.column));
+    }
+    if (bottom >= 0)
+        emit dataChanged(index(top, left), index(bottom, right), { Qt::DisplayRole, Qt::EditRole });
+}
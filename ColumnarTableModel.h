@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+struct CellUpdate;
+
+// 按列存储的结果表：每列一段连续的double(NaN为空)，需要时再加一段文本id和本列的文本池。
+// 文本池随列删除释放，不用全局的LabelTable(不会释放)；池中不再使用的文本在池超过行数两倍时整理掉。
+// 数值结果网格不为每个单元格分配QStandardItem，按列批量绘制时一次取出一段连续的值
+class ColumnarTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    // 一列中[firstRow, firstRow + count)的值，指针直接指向模型内部，模型修改后失效
+    struct ColumnSlice
+    {
+        const double *numbers = nullptr; // NaN表示没有数值
+        const int *labels = nullptr;     // 文本id，0表示没有文本；整列都没有文本时为空
+        const QString *texts = nullptr;  // 本列的文本池，文本id为n时文本是texts[n - 1]
+        int count = 0;
+    };
+
+    explicit ColumnarTableModel(int rows = 0, int columns = 0, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    // 字符串存为文本，能转换成数值的其他类型存为数值，无效值清空单元格
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    bool insertColumns(int column, int count, const QModelIndex &parent = QModelIndex()) override;
+    bool removeColumns(int column, int count, const QModelIndex &parent = QModelIndex()) override;
+
+    // 超出范围的部分被截掉
+    ColumnSlice columnSlice(int column, int firstRow, int count) const;
+    // 从firstRow开始写一段数值，只发一次dataChanged
+    void setColumnValues(int column, int firstRow, const QVector<double> &values);
+    // 一批单元格更新(UpdateQueue中取出的)，越界的忽略，整批只发一次dataChanged(外接矩形)
+    void applyUpdates(const CellUpdate *updates, int count);
+
+private:
+    struct Column
+    {
+        QVector<double> numbers;
+        QVector<int> labels; // 第一次写入文本时才分配
+        QVector<QString> texts;
+        QHash<QString, int> textIds;
+    };
+
+    Column makeColumn() const;
+    int internText(Column &column, const QString &text) const;
+    // 去掉池中不再被引用的文本，重新编号
+    static void compactTexts(Column &column);
+
+    int m_rows;
+    QVector<Column> m_columns;
+};
@@ -1,48 +1,92 @@
 #include "EwsTableView.h"
+#include "ColumnarTableModel.h"
+#include "HeaderCommands.h"
+#include "StaticTextCache.h"
 
+#include <cmath>
+
+#include <QAction>
+#include <QDataStream>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QVarLengthArray>
+#include <QSettings>
 
 
 
 
 EwsTableView::EwsTableView(QWidget *parent)
-    : QTableView(parent)
+    : QTableView(parent), m_undoStack(new QUndoStack(this)), m_runner(new ExperimentRunner)
+{
+    // 撤销/重做只保存差异，条数有上限，长时间编辑不会无限占用内存
+    m_undoStack->setUndoLimit(undo_limit);
+    QAction *undo = m_undoStack->createUndoAction(this, QStringLiteral("撤销"));
+    undo->setShortcut(QKeySequence::Undo);
+    undo->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    addAction(undo);
+    QAction *redo = m_undoStack->createRedoAction(this, QStringLiteral("重做"));
+    redo->setShortcut(QKeySequence::Redo);
+    redo->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    addAction(redo);
+
+    // 与表头一样每帧(16ms)处理一次
+    m_drainTimer.setInterval(16);
+    connect(&m_drainTimer, &QTimer::timeout, this, &EwsTableView::drain_updates);
+
+    QAction *run = new QAction(QStringLiteral("运行实验"), this);
+    run->setShortcut(QKeySequence(Qt::Key_F5));
+    run->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(run, &QAction::triggered, this, &EwsTableView::run_experiments);
+    addAction(run);
+    QAction *stop = new QAction(QStringLiteral("停止实验"), this);
+    stop->setShortcut(QKeySequence(Qt::SHIFT + Qt::Key_F5));
+    stop->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(stop, &QAction::triggered, this, &EwsTableView::cancel_experiments);
+    addAction(stop);
+
+    connect(m_runner.get(), &ExperimentRunner::runStarted, this, &EwsTableView::on_run_started);
+    connect(m_runner.get(), &ExperimentRunner::runFinished, this, &EwsTableView::on_run_finished);
+    connect(m_runner.get(), &ExperimentRunner::progress, this, &EwsTableView::on_experiment_progress);
+    connect(m_runner.get(), &ExperimentRunner::allFinished, this, &EwsTableView::on_experiments_finished);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &EwsTableView::prioritize_visible_rows);
+}
+
+EwsTableView::~EwsTableView()
 {
+    // 生产者要在表格销毁前停止。先停掉工作线程，结果信号不会再到达，之后再删除实验节点
+    m_runner.reset();
+    qDeleteAll(m_experiments.node_list);
 }
 
 void EwsTableView::init_horizontal_header()
 {
     pHeader = new MultiLevelHeaderView(Qt::Horizontal, header_row_num, header_col_num, this);
+    m_headerTree = new HeaderTree(pHeader, this);
 
-    if (pHeader->tool_list.isEmpty())
+    // 表头树从第0列开始，后面是占位用的空白列
+    for (int i = 0; i < header_row_num; ++i)
+        for (int j = 0; j < header_col_num; ++j)
+        {
+            pHeader->setCellSpan(i, j, 1, 1);
+        }
+    if (tool_list.isEmpty())
     {
-        for (int i = 0; i < header_row_num; ++i)
-            for (int j = 0; j < header_col_num; ++j)
-            {
-                pHeader->setCellSpan(i, j, 1, 1);
-            }
         pHeader->setCellText(0, 0, "No Tools");
     }
     else
     {
-        // 表头内容布局
-        pHeader->setCellSpan(0, 0, 1, 4);
-        pHeader->setCellSpan(0, 4, 1, 4);
-
-        pHeader->setCellSpan(1, 0, 1, 2);
-        pHeader->setCellSpan(1, 2, 1, 2);
-        pHeader->setCellSpan(1, 4, 1, 2);
-        pHeader->setCellSpan(1, 6, 1, 2);
-
-        // 一级
-        pHeader->setCellText(0, 0, "eDevice");
-        pHeader->setCellText(0, 4, "eVisual");
-        // 二级
-        pHeader->setCellText(1, 0, "band");
-        pHeader->setCellText(1, 2, "mobility");
-        pHeader->setCellText(1, 4, "traps");
-        pHeader->setCellText(1, 6, "conc");
+        // 表头内容由工具/参数树推导，例如 eDevice -> band, mobility
+        for (int i = 0; i < tool_list.size(); ++i)
+        {
+            HeaderNode *node = HeaderTree::createToolNode(tool_list[i]);
+            // 子参数层数超过表头级别数的工具不显示
+            if (!m_headerTree->insertSubtree(nullptr, i, node))
+                delete node;
+        }
     }
 
     pHeader->setMinimumHeight(97);
@@ -74,7 +118,7 @@ void EwsTableView::init_horizontal_header()
     for (int i = 0; i < rowCount; i++)
     {
         QList<QStandardItem *> items;
-        for (int j = 0; j < header_col_num; j++)
+        for (int j = 0; j < pHeader->count(); j++)
         {
             items.append(new QStandardItem);
         }
@@ -82,54 +126,68 @@ void EwsTableView::init_horizontal_header()
         m_pDataModel->appendRow(items);
     }
 
-    setModel(m_pDataModel);
+    if (m_profileData)
+    {
+        m_dataProfiler = new RoleProfilingProxyModel(this);
+        m_dataProfiler->setSourceModel(m_pDataModel);
+        setModel(m_dataProfiler);
+    }
+    else
+    {
+        setModel(m_pDataModel);
+    }
     setHorizontalHeader(pHeader);
-    connect(pHeader, SIGNAL(header_add_tool(QString, int)), this, SLOT(add_tool(QString, int)));
+    connect(m_headerTree, &HeaderTree::sectionsInserted, this, &EwsTableView::on_header_sections_inserted);
+    connect(m_headerTree, &HeaderTree::sectionsRemoved, this, &EwsTableView::on_header_sections_removed);
+    connect(pHeader, SIGNAL(header_add_tool(QString, int, QString)), this, SLOT(add_tool(QString, int, QString)));
 
     connect(pHeader, SIGNAL(header_add_param(int, QString, QString, int)), this, SLOT(add_param(int, QString, QString, int)));
+    connect(pHeader, &MultiLevelHeaderView::header_toggle_collapse, this, &EwsTableView::toggle_collapse);
 }
 
-void EwsTableView::init_vertical_header()
-{
-    auto pHeader = new MultiLevelHeaderView(Qt::Vertical, 8, 3, this);
-    pHeader->setCellSpan(0, 0, 4, 1);
-    pHeader->setCellSpan(4, 0, 4, 1);
-    pHeader->setCellSpan(0, 1, 2, 1);
-    pHeader->setCellSpan(2, 1, 2, 1);
-    pHeader->setCellSpan(4, 1, 2, 1);
-    pHeader->setCellSpan(6, 1, 2, 1);
-    for (int i = 0; i < 8; i++)
-    {
-        pHeader->setCellSpan(i, 2, 1, 1);
-    }
-
-    // 一级
-    pHeader->setCellText(0, 0, QString(u8"横\n向\n尺\n寸"));
-    pHeader->setCellText(4, 0, QString(u8"纵\n向\n尺\n寸"));
-    // 二级
-    pHeader->setCellText(0, 1, QStringLiteral("极耳宽度"));
-    pHeader->setCellText(2, 1, QStringLiteral("极耳高度"));
-    pHeader->setCellText(4, 1, QStringLiteral("极片宽度"));
-    pHeader->setCellText(6, 1, QStringLiteral("极耳间距"));
-    // 三级
-    pHeader->setCellText(0, 2, QStringLiteral("CCD测量值"));
-    pHeader->setCellText(1, 2, QStringLiteral("真值"));
-    pHeader->setCellText(2, 2, QStringLiteral("CCD测量值"));
-    pHeader->setCellText(3, 2, QStringLiteral("真值"));
-    pHeader->setCellText(4, 2, QStringLiteral("CCD测量值"));
-    pHeader->setCellText(5, 2, QStringLiteral("真值"));
-    pHeader->setCellText(6, 2, QStringLiteral("CCD测量值"));
-    pHeader->setCellText(7, 2, QStringLiteral("真值"));
+void EwsTableView::init_vertical_header(int group_count)
+{
+    const int group_rows = 8;
+    const int row_num = group_rows * qMax(group_count, 1);
+    auto pHeader = new MultiLevelHeaderView(Qt::Vertical, row_num, 3, this);
+    for (int g = 0; g < row_num; g += group_rows)
+    {
+        pHeader->setCellSpan(g + 0, 0, 4, 1);
+        pHeader->setCellSpan(g + 4, 0, 4, 1);
+        pHeader->setCellSpan(g + 0, 1, 2, 1);
+        pHeader->setCellSpan(g + 2, 1, 2, 1);
+        pHeader->setCellSpan(g + 4, 1, 2, 1);
+        pHeader->setCellSpan(g + 6, 1, 2, 1);
+        for (int i = 0; i < group_rows; i++)
+        {
+            pHeader->setCellSpan(g + i, 2, 1, 1);
+        }
+
+        // 一级
+        pHeader->setCellText(g + 0, 0, QString(u8"横\n向\n尺\n寸"));
+        pHeader->setCellText(g + 4, 0, QString(u8"纵\n向\n尺\n寸"));
+        // 二级
+        pHeader->setCellText(g + 0, 1, QStringLiteral("极耳宽度"));
+        pHeader->setCellText(g + 2, 1, QStringLiteral("极耳高度"));
+        pHeader->setCellText(g + 4, 1, QStringLiteral("极片宽度"));
+        pHeader->setCellText(g + 6, 1, QStringLiteral("极耳间距"));
+        // 三级
+        for (int i = 0; i < group_rows; i += 2)
+        {
+            pHeader->setCellText(g + i, 2, QStringLiteral("CCD测量值"));
+            pHeader->setCellText(g + i + 1, 2, QStringLiteral("真值"));
+        }
+    }
 
     pHeader->setMinimumHeight(90);
     pHeader->setMinimumWidth(30);
     for (int i = 0; i < 3; ++i)
         pHeader->setColumnWidth(i, 30);
-    for (int i = 0; i < 8; ++i)
+    for (int i = 0; i < row_num; ++i)
         pHeader->setRowHeight(i, 30);
     pHeader->setSectionsClickable(false);
 
-    int rowCount = 8;
+    int rowCount = row_num;
     auto m_pDataModel = new QStandardItemModel;
     for (int i = 0; i < rowCount; i++)
     {
@@ -151,61 +209,706 @@ void EwsTableView::init_table_header()
     init_horizontal_header();
 }
 
-void EwsTableView::add_tool(QString tool_name, int pos)
+void EwsTableView::auto_fit_columns(int sample_rows)
+{
+    if (pHeader)
+        pHeader->autoFitSections(model(), sample_rows);
+}
+
+void EwsTableView::set_header_profiling(bool enabled, bool overlay, bool tracing)
+{
+    if (!pHeader)
+        return;
+    pHeader->profiler()->setTracing(tracing);
+    pHeader->setProfilingEnabled(enabled, overlay);
+}
+
+HeaderProfiler *EwsTableView::header_profiler() const
+{
+    return pHeader ? pHeader->profiler() : nullptr;
+}
+
+bool EwsTableView::dump_header_trace(const QString &path) const
+{
+    return pHeader && pHeader->profiler()->writeChromeTrace(path);
+}
+
+void EwsTableView::set_data_profiling(bool enabled)
+{
+    m_profileData = enabled;
+}
+
+RoleProfilingProxyModel *EwsTableView::data_profiler() const
+{
+    return m_dataProfiler;
+}
+
+void EwsTableView::paintEvent(QPaintEvent *event)
+{
+    HeaderProfiler::Scope scope(header_profiler(), HeaderProfiler::TablePaintPhase);
+    RoleProfilingProxyModel::PhaseScope phase(m_dataProfiler, "paint");
+    if (!m_batchedRendering || !paint_batched(event))
+        QTableView::paintEvent(event);
+}
+
+bool EwsTableView::paint_batched(QPaintEvent *event)
+{
+    const ColumnarTableModel *columnar = qobject_cast<const ColumnarTableModel *>(model());
+    if (!columnar || columnar->rowCount() == 0 || columnar->columnCount() == 0)
+        return false;
+
+    const QRect area = event->rect();
+    const QHeaderView *rows = verticalHeader();
+    const QHeaderView *columns = horizontalHeader();
+    int first_row = rows->visualIndexAt(area.top());
+    int last_row = rows->visualIndexAt(area.bottom());
+    int first_col = columns->visualIndexAt(isRightToLeft() ? area.right() : area.left());
+    int last_col = columns->visualIndexAt(isRightToLeft() ? area.left() : area.right());
+    if (first_row < 0 || first_col < 0)
+        return true; // 区域内没有单元格
+    if (last_row < 0)
+        last_row = rows->count() - 1;
+    if (last_col < 0)
+        last_col = columns->count() - 1;
+
+    // 可见行一帧只算一次；行移动过时逻辑行不连续，退回逐格绘制
+    struct RowSpan
+    {
+        int y;
+        int height;
+    };
+    const int row_count = last_row - first_row + 1;
+    const int top_row = rows->logicalIndex(first_row);
+    QVarLengthArray<RowSpan, 128> row_spans(row_count);
+    for (int visual = first_row; visual <= last_row; ++visual)
+    {
+        const int row = rows->logicalIndex(visual);
+        if (row != top_row + visual - first_row)
+            return false;
+        row_spans[visual - first_row] = { rows->sectionViewportPosition(row), rows->sectionSize(row) };
+    }
+
+    QPainter painter(viewport());
+    const QStyleOptionViewItem option = viewOptions();
+    const FastItemDelegate::ColumnStyle default_style;
+    const int rows_top = row_spans[0].y;
+    const int rows_height = row_spans[row_count - 1].y + row_spans[row_count - 1].height - rows_top;
+    if (m_fastDelegate)
+    {
+        for (int visual = first_col; visual <= last_col; ++visual)
+        {
+            const int col = columns->logicalIndex(visual);
+            const QColor background = m_fastDelegate->columnStyle(col).background;
+            if (background.isValid() && !columns->isSectionHidden(col))
+                painter.fillRect(QRect(columns->sectionViewportPosition(col), rows_top, columns->sectionSize(col), rows_height), background);
+        }
+    }
+    // 实验运行状态的底色：ColumnarTableModel没有逐格的BackgroundRole，按行从运行记录中取
+    for (int i = 0; i < row_count && !m_runRows.isEmpty(); ++i)
+    {
+        const auto runs = m_runRows.constFind(top_row + i);
+        if (runs == m_runRows.constEnd() || row_spans[i].height <= 0)
+            continue;
+        for (int id : runs.value())
+        {
+            const ExperimentNode *node = m_experiments.node_list.value(id);
+            const QColor color = node ? run_color(node->status) : QColor();
+            if (!color.isValid())
+                continue;
+            const ExperimentRunner::Run &run = m_runs.at(id);
+            for (int col = run.column; col < run.column + run.columnCount; ++col)
+            {
+                if (!columns->isSectionHidden(col))
+                    painter.fillRect(QRect(columns->sectionViewportPosition(col), row_spans[i].y, columns->sectionSize(col), row_spans[i].height), color);
+            }
+        }
+    }
+    const QItemSelectionModel *selection = selectionModel();
+    const bool has_selection = selection && selection->hasSelection();
+    if (has_selection)
+        painter.fillRegion(visualRegionForSelection(selection->selection()), option.palette.brush(QPalette::Highlight));
+
+    const QColor text_color = option.palette.color(QPalette::Text);
+    const QColor selected_color = option.palette.color(QPalette::HighlightedText);
+    const int margin = 3;
+    QString text;
+    for (int visual = first_col; visual <= last_col; ++visual)
+    {
+        const int col = columns->logicalIndex(visual);
+        const int width = columns->sectionSize(col);
+        if (columns->isSectionHidden(col) || width <= 0)
+            continue;
+        const int x = columns->sectionViewportPosition(col);
+        const FastItemDelegate::ColumnStyle &col_style = m_fastDelegate ? m_fastDelegate->columnStyle(col) : default_style;
+
+        // 整列一次取出，列内只在选中状态变化时换画笔
+        const ColumnarTableModel::ColumnSlice slice = columnar->columnSlice(col, top_row, row_count);
+        const QColor color = col_style.foreground.isValid() ? col_style.foreground : text_color;
+        painter.setPen(color);
+        bool pen_selected = false;
+        for (int i = 0; i < slice.count; ++i)
+        {
+            const RowSpan &span = row_spans[i];
+            if (span.height <= 0)
+                continue;
+            const int label = slice.labels ? slice.labels[i] : 0;
+            const double value = slice.numbers[i];
+            if (label <= 0 && std::isnan(value))
+                continue;
+            if (has_selection)
+            {
+                const bool selected = selection->isSelected(columnar->index(top_row + i, col));
+                if (selected != pen_selected)
+                {
+                    painter.setPen(selected ? selected_color : color);
+                    pen_selected = selected;
+                }
+            }
+            const QRect cell(x + margin, span.y, width - 2 * margin, span.height);
+            if (label > 0)
+            {
+                // 放不下的文本退回省略号
+                const QString &label_text = slice.texts[label - 1];
+                if (!StaticTextCache::instance()->drawCellText(&painter, cell, col_style.alignment, label_text, header_profiler()))
+                    painter.drawText(cell, col_style.alignment, painter.fontMetrics().elidedText(label_text, Qt::ElideRight, cell.width()));
+                continue;
+            }
+            if (col_style.precision >= 0)
+                text.setNum(value, 'f', col_style.precision);
+            else
+                text.setNum(value);
+            painter.drawText(cell, col_style.alignment, text);
+        }
+    }
+
+    if (showGrid())
+    {
+        const int grid_hint = style()->styleHint(QStyle::SH_Table_GridLineColor, &option, this);
+        painter.setPen(QPen(QColor::fromRgba(static_cast<QRgb>(grid_hint)), 0, gridStyle()));
+        const int right = columns->sectionViewportPosition(columns->logicalIndex(last_col)) + columns->sectionSize(columns->logicalIndex(last_col)) - 1;
+        const int bottom = rows_top + rows_height - 1;
+        for (const RowSpan &span : row_spans)
+            painter.drawLine(area.left(), span.y + span.height - 1, qMin(right, area.right()), span.y + span.height - 1);
+        for (int visual = first_col; visual <= last_col; ++visual)
+        {
+            const int col = columns->logicalIndex(visual);
+            if (columns->isSectionHidden(col))
+                continue;
+            const int x = columns->sectionViewportPosition(col) + columns->sectionSize(col) - 1;
+            painter.drawLine(x, area.top(), x, qMin(bottom, area.bottom()));
+        }
+    }
+    return true;
+}
+
+void EwsTableView::set_fast_mode(bool enabled)
+{
+    if (enabled == m_fastMode)
+        return;
+    m_fastMode = enabled;
+    if (enabled)
+    {
+        if (!m_fastDelegate)
+        {
+            m_defaultDelegate = itemDelegate();
+            m_fastDelegate = new FastItemDelegate(this);
+        }
+        m_fastDelegate->setProfiler(header_profiler());
+        setItemDelegate(m_fastDelegate);
+    }
+    else
+    {
+        setItemDelegate(m_defaultDelegate);
+    }
+    viewport()->update();
+}
+
+bool EwsTableView::fast_mode() const
+{
+    return m_fastMode;
+}
+
+FastItemDelegate *EwsTableView::fast_delegate() const
+{
+    return m_fastDelegate;
+}
+
+void EwsTableView::set_batched_rendering(bool enabled)
+{
+    m_batchedRendering = enabled;
+    viewport()->update();
+}
+
+bool EwsTableView::batched_rendering() const
+{
+    return m_batchedRendering;
+}
+
+UpdateQueue *EwsTableView::update_queue() const
+{
+    return m_updateQueue.get();
+}
+
+void EwsTableView::set_update_ingestion(bool enabled)
+{
+    if (enabled)
+    {
+        if (!m_updateQueue)
+            m_updateQueue.reset(new UpdateQueue);
+        m_drainTimer.start();
+    }
+    else
+        m_drainTimer.stop();
+}
+
+void EwsTableView::drain_updates()
+{
+    if (!m_updateQueue)
+        return;
+    if (ColumnarTableModel *columnar = qobject_cast<ColumnarTableModel *>(model()))
+    {
+        m_updateBatch.clear();
+        const int count = m_updateQueue->drain(m_updateBatch, max_updates_per_frame);
+        if (count > 0)
+            columnar->applyUpdates(m_updateBatch.constData(), count);
+        return;
+    }
+    if (!m_pDataModel)
+        return;
+    // QStandardItemModel每个单元格各发一次dataChanged，代价远高于按列写入，
+    // 按时间预算分小批取，剩下的留在队列里等下一帧
+    QElapsedTimer timer;
+    timer.start();
+    do
+    {
+        m_updateBatch.clear();
+        if (m_updateQueue->drain(m_updateBatch, max_item_updates_per_batch) == 0)
+            return;
+        for (const CellUpdate &update : m_updateBatch)
+        {
+            QModelIndex index = m_pDataModel->index(update.row, update.column);
+            if (index.isValid())
+                m_pDataModel->setData(index, update.value, Qt::EditRole);
+        }
+    } while (!timer.hasExpired(item_update_budget_ms));
+}
+
+ExperimentRunner *EwsTableView::experiment_runner() const
+{
+    return m_runner.get();
+}
+
+const ExperimentTree &EwsTableView::experiments() const
+{
+    return m_experiments;
+}
+
+static void collect_leaves(HeaderNode *node, QList<HeaderNode *> &leaves)
+{
+    if (node->children.isEmpty())
+        leaves.append(node);
+    for (HeaderNode *child : node->children)
+        collect_leaves(child, leaves);
+}
+
+void EwsTableView::run_experiments()
+{
+    if (!m_pDataModel || !m_headerTree)
+        return;
+    // 上一次的状态和结果清掉
+    m_runner->cancel();
+    for (const ExperimentRunner::Run &run : m_runs)
+        mark_run(run, QColor(), QString());
+    qDeleteAll(m_experiments.node_list);
+    m_experiments.node_list.clear();
+    m_runs.clear();
+    m_runRows.clear();
+
+    HeaderNode *root = m_headerTree->root();
+    for (int i = 0; i < tool_list.size() && i < root->children.size(); ++i)
+    {
+        if (tool_list[i]->binary.isEmpty())
+            continue;
+        HeaderNode *tool = root->children[i];
+        const int first = m_headerTree->firstSection(tool);
+        QList<HeaderNode *> leaves;
+        collect_leaves(tool, leaves);
+        // 第0行是表头取值，扫描从第1行开始
+        for (int row = 1; row < m_pDataModel->rowCount(); ++row)
+        {
+            QStringList arguments;
+            QStringList pairs;
+            for (int j = 0; j < leaves.size(); ++j)
+            {
+                const QString value = m_pDataModel->index(row, first + j).data().toString().trimmed();
+                if (value.isEmpty())
+                    continue;
+                // 没有参数的工具，单元格的值直接作为参数
+                const QString argument = (leaves[j] == tool) ? value : leaves[j]->text + QLatin1Char('=') + value;
+                arguments.append(argument);
+                pairs.append(argument);
+            }
+            if (arguments.isEmpty())
+                continue;
+
+            ExperimentRunner::Run run;
+            run.id = m_runs.size();
+            run.row = row;
+            run.column = first;
+            run.columnCount = tool->leafCount;
+            run.binary = tool_list[i]->binary;
+            run.arguments = arguments;
+            m_runs.append(run);
+            m_runRows[row].append(run.id);
+
+            ExperimentNode *node = new ExperimentNode;
+            node->id = run.id;
+            node->param_key = tool->text;
+            node->param_value = pairs.join(QLatin1Char(' '));
+            node->status = QStringLiteral("queued");
+            node->row = row;
+            m_experiments.node_list.append(node);
+        }
+    }
+    qInfo() << "EwsTableView run_experiments" << m_runs.size() << "runs," << m_runner->maxConcurrency() << "workers";
+
+    m_progressText.clear();
+    int first = 0;
+    int last = -1;
+    visible_rows(first, last);
+    m_runner->start(m_runs, first, last);
+}
+
+void EwsTableView::cancel_experiments()
+{
+    m_runner->cancel();
+}
+
+void EwsTableView::visible_rows(int &first, int &last) const
+{
+    first = qMax(0, rowAt(0));
+    last = rowAt(viewport()->height() - 1);
+    if (last < 0)
+        last = model() ? model()->rowCount() - 1 : -1;
+}
+
+void EwsTableView::prioritize_visible_rows()
+{
+    if (!m_runner->isRunning())
+        return;
+    int first = 0;
+    int last = -1;
+    visible_rows(first, last);
+    m_runner->prioritize(first, last);
+}
+
+void EwsTableView::mark_run(const ExperimentRunner::Run &run, const QColor &color, const QString &tip)
+{
+    if (!m_pDataModel)
+        return;
+    for (int col = run.column; col < run.column + run.columnCount; ++col)
+    {
+        QModelIndex index = m_pDataModel->index(run.row, col);
+        m_pDataModel->setData(index, color.isValid() ? QVariant(color) : QVariant(), Qt::BackgroundRole);
+        m_pDataModel->setData(index, tip.isEmpty() ? QVariant() : QVariant(tip), Qt::ToolTipRole);
+    }
+}
+
+void EwsTableView::on_run_started(int id)
+{
+    ExperimentNode *node = m_experiments.node_list.value(id);
+    if (!node)
+        return;
+    node->status = QStringLiteral("running");
+    mark_run(m_runs[id], run_color(node->status), QStringLiteral("running: %1").arg(node->param_value));
+}
+
+void EwsTableView::on_run_finished(int id, int exit_code, qint64 elapsed_ms, QString output)
+{
+    ExperimentNode *node = m_experiments.node_list.value(id);
+    if (!node)
+        return;
+    node->status = exit_code == 0 ? QStringLiteral("done") : QStringLiteral("failed");
+    node->result = output;
+    node->elapsed_ms = elapsed_ms;
+    const QString tip = QStringLiteral("%1: %2\nexit %3, %4 ms\n%5").arg(node->status, node->param_value).arg(exit_code).arg(elapsed_ms).arg(output);
+    mark_run(m_runs[id], run_color(node->status), tip);
+}
+
+QColor EwsTableView::run_color(const QString &status)
 {
-    // fix to do 刷新数据模型
-    ToolNode *tool_node = new ToolNode(tool_name, pos);
-    tool_list.insert(tool_node->pos, tool_node);
-    tool_node->params_list.append("#");
-    // fix to do根据tool_list数据模型刷新UI
-    pHeader->setCellText(0, tool_node->pos, tool_node->name);
+    if (status == QLatin1String("running"))
+        return QColor(0xfff3c4);
+    if (status == QLatin1String("done"))
+        return QColor(0xd4f0d4);
+    if (status == QLatin1String("failed"))
+        return QColor(0xf6d0d0);
+    return QColor();
+}
 
-    QModelIndex index = m_pDataModel->index(0, 0);
-    m_pDataModel->item(0, 0)->setTextAlignment(Qt::AlignCenter);
-    m_pDataModel->setData(index, "--", Qt::EditRole);
-    // 获取单元格内容
-    QString data = m_pDataModel->data(index).toString();
+void EwsTableView::shift_run_columns(int first, int delta)
+{
+    for (ExperimentRunner::Run &run : m_runs)
+    {
+        if (delta > 0)
+        {
+            if (first <= run.column)
+                run.column += delta;
+            else if (first < run.column + run.columnCount)
+                run.columnCount += delta; // 插在工具中间(添加参数)
+            continue;
+        }
+        // 删除[first, last)：工具前面删掉的列左移，工具内删掉的列从范围中去掉
+        const int last = first - delta;
+        const int before = qBound(0, qMin(run.column, last) - first, -delta);
+        const int inside = qMax(0, qMin(run.column + run.columnCount, last) - qMax(run.column, first));
+        run.column -= before;
+        run.columnCount -= inside;
+    }
+}
+
+void EwsTableView::on_experiment_progress(int finished, int total, double runs_per_second, double average_latency_ms)
+{
+    m_progressText = QStringLiteral("%1/%2 runs, %3 runs/s, %4 ms avg")
+                         .arg(finished)
+                         .arg(total)
+                         .arg(runs_per_second, 0, 'f', 1)
+                         .arg(average_latency_ms, 0, 'f', 0);
+    emit experiment_status(m_progressText);
+}
+
+void EwsTableView::on_experiments_finished()
+{
+    emit experiment_status(m_progressText.isEmpty() ? QStringLiteral("no runs") : QStringLiteral("finished: %1").arg(m_progressText));
+}
+
+QUndoStack *EwsTableView::undo_stack() const
+{
+    return m_undoStack;
+}
+
+QByteArray EwsTableView::save_header_state() const
+{
+    if (!pHeader)
+        return QByteArray();
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << pHeader->saveHeaderState() << m_headerTree->collapsedPaths();
+    return state;
+}
+
+bool EwsTableView::restore_header_state(const QByteArray &state)
+{
+    if (!pHeader)
+        return false;
+    QByteArray header_state;
+    QVector<QVector<int>> collapsed;
+    QDataStream in(state);
+    in.setVersion(QDataStream::Qt_5_0);
+    in >> header_state >> collapsed;
+    // 树的形状对不上时什么都不改
+    if (in.status() != QDataStream::Ok || !m_headerTree->canRestoreCollapsed(collapsed))
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!pHeader->restoreHeaderState(header_state))
+        return false;
+    m_headerTree->restoreCollapsed(collapsed);
+    qInfo() << "EwsTableView restore_header_state" << pHeader->count() << "columns in" << timer.elapsed() << "ms";
+    return true;
+}
+
+void EwsTableView::save_header_settings(const QString &key) const
+{
+    QSettings settings;
+    settings.setValue(key.isEmpty() ? QStringLiteral("header_state") : key, save_header_state());
+}
+
+bool EwsTableView::restore_header_settings(const QString &key)
+{
+    QSettings settings;
+    QByteArray state = settings.value(key.isEmpty() ? QStringLiteral("header_state") : key).toByteArray();
+    return !state.isEmpty() && restore_header_state(state);
+}
+
+void EwsTableView::add_tool(QString tool_name, int pos, QString binary)
+{
+    pos = qBound(0, pos, tool_list.size());
+    HeaderInsertCommand::Entry entry;
+    entry.pos = pos;
+    entry.tool = new ToolNode(tool_name, pos);
+    entry.tool->binary = binary;
+    entry.node = HeaderTree::createToolNode(entry.tool);
+    if (!m_headerTree->canInsert(nullptr, entry.node))
+    {
+        qInfo() << "EwsTableView add_tool" << tool_name << "is deeper than the header's" << pHeader->levelCount() << "levels";
+        delete entry.node;
+        delete entry.tool;
+        return;
+    }
+    // 表头由工具树推导，只插入新工具占用的列
+    m_undoStack->push(new HeaderInsertCommand(this, QVector<int>(), {entry}, QStringLiteral("添加工具 %1").arg(tool_name)));
     qInfo() << "EwsTableView add_tool done";
 }
 
 void EwsTableView::add_param(int tool_col, QString param_key, QString value_list, int param_pos)
 {
-    // fix to do 刷新数据模型
-    // ToolNode *tool_node = new ToolNode(tool_name, pos);
-    // tool_list.insert(tool_node->pos, tool_node);
-
-    // fix to do根据tool_list数据模型刷新UI
-    // pHeader->setCellText(0, tool_node->pos, tool_node->name);
-    int insert_pos = 0;
-    //for (int i = 0; i < ptool_node->pos; i++)
-    //{
-    //    insert_pos+= tool_list[i]->params_list.length();
-    // }
-    pHeader->setCellText(1, insert_pos + param_pos, param_key);
-    tool_list[0]->params_list.append(param_key);
     // 通过tool_col 计算给哪个点工具添加参数
-    int start_pos = 0;
-    ToolNode* ptool_node = nullptr;
-    for(auto ptool:tool_list)
+    HeaderNode *tool = m_headerTree->nodeAt(0, tool_col);
+    if (!tool)
+    {
+        qInfo() << "EwsTableView add_param no tool at column" << tool_col;
+        return;
+    }
+    HeaderInsertCommand::Entry entry;
+    entry.pos = qBound(0, param_pos, tool->children.size());
+    entry.node = new HeaderNode(param_key);
+    entry.key = param_key;
+    entry.value = value_list;
+    if (!m_headerTree->canInsert(tool, entry.node))
     {
-        start_pos += ptool->params_list.length();
-        if (start_pos >= tool_col)
+        qInfo() << "EwsTableView add_param" << param_key << "is deeper than the header's" << pHeader->levelCount() << "levels";
+        delete entry.node;
+        return;
+    }
+    m_undoStack->push(new HeaderInsertCommand(this, m_headerTree->pathOf(tool), {entry}, QStringLiteral("添加参数 %1").arg(param_key)));
+    qInfo() << "EwsTableView add_param done";
+}
+
+void EwsTableView::rename_node(int level, int col, const QString &text)
+{
+    HeaderNode *node = m_headerTree->nodeAt(level, col);
+    if (!node || node->text == text)
+        return;
+    m_undoStack->push(new HeaderRenameCommand(this, m_headerTree->pathOf(node), text));
+}
+
+void EwsTableView::toggle_collapse(int level, int col)
+{
+    HeaderNode *node = m_headerTree ? m_headerTree->nodeAt(level, col) : nullptr;
+    // 叶子参数没有可折叠的内容，折叠它所在的组
+    if (node && node->children.isEmpty())
+        node = node->parent;
+    if (!node || node == m_headerTree->root())
+        return;
+    m_headerTree->setCollapsed(node, !node->collapsed);
+}
+
+qint64 EwsTableView::add_tools(const QVector<ToolSpec> &tools, int pos)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (tools.isEmpty())
+        return 0;
+    if (pos < 0 || pos > tool_list.size())
+        pos = tool_list.size();
+
+    int param_count = 0;
+    QVector<HeaderInsertCommand::Entry> entries;
+    entries.reserve(tools.size());
+    for (int i = 0; i < tools.size(); ++i)
+    {
+        ToolNode *tool_node = new ToolNode(tools[i].name, pos + i);
+        tool_node->binary = tools[i].binary;
+        for (const ParamSpec &param : tools[i].params)
         {
-            ptool_node = ptool;
-            break;
+            tool_node->params_list.append(param.key);
+            tool_node->params_dict.insert(param.key, param.value);
         }
+        param_count += tools[i].params.size();
+
+        HeaderInsertCommand::Entry entry;
+        entry.pos = pos + i;
+        entry.tool = tool_node;
+        entry.node = HeaderTree::createToolNode(tool_node);
+        entries.append(entry);
     }
-    for (int i = 0; i < ptool_node->pos; i++)
+    // 有一个工具的子参数层数超过表头级别数，整批都不添加
+    for (const HeaderInsertCommand::Entry &entry : entries)
     {
-        insert_pos+= tool_list[i]->params_list.length();
+        if (m_headerTree->canInsert(nullptr, entry.node))
+            continue;
+        qInfo() << "EwsTableView add_tools" << entry.tool->name << "is deeper than the header's" << pHeader->levelCount() << "levels";
+        for (const HeaderInsertCommand::Entry &drop : entries)
+        {
+            delete drop.node;
+            delete drop.tool;
+        }
+        return timer.elapsed();
     }
-    QModelIndex index = m_pDataModel->index(0, insert_pos + param_pos);
-    m_pDataModel->item(0, insert_pos + param_pos)->setTextAlignment(Qt::AlignCenter);
-    m_pDataModel->setData(index, value_list, Qt::EditRole);
-    pHeader->setCellSpan(0, 0, 1, tool_list[0]->params_list.length());
-    // 获取单元格内容
-    QString data = m_pDataModel->data(index).toString();
-    qInfo() << "EwsTableView add_param done";
+    // 整批是一条命令，一次撤销
+    m_undoStack->push(new HeaderInsertCommand(this, QVector<int>(), entries, QStringLiteral("添加%1个工具").arg(tools.size())));
+
+    qint64 elapsed = timer.elapsed();
+    qInfo() << "EwsTableView add_tools" << tools.size() << "tools," << param_count << "params in" << elapsed << "ms";
+    return elapsed;
+}
+
+qint64 EwsTableView::add_params(int tool_col, const QVector<ParamSpec> &params, int param_pos)
+{
+    QElapsedTimer timer;
+    timer.start();
+    HeaderNode *tool = m_headerTree->nodeAt(0, tool_col);
+    if (!tool)
+    {
+        qInfo() << "EwsTableView add_params no tool at column" << tool_col;
+        return 0;
+    }
+    if (params.isEmpty())
+        return 0;
+    if (param_pos < 0 || param_pos > tool->children.size())
+        param_pos = tool->children.size();
+
+    QVector<HeaderInsertCommand::Entry> entries;
+    entries.reserve(params.size());
+    for (int i = 0; i < params.size(); ++i)
+    {
+        HeaderInsertCommand::Entry entry;
+        entry.pos = param_pos + i;
+        entry.node = new HeaderNode(params[i].key);
+        entry.key = params[i].key;
+        entry.value = params[i].value;
+        entries.append(entry);
+    }
+    if (!m_headerTree->canInsert(tool, entries.first().node))
+    {
+        qInfo() << "EwsTableView add_params" << params.size() << "params are deeper than the header's" << pHeader->levelCount() << "levels";
+        for (const HeaderInsertCommand::Entry &drop : entries)
+            delete drop.node;
+        return timer.elapsed();
+    }
+    m_undoStack->push(new HeaderInsertCommand(this, m_headerTree->pathOf(tool), entries, QStringLiteral("添加%1个参数").arg(params.size())));
+
+    qint64 elapsed = timer.elapsed();
+    qInfo() << "EwsTableView add_params" << params.size() << "params in" << elapsed << "ms";
+    return elapsed;
+}
+
+void EwsTableView::set_header_value(int col, const QString &value)
+{
+    QModelIndex index = m_pDataModel->index(0, col);
+    // 快速模式下对齐由列样式决定(默认居中)
+    if (!m_fastMode)
+        m_pDataModel->setData(index, int(Qt::AlignCenter), Qt::TextAlignmentRole);
+    m_pDataModel->setData(index, value, Qt::EditRole);
+}
+
+void EwsTableView::on_header_sections_inserted(int first, int count)
+{
+    shift_run_columns(first, count);
+    m_pDataModel->insertColumns(first, count);
+    if (m_fastDelegate)
+        m_fastDelegate->insertColumns(first, count);
+}
+
+void EwsTableView::on_header_sections_removed(int first, int count)
+{
+    shift_run_columns(first, -count);
+    m_pDataModel->removeColumns(first, count);
+    if (m_fastDelegate)
+        m_fastDelegate->removeColumns(first, count);
 }
 
 // void EwsTableView::on_clicked(const QModelIndex& idx)
@@ -1,35 +1,151 @@
 #ifndef EWSTABLEVIEW_H
 #define EWSTABLEVIEW_H
 
+#include "ExperimentRunner.h"
+#include "FastItemDelegate.h"
+#include "HeaderTree.h"
 #include "MultiLevelHeaderView.h"
+#include "RoleProfilingProxyModel.h"
+#include "UpdateQueue.h"
 #include "data_model.h"
 
 #include <QStandardItemModel>
 #include <QTableView>
+#include <QTimer>
 #include <QMenu>
+#include <QUndoStack>
+
+#include <memory>
 
 class EwsTableView : public QTableView
 {
     Q_OBJECT
+    friend class HeaderInsertCommand;
+    friend class HeaderRenameCommand;
 public:
     EwsTableView(QWidget *parent = nullptr);
+    ~EwsTableView() override;
 
 
     void init_table_header();
 
     void popup_tool_menu(const QPoint &pos);
 
+    // 根据表头和单元格内容自动调整列宽，sample_rows > 0 时只抽样部分行
+    void auto_fit_columns(int sample_rows = 0);
+
+    // 水平表头的性能统计，表格视口的绘制时间也计入其中(TablePaintPhase)
+    void set_header_profiling(bool enabled, bool overlay = false, bool tracing = false);
+    HeaderProfiler *header_profiler() const;
+    // 导出Chrome trace-event JSON，需要先打开tracing
+    bool dump_header_trace(const QString &path) const;
+    // 在表格数据模型外包一层data()统计代理，需要在init_table_header之前调用
+    void set_data_profiling(bool enabled);
+    RoleProfilingProxyModel *data_profiler() const;
+
+    // 表头结构编辑(添加工具/参数、重命名)的撤销栈，Ctrl+Z/Ctrl+Y撤销/重做，最多保留undo_limit条
+    QUndoStack *undo_stack() const;
+    static const int undo_limit = 100;
+
+    // 水平表头的布局(列宽、行高、合并单元格、折叠、排序)，表头结构与保存时相同才能恢复
+    QByteArray save_header_state() const;
+    bool restore_header_state(const QByteArray &state);
+    // 通过QSettings持久化，key为空时使用"header_state"
+    void save_header_settings(const QString &key = QString()) const;
+    bool restore_header_settings(const QString &key = QString());
+
+    // 快速模式：数据单元格由FastItemDelegate绘制，每格只取DisplayRole和BackgroundRole，对齐和颜色按列设置
+    // (fast_delegate()->setColumnStyle)，不再给每个单元格写TextAlignmentRole
+    void set_fast_mode(bool enabled);
+    bool fast_mode() const;
+    FastItemDelegate *fast_delegate() const;
+
+    // 按列批量绘制：模型是ColumnarTableModel时，视口按可见列一次取出一段连续的值，
+    // 同一列用同一套画笔/字体画完，不经过委托；其他模型仍按单元格绘制。
+    // 列样式与快速模式共用fast_delegate()的设置
+    void set_batched_rendering(bool enabled);
+    bool batched_rendering() const;
+
+    // 工作线程提交结果的通道：任意线程update_queue()->push(row, col, value)，
+    // 打开后GUI线程每帧取出一次批量写入模型。队列满时push返回false(背压)，见update_queue()->stats()。
+    // 队列(约1MB)在第一次set_update_ingestion(true)时创建，之前返回nullptr；关闭后队列保留
+    UpdateQueue *update_queue() const;
+    void set_update_ingestion(bool enabled);
+    // 每帧最多应用的更新数，超出的留到下一帧，避免一帧卡太久。
+    // ColumnarTableModel整批写入；其他模型逐个单元格setData，每个都发dataChanged，
+    // 每次取一小批，用完每帧的时间预算就停
+    static const int max_updates_per_frame = 1 << 18;
+    static const int max_item_updates_per_batch = 512;
+    static const int item_update_budget_ms = 4;
+
+    // 运行实验：第1行起每一行是参数扫描的一组取值，对每个设置了程序(Binary)的工具，
+    // 把该行中它的参数单元格作为key=value参数启动一次程序，空行跳过。
+    // 并发数等设置见experiment_runner()，当前可见的行先运行。
+    // 状态用单元格底色表示，提示里有退出码、耗时和输出，吞吐量和平均耗时通过experiment_status给出
+    ExperimentRunner *experiment_runner() const;
+    const ExperimentTree &experiments() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    // 按列批量绘制视口，返回false时由QTableView绘制
+    bool paint_batched(QPaintEvent *event);
+
+signals:
+    // 实验进度的一行摘要(完成数/总数、吞吐量、平均耗时)，由宿主显示在状态栏等处；结束或停止时再发一次
+    void experiment_status(const QString &text);
+
 public slots:
 
-    void add_tool(QString tool_name, int pos);
+    void add_tool(QString tool_name, int pos, QString binary = QString());
 
     void add_param(int tool_col, QString param_key, QString value_list, int param_pos);
+
+    // 修改level级、col列所在的工具或参数的名字
+    void rename_node(int level, int col, const QString &text);
+    // 折叠/展开level级、col列所在的工具或参数(表头右键菜单)，折叠后只显示第一列
+    void toggle_collapse(int level, int col);
+
+    // F5运行、Shift+F5停止
+    void run_experiments();
+    void cancel_experiments();
+
+public:
+    // 一次添加一批工具及其参数(如加载配方)：表头树批量插入，每段连续的新列只插入一次，
+    // 合并单元格一次性推导。pos < 0 时追加到最后，返回耗时(毫秒)。
+    // 表头的级别数(header_row_num)是固定的，子参数层数超出时整批不添加
+    qint64 add_tools(const QVector<ToolSpec> &tools, int pos = -1);
+    // 给tool_col所在的工具一次添加一批参数，param_pos < 0 时追加到最后
+    qint64 add_params(int tool_col, const QVector<ParamSpec> &params, int param_pos = -1);
+
+private slots:
+    // 表头树插入/删除了section，同步数据模型的列
+    void on_header_sections_inserted(int first, int count);
+    void on_header_sections_removed(int first, int count);
+    // 取出本帧的所有更新并写入模型
+    void drain_updates();
+    void on_run_started(int id);
+    void on_run_finished(int id, int exit_code, qint64 elapsed_ms, QString output);
+    void on_experiment_progress(int finished, int total, double runs_per_second, double average_latency_ms);
+    void on_experiments_finished();
+    // 滚动后让可见行的实验先运行
+    void prioritize_visible_rows();
+
 private:
 
     int header_row_num = 2;
     int header_col_num = 8;
     void init_horizontal_header();
-    void init_vertical_header();
+    // 竖直多级表头，每组8行（两个尺寸方向 × 两个尺寸 × CCD测量值/真值）
+    void init_vertical_header(int group_count = 1);
+    // 表格第0行对应列显示工具/参数的值
+    void set_header_value(int col, const QString &value);
+    void visible_rows(int &first, int &last) const;
+    // 给一次运行所在行的工具单元格设置底色和提示
+    void mark_run(const ExperimentRunner::Run &run, const QColor &color, const QString &tip);
+    // 运行状态(queued/running/done/failed)对应的底色，queued没有底色
+    static QColor run_color(const QString &status);
+    // 表头插入(delta > 0)或删除(delta < 0)了从first开始的|delta|个section，运行记录的列跟着移动
+    void shift_run_columns(int first, int delta);
 
     QList<ToolNode*> tool_list;
 
@@ -38,7 +154,23 @@ private:
     QMenu _param_menu;
 
     MultiLevelHeaderView *pHeader = nullptr;
-    QStandardItemModel* m_pDataModel;
+    HeaderTree *m_headerTree = nullptr;
+    QStandardItemModel* m_pDataModel = nullptr;
+    bool m_profileData = false;
+    RoleProfilingProxyModel *m_dataProfiler = nullptr;
+    QUndoStack *m_undoStack;
+    bool m_fastMode = false;
+    FastItemDelegate *m_fastDelegate = nullptr;
+    QAbstractItemDelegate *m_defaultDelegate = nullptr;
+    bool m_batchedRendering = false;
+    std::unique_ptr<UpdateQueue> m_updateQueue;
+    QTimer m_drainTimer;
+    QVector<CellUpdate> m_updateBatch; // 复用，避免每帧分配
+    std::unique_ptr<ExperimentRunner> m_runner;
+    ExperimentTree m_experiments;
+    QVector<ExperimentRunner::Run> m_runs; // 下标即ExperimentNode::id
+    QHash<int, QVector<int>> m_runRows;    // 表格行 -> 这一行的运行(m_runs下标)，按列批量绘制时画状态底色
+    QString m_progressText;
 };
 
 #endif // EWSTABLEVIEW_H
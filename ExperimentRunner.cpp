@@ -0,0 +1,272 @@
+#include <QMutex>
+#include <QProcess>
+#include <QRunnable>
+#include <QThread>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "ExperimentRunner.h"
+
+// 一次start的全部任务，工作线程和ExperimentRunner共同持有
+struct ExperimentScheduler
+{
+    struct Queue
+    {
+        QMutex mutex;
+        std::deque<ExperimentRunner::Run> runs;
+    };
+
+    explicit ExperimentScheduler(int workers) : queues(workers)
+    {
+        for (auto &queue : queues)
+            queue.reset(new Queue);
+    }
+
+    // 优先队列 -> 自己的队列尾部 -> 其他线程队列头部
+    bool take(int worker, ExperimentRunner::Run &run)
+    {
+        if (cancelled.load())
+            return false;
+        {
+            QMutexLocker locker(&priority.mutex);
+            if (!priority.runs.empty())
+            {
+                run = priority.runs.front();
+                priority.runs.pop_front();
+                ++taken;
+                return true;
+            }
+        }
+        const int count = int(queues.size());
+        for (int i = 0; i < count; ++i)
+        {
+            Queue &queue = *queues[(worker + i) % count];
+            QMutexLocker locker(&queue.mutex);
+            if (queue.runs.empty())
+                continue;
+            if (i == 0)
+            {
+                run = queue.runs.back();
+                queue.runs.pop_back();
+            }
+            else
+            {
+                run = queue.runs.front();
+                queue.runs.pop_front();
+            }
+            ++taken;
+            return true;
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        cancelled.store(true);
+        QMutexLocker locker(&priority.mutex);
+        priority.runs.clear();
+        locker.unlock();
+        for (auto &queue : queues)
+        {
+            QMutexLocker queueLocker(&queue->mutex);
+            queue->runs.clear();
+        }
+    }
+
+    Queue priority;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<bool> cancelled { false };
+    // 已被取走的任务数，在队列锁内增加，clear()之后就是最终会报告结果的任务数
+    std::atomic<int> taken { 0 };
+};
+
+namespace
+{
+class ExperimentWorker : public QRunnable
+{
+public:
+    ExperimentWorker(ExperimentRunner *runner, std::shared_ptr<ExperimentScheduler> scheduler, int generation, int index, int timeout)
+        : m_runner(runner), m_scheduler(scheduler), m_generation(generation), m_index(index), m_timeout(timeout)
+    {
+    }
+
+    void run() override
+    {
+        ExperimentRunner::Run task;
+        while (m_scheduler->take(m_index, task))
+        {
+            QMetaObject::invokeMethod(m_runner, "onWorkerStarted", Qt::QueuedConnection, Q_ARG(int, m_generation), Q_ARG(int, task.id));
+            QElapsedTimer timer;
+            timer.start();
+            QString output;
+            const int exitCode = execute(task, output);
+            QMetaObject::invokeMethod(m_runner, "onWorkerFinished", Qt::QueuedConnection, Q_ARG(int, m_generation), Q_ARG(int, task.id), Q_ARG(int, exitCode), Q_ARG(qint64, timer.elapsed()), Q_ARG(QString, output));
+        }
+    }
+
+private:
+    int execute(const ExperimentRunner::Run &task, QString &output)
+    {
+        QProcess process;
+        process.setProcessChannelMode(QProcess::MergedChannels);
+        process.start(task.binary, task.arguments, QIODevice::ReadOnly);
+        if (!process.waitForStarted())
+        {
+            output = process.errorString();
+            return -1;
+        }
+        // 分段等待，取消时能及时杀掉进程
+        QElapsedTimer timer;
+        timer.start();
+        while (!process.waitForFinished(100))
+        {
+            if (process.state() == QProcess::NotRunning)
+                break;
+            if (m_scheduler->cancelled.load() || timer.elapsed() > m_timeout)
+            {
+                process.kill();
+                process.waitForFinished();
+                output = m_scheduler->cancelled.load() ? QStringLiteral("cancelled") : QStringLiteral("timeout");
+                return -1;
+            }
+        }
+        const QList<QByteArray> lines = process.readAll().trimmed().split('\n');
+        output = QString::fromLocal8Bit(lines.last().trimmed());
+        return process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+    }
+
+    ExperimentRunner *m_runner;
+    std::shared_ptr<ExperimentScheduler> m_scheduler;
+    int m_generation;
+    int m_index;
+    int m_timeout;
+};
+}
+
+ExperimentRunner::ExperimentRunner(QObject *parent) : QObject(parent), m_concurrency(QThread::idealThreadCount())
+{
+}
+
+ExperimentRunner::~ExperimentRunner()
+{
+    if (m_scheduler)
+        m_scheduler->clear();
+    m_pool.waitForDone();
+}
+
+void ExperimentRunner::setMaxConcurrency(int count)
+{
+    m_concurrency = qMax(1, count);
+}
+
+int ExperimentRunner::maxConcurrency() const
+{
+    return m_concurrency;
+}
+
+void ExperimentRunner::setTimeout(int msecs)
+{
+    m_timeout = msecs;
+}
+
+void ExperimentRunner::start(const QVector<Run> &runs, int priorityFirst, int priorityLast)
+{
+    // 不等上一批结束：工作线程最多100ms内发现取消并杀掉进程，让出线程后新一批的任务再开始。
+    // 上一批还在路上的结果按代号丢弃
+    cancel();
+    m_pool.clear();
+    ++m_generation;
+    m_total = runs.size();
+    m_finished = 0;
+    m_latencySum = 0;
+    m_clock.start();
+    if (runs.isEmpty())
+    {
+        emit allFinished();
+        return;
+    }
+
+    const int workers = qMin(m_concurrency, runs.size());
+    m_scheduler = std::make_shared<ExperimentScheduler>(workers);
+    int next = 0;
+    for (const Run &run : runs)
+    {
+        if (run.row >= priorityFirst && run.row <= priorityLast)
+        {
+            m_scheduler->priority.runs.push_back(run);
+        }
+        else
+        {
+            // 工作线程从自己队列尾部取，倒序放入使每个线程大体按行顺序执行
+            m_scheduler->queues[next]->runs.push_front(run);
+            next = (next + 1) % workers;
+        }
+    }
+    m_pool.setMaxThreadCount(workers);
+    for (int i = 0; i < workers; ++i)
+        m_pool.start(new ExperimentWorker(this, m_scheduler, m_generation, i, m_timeout));
+}
+
+void ExperimentRunner::prioritize(int firstRow, int lastRow)
+{
+    if (!m_scheduler)
+        return;
+    std::deque<Run> moved;
+    for (auto &queue : m_scheduler->queues)
+    {
+        QMutexLocker locker(&queue->mutex);
+        for (auto it = queue->runs.begin(); it != queue->runs.end();)
+        {
+            if (it->row >= firstRow && it->row <= lastRow)
+            {
+                moved.push_back(*it);
+                it = queue->runs.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    if (moved.empty())
+        return;
+    QMutexLocker locker(&m_scheduler->priority.mutex);
+    m_scheduler->priority.runs.insert(m_scheduler->priority.runs.begin(), moved.begin(), moved.end());
+}
+
+void ExperimentRunner::cancel()
+{
+    if (!m_scheduler || !isRunning())
+        return;
+    m_scheduler->clear();
+    // 排队的任务不会再报告，正在运行的被杀掉后仍然报告一次
+    m_total = m_scheduler->taken.load();
+    if (m_finished == m_total)
+        emit allFinished();
+}
+
+bool ExperimentRunner::isRunning() const
+{
+    return m_finished < m_total;
+}
+
+void ExperimentRunner::onWorkerStarted(int generation, int id)
+{
+    if (generation == m_generation)
+        emit runStarted(id);
+}
+
+void ExperimentRunner::onWorkerFinished(int generation, int id, int exitCode, qint64 elapsedMs, QString output)
+{
+    if (generation != m_generation)
+        return;
+    emit runFinished(id, exitCode, elapsedMs, output);
+    ++m_finished;
+    m_latencySum += elapsedMs;
+    const double seconds = qMax<qint64>(1, m_clock.elapsed()) / 1000.0;
+    emit progress(m_finished, m_total, m_finished / seconds, double(m_latencySum) / m_finished);
+    if (m_finished == m_total)
+        emit allFinished();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <memory>
+
+struct ExperimentScheduler;
+
+// 本地并行执行实验：参数扫描的每一行启动一次工具程序(QProcess)。
+// 调度是工作窃取：任务轮流分到每个工作线程自己的双端队列，线程先取自己的(后进先出)，
+// 空了再从别的线程队列头部窃取；可见行的任务放在优先队列里，所有线程最先取。
+// 开始、结束通过信号回到GUI线程，进度信号里带吞吐量(次/秒)和平均耗时
+class ExperimentRunner : public QObject
+{
+    Q_OBJECT
+public:
+    struct Run
+    {
+        int id = 0;          // 对应ExperimentNode::id
+        int row = 0;         // 表格行，用于可见行优先
+        int column = 0;      // 工具在表格中的列范围[column, column + columnCount)
+        int columnCount = 1;
+        QString binary;
+        QStringList arguments;
+    };
+
+    explicit ExperimentRunner(QObject *parent = nullptr);
+    ~ExperimentRunner() override;
+
+    // 同时运行的进程数，默认为CPU核数；运行中修改在下一次start时生效
+    void setMaxConcurrency(int count);
+    int maxConcurrency() const;
+    // 单次运行的超时，超时后杀掉进程，按失败处理
+    void setTimeout(int msecs);
+
+    // [priorityFirst, priorityLast]行(当前可见的行)先运行
+    // 正在运行时先取消上一批，不阻塞GUI线程；上一批的进程被杀掉、让出线程后新一批开始
+    void start(const QVector<Run> &runs, int priorityFirst = -1, int priorityLast = -1);
+    // 滚动后把尚未开始的可见行任务移到优先队列
+    void prioritize(int firstRow, int lastRow);
+    // 丢弃排队的任务并杀掉正在运行的进程
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void runStarted(int id);
+    // exitCode为-1表示无法启动、崩溃、超时或被取消；output是标准输出的最后一行
+    void runFinished(int id, int exitCode, qint64 elapsedMs, QString output);
+    void progress(int finished, int total, double runsPerSecond, double averageLatencyMs);
+    void allFinished();
+
+private slots:
+    // 工作线程通过排队调用回到GUI线程
+    void onWorkerStarted(int generation, int id);
+    void onWorkerFinished(int generation, int id, int exitCode, qint64 elapsedMs, QString output);
+
+private:
+    std::shared_ptr<ExperimentScheduler> m_scheduler;
+    QThreadPool m_pool;
+    int m_concurrency;
+    int m_timeout = 60000;
+    int m_generation = 0;
+    int m_total = 0;
+    int m_finished = 0;
+    qint64 m_latencySum = 0;
+    QElapsedTimer m_clock;
+};
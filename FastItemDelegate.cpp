@@ -0,0 +1,128 @@
+#include <QFontMetrics>
+#include <QPainter>
+
+#include "FastItemDelegate.h"
+#include "StaticTextCache.h"
+
+// 文本与单元格边缘的间距，与常见样式的PM_FocusFrameHMargin + 1相同
+static const int TextMargin = 3;
+
+FastItemDelegate::FastItemDelegate(QObject *parent) : QStyledItemDelegate(parent)
+{
+}
+
+void FastItemDelegate::setDefaultStyle(const ColumnStyle &style)
+{
+    m_defaultStyle = style;
+}
+
+FastItemDelegate::ColumnStyle FastItemDelegate::defaultStyle() const
+{
+    return m_defaultStyle;
+}
+
+void FastItemDelegate::setColumnStyle(int column, const ColumnStyle &style)
+{
+    if (column < 0)
+        return;
+    if (column >= m_columnStyles.size())
+    {
+        m_columnStyles.resize(column + 1);
+        m_hasColumnStyle.resize(column + 1);
+    }
+    m_columnStyles[column] = style;
+    m_hasColumnStyle[column] = 1;
+}
+
+const FastItemDelegate::ColumnStyle &FastItemDelegate::columnStyle(int column) const
+{
+    if (column >= 0 && column < m_hasColumnStyle.size() && m_hasColumnStyle.at(column))
+        return m_columnStyles.at(column);
+    return m_defaultStyle;
+}
+
+void FastItemDelegate::insertColumns(int first, int count)
+{
+    if (first < 0 || first >= m_columnStyles.size() || count <= 0)
+        return;
+    m_columnStyles.insert(first, count, ColumnStyle());
+    m_hasColumnStyle.insert(first, count, 0);
+}
+
+void FastItemDelegate::removeColumns(int first, int count)
+{
+    if (first < 0 || first >= m_columnStyles.size() || count <= 0)
+        return;
+    count = qMin(count, m_columnStyles.size() - first);
+    m_columnStyles.remove(first, count);
+    m_hasColumnStyle.remove(first, count);
+}
+
+void FastItemDelegate::setProfiler(HeaderProfiler *profiler)
+{
+    m_profiler = profiler;
+}
+
+QString FastItemDelegate::formatValue(const QVariant &value, const ColumnStyle &style) const
+{
+    switch (value.userType())
+    {
+    case QMetaType::Double:
+        return style.precision >= 0 ? QString::number(value.toDouble(), 'f', style.precision) : QString::number(value.toDouble());
+    case QMetaType::Float:
+        return style.precision >= 0 ? QString::number(value.toFloat(), 'f', style.precision) : QString::number(value.toFloat());
+    default:
+        return value.toString();
+    }
+}
+
+void FastItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const ColumnStyle &style = columnStyle(index.column());
+    const bool selected = (option.state & QStyle::State_Selected);
+    const QPalette::ColorGroup group = (option.state & QStyle::State_Enabled) ? QPalette::Normal : QPalette::Disabled;
+    if (selected)
+    {
+        painter->fillRect(option.rect, option.palette.brush(group, QPalette::Highlight));
+    }
+    else
+    {
+        // 逐格的底色(实验运行状态等)优先于列底色
+        const QVariant background = index.data(Qt::BackgroundRole);
+        if (background.isValid())
+            painter->fillRect(option.rect, background.value<QBrush>());
+        else if (style.background.isValid())
+            painter->fillRect(option.rect, style.background);
+    }
+
+    // 除底色外只取DisplayRole一个角色
+    const QVariant value = index.data(Qt::DisplayRole);
+    if (!value.isValid())
+        return;
+
+    if (selected)
+        painter->setPen(option.palette.color(group, QPalette::HighlightedText));
+    else
+        painter->setPen(style.foreground.isValid() ? style.foreground : option.palette.color(group, QPalette::Text));
+    const QRect textRect = option.rect.adjusted(TextMargin, 0, -TextMargin, 0);
+
+    // 数值各不相同，直接画；字符串(工具/参数值等)经常重复，用按字节数淘汰的排版缓存，
+    // 不放进LabelTable(不会释放)，放不下时退回省略号
+    if (value.type() != QVariant::String)
+    {
+        painter->drawText(textRect, style.alignment, formatValue(value, style));
+        return;
+    }
+    const QString text = value.toString();
+    if (StaticTextCache::instance()->drawCellText(painter, textRect, style.alignment, text, m_profiler))
+        return;
+    painter->drawText(textRect, style.alignment, painter->fontMetrics().elidedText(text, Qt::ElideRight, textRect.width()));
+}
+
+QSize FastItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QVariant value = index.data(Qt::DisplayRole);
+    const QString text = formatValue(value, columnStyle(index.column()));
+    const QSize size = QFontMetrics(option.font).size(0, text);
+    return QSize(size.width() + 2 * TextMargin, qMax(size.height(), QFontMetrics(option.font).height()) + 2);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QColor>
+#include <QStyledItemDelegate>
+#include <QVector>
+
+class HeaderProfiler;
+
+// 表格数据单元格的快速绘制：每个单元格只取DisplayRole和BackgroundRole，对齐、文字颜色按列统一设置，
+// 直接画背景和文本(StaticTextCache)，不经过QStyle。字体、检查框、图标等逐项角色不再生效；
+// 编辑仍使用QStyledItemDelegate的编辑器
+class FastItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    struct ColumnStyle
+    {
+        int alignment = Qt::AlignCenter;
+        QColor foreground;  // 无效时使用调色板的Text
+        QColor background;  // 无效时不填充(使用表格的背景/交替行颜色)
+        int precision = -1; // 浮点数的小数位数，< 0 时按QString::number的默认格式
+    };
+
+    explicit FastItemDelegate(QObject *parent = nullptr);
+
+    void setDefaultStyle(const ColumnStyle &style);
+    ColumnStyle defaultStyle() const;
+    void setColumnStyle(int column, const ColumnStyle &style);
+    const ColumnStyle &columnStyle(int column) const;
+    // 数据模型插入/删除列时同步移动列样式
+    void insertColumns(int first, int count);
+    void removeColumns(int first, int count);
+
+    // 文本排版缓存的命中/未命中计入profiler，可以为空
+    void setProfiler(HeaderProfiler *profiler);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    QString formatValue(const QVariant &value, const ColumnStyle &style) const;
+
+    ColumnStyle m_defaultStyle;
+    QVector<ColumnStyle> m_columnStyles;
+    QVector<char> m_hasColumnStyle; // 没有单独设置的列使用m_defaultStyle
+    HeaderProfiler *m_profiler = nullptr;
+};
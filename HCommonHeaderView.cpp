@@ -1,4 +1,6 @@
 #include "HCommonHeaderView.h"
+#include "LabelTable.h"
+#include "StaticTextCache.h"
 #include <QRgba64>
 #define ICON_SIZE 12          //图标大小
 #define ICON_RIGHT_MARGIN 6   //离右边缘间距
@@ -10,9 +12,9 @@ HCommonHeaderView::HCommonHeaderView(Qt::Orientation orientation, QWidget *paren
     ,m_checkBoxState(Qt::Unchecked)
     ,m_bMousePressed(false)
     ,m_bSectionSizeChanging(false)
-    ,m_iCheckBoxColumn(999)
-    ,m_bPressedIndex(999)
-    ,m_iSortIndex(999)
+    ,m_iCheckBoxColumn(-1)
+    ,m_bPressedIndex(-1)
+    ,m_iSortIndex(-1)
     ,m_bIsFirst(true)
     ,bSortFlag(true)
 {
@@ -20,14 +22,13 @@ HCommonHeaderView::HCommonHeaderView(Qt::Orientation orientation, QWidget *paren
     setTextAlign(0);
     m_gbColor = QColor("#282D35");
     this->setSectionResizeMode(QHeaderView::Interactive);
- 
-    for(int i = 0; i < 20; ++i)
-    {
-        m_headerLst.append("");
-    }
     connect(this,&HCommonHeaderView::sectionResized,[&](){ // 列拖动改变大小
         m_bSectionSizeChanging = true;
     });
+    connect(HeaderIconCache::instance(),&HeaderIconCache::skinChanged,this,[this](){
+        preloadIcons();
+        this->viewport()->update();
+    });
 }
  
 void HCommonHeaderView::restoreDefaultState()
@@ -38,12 +39,93 @@ void HCommonHeaderView::restoreDefaultState()
  
 void HCommonHeaderView::setHeaderText(const QStringList &list)
 {
-    m_headerLst.clear();
-    m_headerLst = list;
+    setHeaderText_NoSort(list);
+    m_sortable.resize(qMax(m_sortable.size(), list.count()));
     for(int i = 0; i < list.count() - 1; i++)
     {
-        m_sortColumnLst.append(i);
+        m_sortable.setBit(i);
+    }
+}
+
+void HCommonHeaderView::setSectionSortable(int section, bool sortable)
+{
+    if(section < 0)
+        return;
+    if(section >= m_sortable.size())
+        m_sortable.resize(section + 1);
+    m_sortable.setBit(section, sortable);
+}
+
+bool HCommonHeaderView::isSectionSortable(int section) const
+{
+    return section >= 0 && section < m_sortable.size() && m_sortable.testBit(section);
+}
+
+QString HCommonHeaderView::sectionText(int section) const
+{
+    const int id = (section >= 0 && section < m_labelIds.size()) ? m_labelIds.at(section) : -1;
+    if(id >= 0)
+        return LabelTable::instance()->text(id);
+    if(!this->model())
+        return QString();
+    return this->model()->headerData(section, orientation(), Qt::DisplayRole).toString();
+}
+
+void HCommonHeaderView::setModel(QAbstractItemModel *model)
+{
+    if(QAbstractItemModel *old = this->model()) {
+        disconnect(old, &QAbstractItemModel::columnsInserted, this, &HCommonHeaderView::onSectionsInserted);
+        disconnect(old, &QAbstractItemModel::columnsRemoved, this, &HCommonHeaderView::onSectionsRemoved);
+        disconnect(old, &QAbstractItemModel::rowsInserted, this, &HCommonHeaderView::onSectionsInserted);
+        disconnect(old, &QAbstractItemModel::rowsRemoved, this, &HCommonHeaderView::onSectionsRemoved);
+    }
+    QHeaderView::setModel(model);
+    if(!model)
+        return;
+    if(orientation() == Qt::Horizontal) {
+        connect(model, &QAbstractItemModel::columnsInserted, this, &HCommonHeaderView::onSectionsInserted);
+        connect(model, &QAbstractItemModel::columnsRemoved, this, &HCommonHeaderView::onSectionsRemoved);
+    } else {
+        connect(model, &QAbstractItemModel::rowsInserted, this, &HCommonHeaderView::onSectionsInserted);
+        connect(model, &QAbstractItemModel::rowsRemoved, this, &HCommonHeaderView::onSectionsRemoved);
+    }
+}
+
+void HCommonHeaderView::onSectionsInserted(const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+    const int n = last - first + 1;
+    if(first < m_labelIds.size())
+        m_labelIds.insert(first, n, -1);
+    if(first < m_sortable.size()) {
+        const int oldSize = m_sortable.size();
+        m_sortable.resize(oldSize + n);
+        for(int i = oldSize - 1; i >= first; --i)
+            m_sortable.setBit(i + n, m_sortable.testBit(i));
+        m_sortable.fill(false, first, first + n);
+    }
+    if(m_iSortIndex >= first)
+        m_iSortIndex += n;
+}
+
+void HCommonHeaderView::onSectionsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+    const int n = last - first + 1;
+    if(first < m_labelIds.size())
+        m_labelIds.remove(first, qMin(n, m_labelIds.size() - first));
+    if(first < m_sortable.size()) {
+        const int oldSize = m_sortable.size();
+        for(int i = last + 1; i < oldSize; ++i)
+            m_sortable.setBit(i - n, m_sortable.testBit(i));
+        m_sortable.resize(qMax(first, oldSize - n));
     }
+    if(m_iSortIndex > last)
+        m_iSortIndex -= n;
+    else if(m_iSortIndex >= first)
+        m_iSortIndex = -1;
 }
  
 void HCommonHeaderView::setCurSortColumn(int column)
@@ -114,7 +196,7 @@ void HCommonHeaderView::paintSection(QPainter *painter, const QRect &rect, int l
     {
         return;
     }
-    if(logicalIndex == m_headerLst.count() - 1) return;
+    if(logicalIndex == count() - 1) return;
     paintSectionRightBorderLine(painter,rect);
 }
  
@@ -153,6 +235,32 @@ void HCommonHeaderView::mouseReleaseEvent(QMouseEvent *e)
     QHeaderView::mouseReleaseEvent(e);
 }
  
+void HCommonHeaderView::changeEvent(QEvent *e)
+{
+    QHeaderView::changeEvent(e);
+    if(e->type() == QEvent::StyleChange)
+    {
+        preloadIcons();
+    }
+}
+ 
+void HCommonHeaderView::showEvent(QShowEvent *e)
+{
+    preloadIcons();
+    QHeaderView::showEvent(e);
+}
+ 
+void HCommonHeaderView::preloadIcons()
+{
+    HeaderIconCache *cache = HeaderIconCache::instance();
+    const qreal dpr = devicePixelRatioF();
+    for(const QUrl &url : {m_ascendingOrderUrl,m_descendingOrderUrl,m_uncheckUrl,m_partCheckUrl,m_checkUrl})
+    {
+        if(!url.isEmpty())
+            cache->preload(url.path(),ICON_SIZE,dpr);
+    }
+}
+ 
 void HCommonHeaderView::setCheckState(Qt::CheckState state)
 {
     m_checkBoxState = state;
@@ -166,7 +274,8 @@ Qt::CheckState HCommonHeaderView::getCheckState() const
  
 void HCommonHeaderView::paintSortIndicatorIcon(QPainter *painter, const QRect &rect,int logicIndex) const
 {
-    if(m_headerLst.at(logicIndex) == "" && !m_sortColumnLst.contains(logicIndex) )
+    const QString text = sectionText(logicIndex);
+    if(text.isEmpty() && !isSectionSortable(logicIndex))
     {
         return;
     }
@@ -184,7 +293,7 @@ void HCommonHeaderView::paintSortIndicatorIcon(QPainter *painter, const QRect &r
     }
  
     QFontMetrics metrics = painter->fontMetrics();
-    QRect textRect = metrics.boundingRect(tmpRect,m_iTextAlign|Qt::AlignVCenter,m_headerLst.at(logicIndex));
+    QRect textRect = metrics.boundingRect(tmpRect,m_iTextAlign|Qt::AlignVCenter,text);
  
     QUrl iconUrl  =m_descendingOrderUrl;
     if(this->sortIndicatorOrder() == Qt::AscendingOrder)
@@ -192,8 +301,7 @@ void HCommonHeaderView::paintSortIndicatorIcon(QPainter *painter, const QRect &r
         iconUrl  = m_ascendingOrderUrl;
     }
  
-    QPixmap tmp(QString("HTSkin:%1/%2").arg(HCore::instance()->getCurrentSkinId())
-                .arg(iconUrl.path()));
+    QPixmap tmp = HeaderIconCache::instance()->pixmap(iconUrl.path(),ICON_SIZE,devicePixelRatioF());
  
     QRect iconRect = textRect.adjusted(ICON_RIGHT_MARGIN + textRect.width(),0,ICON_RIGHT_MARGIN + textRect.width(),0);
     QApplication::style()->drawItemPixmap(painter,iconRect,Qt::AlignLeft|Qt::AlignVCenter,tmp);
@@ -201,24 +309,23 @@ void HCommonHeaderView::paintSortIndicatorIcon(QPainter *painter, const QRect &r
  
 void HCommonHeaderView::paintCheckBoxIcon(QPainter *painter, const QRect &rect) const
 {
-    Q_UNUSED(painter);
-    Q_UNUSED(rect);
-    //    QUrl iconUrl;
-    //    switch(m_checkBoxState) {
-    //        case Qt::Unchecked: {
-    //            iconUrl = BD_GL_ALGORITHMIC_COMMON_STYLE->getUncheckUrl();
-    //        } break;
-    //        case Qt::PartiallyChecked: {
-    //            iconUrl = BD_GL_ALGORITHMIC_COMMON_STYLE->getPartCheckUrl();
-    //        } break;
-    //        case Qt::Checked: {
-    //            iconUrl = BD_GL_ALGORITHMIC_COMMON_STYLE->getCheckUrl();
-    //        } break;
-    //    }
-    //    QPixmap tmp(QString("BDSkin:%1/%2").arg(gBDCore->getCurrentSkinId())
-    //                .arg(iconUrl.path()));
+    QUrl iconUrl;
+    switch(m_checkBoxState) {
+        case Qt::Unchecked: {
+            iconUrl = m_uncheckUrl;
+        } break;
+        case Qt::PartiallyChecked: {
+            iconUrl = m_partCheckUrl;
+        } break;
+        case Qt::Checked: {
+            iconUrl = m_checkUrl;
+        } break;
+    }
+    if(iconUrl.isEmpty())
+        return;
+    QPixmap tmp = HeaderIconCache::instance()->pixmap(iconUrl.path(),ICON_SIZE,devicePixelRatioF());
  
-    //    QApplication::style()->drawItemPixmap(painter,rect.adjusted(0,0,-6,0),Qt::AlignVCenter|Qt::AlignRight,tmp);
+    QApplication::style()->drawItemPixmap(painter,rect.adjusted(0,0,-6,0),Qt::AlignVCenter|Qt::AlignRight,tmp);
 }
  
 void HCommonHeaderView::paintSectionRightBorderLine(QPainter *painter, const QRect &rect) const
@@ -260,18 +367,19 @@ void HCommonHeaderView::paintSectionText(QPainter *painter, const QRect &rect, i
  
     painter->fillRect(rect,m_gbColor);
     if( m_iCheckBoxColumn == logicIndex ) return;
+    const QString text = sectionText(logicIndex);
     painter->save();
     if(bAllColumnAlgFlag ){
         if(m_iTextAlign == 1) {//左对齐
-            painter->drawText(tmpRect.adjusted(m_iLeftMargin,0,m_iLeftMargin,0),m_iTextAlign|Qt::AlignVCenter,m_headerLst.at(logicIndex));
+            StaticTextCache::instance()->drawText(painter,tmpRect.adjusted(m_iLeftMargin,0,m_iLeftMargin,0),m_iTextAlign|Qt::AlignVCenter,text);
         }else{
-            painter->drawText(tmpRect,m_iTextAlign|Qt::AlignVCenter,m_headerLst.at(logicIndex));
+            StaticTextCache::instance()->drawText(painter,tmpRect,m_iTextAlign|Qt::AlignVCenter,text);
         }
     }else{  //这个是根据model数据方式对齐
         tmpRect.setX(rect.x()+10);
         tmpRect.setWidth(tmpRect.width()-10);
         int nAlignment = this->model()->data(this->model()->index(0,logicIndex),Qt::TextAlignmentRole).toInt();
-        painter->drawText(tmpRect,nAlignment,m_headerLst.at(logicIndex));
+        StaticTextCache::instance()->drawText(painter,tmpRect,nAlignment,text);
     }
  
     painter->restore();
@@ -302,7 +410,12 @@ void HCommonHeaderView::setAllColumnAligFlag(bool flag)
  
 void HCommonHeaderView::setHeaderText_NoSort(const QStringList &list)
 {
-    m_headerLst.clear();
-    m_headerLst = list;
+    LabelTable *labels = LabelTable::instance();
+    m_labelIds.resize(list.count());
+    for(int i = 0; i < list.count(); i++)
+    {
+        m_labelIds[i] = labels->intern(list.at(i));
+    }
+    this->viewport()->update();
 }
  
\ No newline at end of file
@@ -1,10 +1,14 @@
+#pragma once
+ 
 #include <QObject>
 #include <QHeaderView>
 #include <QUrl>
 #include <QPainter>
 #include <QMouseEvent>
 #include <QApplication>
-#include "htcore/Core.h"
+#include <QBitArray>
+#include <QVector>
+#include "HeaderIconCache.h"
  
 class HCommonHeaderView : public QHeaderView
 {
@@ -15,13 +19,25 @@ class HCommonHeaderView : public QHeaderView
     Q_PROPERTY(int leftMargin MEMBER m_iLeftMargin )                 //!section做边距
     Q_PROPERTY(QUrl ascendingOrderUrl MEMBER  m_ascendingOrderUrl)   //!递增图标
     Q_PROPERTY(QUrl descendingOrderUrl MEMBER  m_descendingOrderUrl) //!递减图标
+    Q_PROPERTY(QUrl uncheckUrl MEMBER m_uncheckUrl)                  //!检查框未选中图标
+    Q_PROPERTY(QUrl partCheckUrl MEMBER m_partCheckUrl)              //!检查框部分选中图标
+    Q_PROPERTY(QUrl checkUrl MEMBER m_checkUrl)                      //!检查框选中图标
 public:
     explicit HCommonHeaderView(Qt::Orientation orientation = Qt::Horizontal,QWidget *parent = 0);
  
     void restoreDefaultState();
  
+    ///
+    /// \brief setHeaderText
+    /// \param list
+    ///  设置各列文本，除最后一列外都可以排序；没有设置文本的列显示模型的headerData
+    ///
     void setHeaderText(const QStringList &list);
     void setHeaderText_NoSort(const QStringList &list);
+    void setSectionSortable(int section, bool sortable);
+    bool isSectionSortable(int section) const;
+    QString sectionText(int section) const;
+
     void setCurSortColumn(int column);
     int getCurSortIndex() const;
  
@@ -33,7 +49,7 @@ public:
     ///
     /// \brief setCheckBoxForColumn
     /// \param column
-    ///  设置检查框对应的列，不设置则没有检查框
+    ///  设置检查框对应的列，不设置(-1)则没有检查框
     ///
     void setCheckBoxForColumn(int column);
  
@@ -53,6 +69,8 @@ public:
  
     void setShowBottonLine(bool value);
  
+    void setModel(QAbstractItemModel *model) override;
+ 
 signals:
     //!
     //! \brief check状态改变
@@ -95,6 +113,14 @@ protected:
     ///
     void mouseReleaseEvent(QMouseEvent *e);
  
+    ///
+    /// \brief changeEvent
+    /// \param e
+    ///  样式表重新生效时图标url可能变了，重新预加载
+    ///
+    void changeEvent(QEvent *e);
+    void showEvent(QShowEvent *e);
+ 
 private:
     void setCheckState(Qt::CheckState state);
  
@@ -123,12 +149,27 @@ private:
     void paintSectionRightBorderLine(QPainter *painter, const QRect &rect) const;
  
     void paintSectionText(QPainter *painter, const QRect &rect, int logicIndex) const;
+
+    ///
+    /// \brief onSectionsInserted/onSectionsRemoved
+    ///  模型插入/删除列(行)时同步移动section属性
+    ///
+    void onSectionsInserted(const QModelIndex &parent, int first, int last);
+    void onSectionsRemoved(const QModelIndex &parent, int first, int last);
+ 
+    ///
+    /// \brief preloadIcons
+    ///  预先加载排序、检查框图标，绘制时只从HeaderIconCache查表。
+    ///  皮肤由HeaderIconCache的HeaderSkinProvider提供，表头本身不依赖皮肤框架
+    ///
+    void preloadIcons();
  
  
  
 private:
-    QVector<int> m_sortColumnLst;  //存储能够进行排序的索引
-    QStringList m_headerLst;
+    //! 按section下标存放的属性，绘制时O(1)查询，越界的section视为没有设置
+    QVector<int> m_labelIds;  //文本在LabelTable中的id，-1表示没有设置
+    QBitArray m_sortable;     //能够进行排序的section
  
     Qt::CheckState m_checkBoxState;
     int m_iSortIndex;
@@ -145,6 +186,9 @@ private:
     bool m_bIsFirst;
     QUrl m_ascendingOrderUrl;
     QUrl m_descendingOrderUrl;
+    QUrl m_uncheckUrl;
+    QUrl m_partCheckUrl;
+    QUrl m_checkUrl;
     bool bAllColumnAlgFlag{true}; //设置全部行列的对齐方式标志
     bool bSortFlag;
     bool mbShowBottonLine{false};
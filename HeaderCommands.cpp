@@ -0,0 +1,234 @@
+#include "HeaderCommands.h"
+#include "EwsTableView.h"
+#include "HeaderTree.h"
+#include "LabelTable.h"
+#include "data_model.h"
+
+HeaderInsertCommand::HeaderInsertCommand(EwsTableView *table, const QVector<int> &parentPath, const QVector<Entry> &entries, const QString &text, QUndoCommand *parent)
+    : QUndoCommand(text, parent), m_table(table), m_parentPath(parentPath), m_entries(entries)
+{
+}
+
+HeaderInsertCommand::~HeaderInsertCommand()
+{
+    // 已撤销(或从未执行)的命令持有自己的节点
+    if (m_inTree)
+        return;
+    for (const Entry &entry : m_entries)
+    {
+        delete entry.node;
+        delete entry.tool;
+    }
+}
+
+void HeaderInsertCommand::redo()
+{
+    HeaderTree *tree = m_table->m_headerTree;
+    HeaderNode *parent = tree->nodeAtPath(m_parentPath);
+    if (!parent || m_inTree)
+        return;
+
+    const bool toolLevel = (parent == tree->root());
+    ToolNode *tool = (m_parentPath.size() == 1) ? m_table->tool_list.value(m_parentPath.first()) : nullptr;
+    m_parentWasLeaf = !toolLevel && parent->children.isEmpty();
+    if (m_parentWasLeaf)
+        m_parentCells = captureCells(m_table, tree->firstSection(parent), 1);
+    if (toolLevel && m_table->tool_list.isEmpty())
+        m_table->pHeader->setCellText(0, 0, QString());
+
+    tree->beginUpdate();
+    for (const Entry &entry : m_entries)
+    {
+        if (toolLevel)
+        {
+            m_table->tool_list.insert(entry.pos, entry.tool);
+        }
+        else if (tool)
+        {
+            tool->params_list.insert(qMin(entry.pos, tool->params_list.size()), entry.key);
+            tool->params_dict.insert(entry.key, entry.value);
+        }
+        tree->insertSubtree(parent, entry.pos, entry.node);
+    }
+    tree->endUpdate();
+    m_inTree = true;
+
+    if (!m_done)
+    {
+        writeInitialValues();
+        m_done = true;
+        return;
+    }
+    for (int i = 0; i < m_entries.size(); ++i)
+    {
+        const HeaderNode *node = m_entries[i].node;
+        restoreCells(m_table, tree->firstSection(node), node->leafCount, m_cells.value(i));
+    }
+    m_cells.clear();
+}
+
+void HeaderInsertCommand::undo()
+{
+    HeaderTree *tree = m_table->m_headerTree;
+    HeaderNode *parent = tree->nodeAtPath(m_parentPath);
+    if (!parent || !m_inTree)
+        return;
+
+    const bool toolLevel = (parent == tree->root());
+    ToolNode *tool = (m_parentPath.size() == 1) ? m_table->tool_list.value(m_parentPath.first()) : nullptr;
+
+    // 只记下要删除的列中非空的单元格，重做时写回
+    m_cells.resize(m_entries.size());
+    for (int i = 0; i < m_entries.size(); ++i)
+    {
+        const HeaderNode *node = m_entries[i].node;
+        m_cells[i] = captureCells(m_table, tree->firstSection(node), node->leafCount);
+    }
+
+    for (int i = m_entries.size() - 1; i >= 0; --i)
+    {
+        const Entry &entry = m_entries[i];
+        tree->takeSubtree(entry.node);
+        if (toolLevel)
+        {
+            m_table->tool_list.removeOne(entry.tool);
+        }
+        else if (tool)
+        {
+            QStringList &keys = tool->params_list;
+            const int at = (entry.pos < keys.size() && keys[entry.pos] == entry.key) ? entry.pos : keys.lastIndexOf(entry.key);
+            if (at >= 0)
+                keys.removeAt(at);
+            if (!keys.contains(entry.key))
+                tool->params_dict.remove(entry.key);
+        }
+    }
+    m_inTree = false;
+
+    if (m_parentWasLeaf)
+        restoreCells(m_table, tree->firstSection(parent), 1, m_parentCells);
+    if (toolLevel && m_table->tool_list.isEmpty())
+        m_table->pHeader->setCellText(0, 0, "No Tools");
+}
+
+QVector<HeaderInsertCommand::CellData> HeaderInsertCommand::captureCells(const EwsTableView *table, int first, int count)
+{
+    const QStandardItemModel *model = table->m_pDataModel;
+    QVector<CellData> cells;
+    for (int offset = 0; offset < count; ++offset)
+    {
+        for (int row = 0; row < model->rowCount(); ++row)
+        {
+            const QStandardItem *item = model->item(row, first + offset);
+            if (!item)
+                continue;
+            QMap<int, QVariant> data = model->itemData(item->index());
+            if (!data.isEmpty())
+                cells.append({row, offset, data});
+        }
+    }
+    return cells;
+}
+
+void HeaderInsertCommand::restoreCells(EwsTableView *table, int first, int count, const QVector<CellData> &cells)
+{
+    QStandardItemModel *model = table->m_pDataModel;
+    for (int column = first; column < first + count; ++column)
+    {
+        for (int row = 0; row < model->rowCount(); ++row)
+        {
+            const QStandardItem *item = model->item(row, column);
+            if (item && !model->itemData(item->index()).isEmpty())
+                model->setItem(row, column, new QStandardItem);
+        }
+    }
+    for (const CellData &cell : cells)
+        model->setItemData(model->index(cell.row, first + cell.offset), cell.data);
+}
+
+void HeaderInsertCommand::writeInitialValues()
+{
+    HeaderTree *tree = m_table->m_headerTree;
+    for (const Entry &entry : m_entries)
+    {
+        const HeaderNode *node = entry.node;
+        int col = tree->firstSection(node);
+        if (!entry.tool)
+        {
+            m_table->set_header_value(col, entry.value);
+        }
+        else if (node->children.isEmpty())
+        {
+            m_table->set_header_value(col, "--");
+        }
+        else
+        {
+            for (const HeaderNode *param : node->children)
+            {
+                m_table->set_header_value(col, entry.tool->params_dict.value(param->text).toString());
+                col += param->leafCount;
+            }
+        }
+    }
+}
+
+HeaderRenameCommand::HeaderRenameCommand(EwsTableView *table, const QVector<int> &path, const QString &text, QUndoCommand *parent)
+    : QUndoCommand(QStringLiteral("重命名 %1").arg(text), parent), m_table(table), m_path(path), m_newLabel(LabelTable::instance()->intern(text))
+{
+}
+
+void HeaderRenameCommand::redo()
+{
+    if (m_oldLabel < 0)
+    {
+        const HeaderNode *node = m_table->m_headerTree->nodeAtPath(m_path);
+        if (!node)
+            return;
+        m_oldLabel = LabelTable::instance()->intern(node->text);
+    }
+    apply(m_newLabel);
+}
+
+void HeaderRenameCommand::undo()
+{
+    if (m_oldLabel >= 0)
+        apply(m_oldLabel);
+}
+
+int HeaderRenameCommand::id() const
+{
+    return 1;
+}
+
+bool HeaderRenameCommand::mergeWith(const QUndoCommand *other)
+{
+    const HeaderRenameCommand *rename = static_cast<const HeaderRenameCommand *>(other);
+    if (rename->m_path != m_path)
+        return false;
+    m_newLabel = rename->m_newLabel;
+    setText(rename->text());
+    return true;
+}
+
+void HeaderRenameCommand::apply(int label)
+{
+    HeaderTree *tree = m_table->m_headerTree;
+    HeaderNode *node = tree->nodeAtPath(m_path);
+    if (!node)
+        return;
+    const QString text = LabelTable::instance()->text(label);
+    const QString old = node->text;
+
+    // 同步工具/参数列表
+    ToolNode *tool = m_table->tool_list.value(m_path.first());
+    if (tool && m_path.size() == 1)
+    {
+        tool->name = text;
+    }
+    else if (tool && m_path.size() == 2 && m_path[1] < tool->params_list.size())
+    {
+        tool->params_list[m_path[1]] = text;
+        tool->params_dict.insert(text, tool->params_dict.take(old));
+    }
+    tree->setNodeText(node, text);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QMap>
+#include <QString>
+#include <QUndoCommand>
+#include <QVariant>
+#include <QVector>
+
+class EwsTableView;
+class HeaderNode;
+class ToolNode;
+
+// 表头结构编辑的撤销命令。命令只记录差异：插入/删除了哪些子树、这些列上原有的单元格、
+// 文本在LabelTable中的id，不保存整个表头或表格的快照，撤销/重做的开销只与改动的列数有关。
+// 合并单元格由表头树推导，子树插回去时自动恢复
+
+// 在同一个父节点下插入一批工具或参数(add_tool/add_param/add_tools/add_params)
+class HeaderInsertCommand : public QUndoCommand
+{
+public:
+    struct Entry
+    {
+        int pos = 0;
+        HeaderNode *node = nullptr; // 不在树中时由命令持有
+        ToolNode *tool = nullptr;   // 插入工具时对应的ToolNode，不在tool_list中时由命令持有
+        QString key;                // 插入参数时的参数名和值
+        QString value;
+    };
+
+    // parentPath为空时插入工具，否则是要插入参数的工具节点的路径
+    HeaderInsertCommand(EwsTableView *table, const QVector<int> &parentPath, const QVector<Entry> &entries, const QString &text, QUndoCommand *parent = nullptr);
+    ~HeaderInsertCommand() override;
+
+    void redo() override;
+    void undo() override;
+
+private:
+    struct CellData
+    {
+        int row;
+        int offset; // 相对于节点第一列
+        QMap<int, QVariant> data;
+    };
+
+    static QVector<CellData> captureCells(const EwsTableView *table, int first, int count);
+    // 先清空[first, first + count)再写回cells
+    static void restoreCells(EwsTableView *table, int first, int count, const QVector<CellData> &cells);
+    void writeInitialValues();
+
+    EwsTableView *m_table;
+    QVector<int> m_parentPath;
+    QVector<Entry> m_entries;
+    bool m_inTree = false;
+    bool m_done = false;                 // 执行过一次redo，之后重做时恢复undo时记下的单元格
+    bool m_parentWasLeaf = false;        // 插入前父节点是叶子，它的列被第一个子节点继承
+    QVector<CellData> m_parentCells;     // 父节点那一列插入前的内容
+    QVector<QVector<CellData>> m_cells;  // 每个节点撤销时的单元格内容
+};
+
+// 修改一个工具或参数的名字，只保存前后两个文本id；连续修改同一个节点合并为一条
+class HeaderRenameCommand : public QUndoCommand
+{
+public:
+    HeaderRenameCommand(EwsTableView *table, const QVector<int> &path, const QString &text, QUndoCommand *parent = nullptr);
+
+    void redo() override;
+    void undo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand *other) override;
+
+private:
+    void apply(int label);
+
+    EwsTableView *m_table;
+    QVector<int> m_path;
+    int m_oldLabel = -1;
+    int m_newLabel;
+};
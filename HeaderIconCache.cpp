@@ -0,0 +1,123 @@
+#include <QCoreApplication>
+#include <QFile>
+
+#include "HeaderIconCache.h"
+#include "HeaderSkinProvider.h"
+#include "LabelTable.h"
+
+HeaderIconCache *HeaderIconCache::instance()
+{
+    static HeaderIconCache cache;
+    return &cache;
+}
+
+HeaderIconCache::HeaderIconCache() : m_defaultProvider(new LocalSkinProvider(this))
+{
+    setSkinProvider(nullptr);
+    // 静态对象析构时QApplication已经不在了，QPixmap要在这之前释放；
+    // 与StaticTextCache一样用qAddPostRoutine，不依赖第一次调用时QApplication是否已经存在
+    qAddPostRoutine([]() { HeaderIconCache::instance()->clear(); });
+}
+
+void HeaderIconCache::setSkinProvider(HeaderSkinProvider *provider)
+{
+    if (!provider)
+        provider = m_defaultProvider;
+    if (m_provider)
+        disconnect(m_provider, nullptr, this, nullptr);
+    m_provider = provider;
+    connect(provider, &HeaderSkinProvider::skinChanged, this, [this]() { setSkin(m_provider->resourcePrefix(), m_provider->skinId()); });
+    // 换成已销毁的provider之前先恢复默认
+    connect(provider, &QObject::destroyed, this, [this, provider]() {
+        if (provider != m_defaultProvider)
+            setSkinProvider(nullptr);
+    });
+    setSkin(provider->resourcePrefix(), provider->skinId());
+}
+
+HeaderSkinProvider *HeaderIconCache::skinProvider() const
+{
+    return m_provider;
+}
+
+void HeaderIconCache::setSkin(const QString &prefix, const QString &skinId)
+{
+    if (prefix == m_prefix && skinId == m_skinId)
+        return;
+    m_prefix = prefix;
+    m_skinId = skinId;
+    m_entries.clear();
+    emit skinChanged();
+}
+
+QString HeaderIconCache::skinId() const
+{
+    return m_skinId;
+}
+
+void HeaderIconCache::preload(const QString &path, int extent, qreal dpr)
+{
+    entry(path, extent, dpr);
+}
+
+QPixmap HeaderIconCache::pixmap(const QString &path, int extent, qreal dpr)
+{
+    return entry(path, extent, dpr).pixmap;
+}
+
+QIcon HeaderIconCache::icon(const QString &path, int extent, qreal dpr)
+{
+    return entry(path, extent, dpr).icon;
+}
+
+int HeaderIconCache::loadCount() const
+{
+    return m_loadCount;
+}
+
+void HeaderIconCache::clear()
+{
+    m_entries.clear();
+}
+
+const HeaderIconCache::Entry &HeaderIconCache::entry(const QString &path, int extent, qreal dpr)
+{
+    const quint64 key = (quint64(LabelTable::instance()->intern(path)) << 32) | (quint64(qBound(1, qRound(dpr * 100), 0xffff)) << 16) | quint64(qBound(0, extent, 0xffff));
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+    {
+        Entry e;
+        e.pixmap = load(path, extent, dpr);
+        if (!e.pixmap.isNull())
+            e.icon = QIcon(e.pixmap);
+        it = m_entries.insert(key, e);
+    }
+    return it.value();
+}
+
+QPixmap HeaderIconCache::load(const QString &path, int extent, qreal dpr)
+{
+    if (path.isEmpty())
+        return QPixmap();
+    ++m_loadCount;
+    QPixmap pixmap;
+    if (!m_skinId.isEmpty())
+    {
+        const QString skinPath = QString("%1:%2/%3").arg(m_prefix, m_skinId, path);
+        if (QFile::exists(skinPath))
+            pixmap.load(skinPath);
+    }
+    if (pixmap.isNull())
+        pixmap.load(path);
+    if (pixmap.isNull() || extent <= 0)
+        return pixmap;
+
+    // 按设备像素缩放好，绘制时不再缩放
+    const int side = qRound(extent * dpr);
+    if (pixmap.width() > side || pixmap.height() > side)
+    {
+        pixmap = pixmap.scaled(side, side, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        pixmap.setDevicePixelRatio(dpr);
+    }
+    return pixmap;
+}
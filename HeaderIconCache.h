@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QHash>
+#include <QIcon>
+#include <QObject>
+#include <QPixmap>
+#include <QPointer>
+#include <QString>
+
+class HeaderSkinProvider;
+
+// 表头图标缓存：排序箭头、检查框、工具图标等按(皮肤, 路径, 尺寸, DPR)只读取和缩放一次，
+// key中的路径用LabelTable的id。切换皮肤时整体失效并发出skinChanged，绘制时只查表
+class HeaderIconCache : public QObject
+{
+    Q_OBJECT
+public:
+    static HeaderIconCache *instance();
+
+    // 皮肤来源，默认是LocalSkinProvider(没有皮肤)；provider不归缓存所有，为空时恢复默认
+    void setSkinProvider(HeaderSkinProvider *provider);
+    HeaderSkinProvider *skinProvider() const;
+    QString skinId() const;
+
+    // 在设置图标/切换皮肤时调用，提前读取并缩放到extent x extent以内
+    void preload(const QString &path, int extent, qreal dpr);
+    // 没有预加载过的图标第一次取时才会读文件
+    QPixmap pixmap(const QString &path, int extent, qreal dpr);
+    QIcon icon(const QString &path, int extent, qreal dpr);
+
+    // 读文件的次数，用来确认绘制过程中没有读文件
+    int loadCount() const;
+    void clear();
+
+signals:
+    void skinChanged();
+
+private:
+    struct Entry
+    {
+        QPixmap pixmap;
+        QIcon icon;
+    };
+
+    HeaderIconCache();
+    // 图标文件为"<prefix>:<skinId>/<path>"，找不到或皮肤id为空时直接使用path
+    void setSkin(const QString &prefix, const QString &skinId);
+    const Entry &entry(const QString &path, int extent, qreal dpr);
+    QPixmap load(const QString &path, int extent, qreal dpr);
+
+    HeaderSkinProvider *m_defaultProvider;
+    QPointer<HeaderSkinProvider> m_provider;
+    QString m_prefix;
+    QString m_skinId;
+    QHash<quint64, Entry> m_entries; // (路径id << 32) | (DPR x 100 << 16) | extent
+    int m_loadCount = 0;
+};
@@ -0,0 +1,126 @@
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+
+#include "HeaderInlineEditor.h"
+
+HeaderInlineEditor::HeaderInlineEditor(QWidget *parent) : QFrame(parent)
+{
+    setFrameShape(QFrame::StyledPanel);
+    setAutoFillBackground(true);
+
+    QHBoxLayout *layout = new QHBoxLayout(this);
+    layout->setContentsMargins(4, 2, 4, 2);
+    for (int i = 0; i < MaxFields; ++i)
+    {
+        m_labels[i] = new QLabel(this);
+        m_edits[i] = new QLineEdit(this);
+        layout->addWidget(m_labels[i]);
+        layout->addWidget(m_edits[i]);
+        connect(m_edits[i], &QLineEdit::returnPressed, this, &HeaderInlineEditor::commit);
+    }
+
+    m_error = new QLabel(this);
+    QPalette palette = m_error->palette();
+    palette.setColor(QPalette::WindowText, Qt::red);
+    m_error->setPalette(palette);
+    layout->addWidget(m_error);
+
+    QPushButton *ok_btn = new QPushButton("OK", this);
+    QPushButton *cancel_btn = new QPushButton("Cancel", this);
+    layout->addWidget(ok_btn);
+    layout->addWidget(cancel_btn);
+    connect(ok_btn, &QPushButton::clicked, this, &HeaderInlineEditor::commit);
+    connect(cancel_btn, &QPushButton::clicked, this, &HeaderInlineEditor::cancel);
+
+    hide();
+}
+
+void HeaderInlineEditor::open(const QVector<Field> &fields, QWidget *anchorWidget, const QRect &anchor, const QVariant &context)
+{
+    if (isEditing())
+        cancel();
+
+    // 表头通常只有几十像素高，放到窗口上才有地方显示
+    QWidget *host = anchorWidget->window();
+    if (parentWidget() != host)
+        setParent(host);
+
+    m_fields = fields.mid(0, MaxFields);
+    m_context = context;
+    for (int i = 0; i < MaxFields; ++i)
+    {
+        const bool used = i < m_fields.size();
+        m_labels[i]->setVisible(used);
+        m_edits[i]->setVisible(used);
+        m_edits[i]->clear();
+        if (!used)
+            continue;
+        m_labels[i]->setText(m_fields[i].label);
+        m_edits[i]->setPlaceholderText(m_fields[i].placeholder);
+        m_edits[i]->setValidator(m_fields[i].numeric ? &m_intValidator : nullptr);
+    }
+    m_error->clear();
+
+    adjustSize();
+    QPoint pos = anchorWidget->mapTo(host, anchor.bottomLeft());
+    pos.setX(qBound(0, pos.x(), qMax(0, host->width() - width())));
+    pos.setY(qBound(0, pos.y(), qMax(0, host->height() - height())));
+    move(pos);
+    show();
+    raise();
+    if (!m_fields.isEmpty())
+        m_edits[0]->setFocus();
+}
+
+void HeaderInlineEditor::cancel()
+{
+    if (!isEditing())
+        return;
+    hide();
+    QVariant context;
+    context.swap(m_context);
+    emit cancelled(context);
+}
+
+bool HeaderInlineEditor::isEditing() const
+{
+    return isVisible();
+}
+
+void HeaderInlineEditor::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Escape)
+    {
+        cancel();
+        return;
+    }
+    QFrame::keyPressEvent(event);
+}
+
+void HeaderInlineEditor::commit()
+{
+    QStringList values;
+    for (int i = 0; i < m_fields.size(); ++i)
+    {
+        QString value = m_edits[i]->text().trimmed();
+        if (m_fields[i].required && value.isEmpty())
+        {
+            // 不弹出对话框，直接在输入条上提示
+            QString name = m_fields[i].label;
+            name.remove(':');
+            m_error->setText(tr("%1 不能为空").arg(name));
+            m_edits[i]->setFocus();
+            adjustSize();
+            return;
+        }
+        values.append(value);
+    }
+
+    hide();
+    QVariant context;
+    context.swap(m_context);
+    emit committed(values, context);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QFrame>
+#include <QIntValidator>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+class QLabel;
+class QLineEdit;
+
+// 表头上的非模态输入条：只创建一次，反复使用，不进入嵌套的事件循环，
+// 编辑期间表头和表格照常刷新。回车或OK提交，Esc或Cancel取消，结果通过信号返回
+class HeaderInlineEditor : public QFrame
+{
+    Q_OBJECT
+public:
+    struct Field
+    {
+        Field(const QString &label = QString(), const QString &placeholder = QString(), bool required = false, bool numeric = false)
+            : label(label), placeholder(placeholder), required(required), numeric(numeric)
+        {
+        }
+        QString label;
+        QString placeholder;
+        bool required;
+        bool numeric; // 只能输入整数
+    };
+
+    static const int MaxFields = 3;
+
+    explicit HeaderInlineEditor(QWidget *parent = nullptr);
+
+    // 显示在anchor(anchorWidget坐标)下方，放在anchorWidget所在的窗口上；
+    // 正在编辑时上一次编辑被取消
+    void open(const QVector<Field> &fields, QWidget *anchorWidget, const QRect &anchor, const QVariant &context = QVariant());
+    void cancel();
+    bool isEditing() const;
+
+signals:
+    // values与open时的fields一一对应，已去掉首尾空白
+    void committed(const QStringList &values, const QVariant &context);
+    void cancelled(const QVariant &context);
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    void commit();
+
+    QLabel *m_labels[MaxFields];
+    QLineEdit *m_edits[MaxFields];
+    QLabel *m_error;
+    QIntValidator m_intValidator;
+    QVector<Field> m_fields;
+    QVariant m_context;
+};
@@ -0,0 +1,115 @@
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionButton>
+#include <qdrawutil.h>
+
+#include "HeaderPaintLayers.h"
+#include "MultiLevelHeaderView.h"
+#include "StaticTextCache.h"
+
+void HeaderBackgroundLayer::paint(QPainter *painter, const HeaderCellContext &cell) const
+{
+    if (cell.background.canConvert<QBrush>())
+        painter->fillRect(cell.rect, qvariant_cast<QBrush>(cell.background));
+    else
+        painter->fillRect(cell.rect, cell.option.palette.brush(QPalette::Button));
+}
+
+bool HeaderLabelLayer::affects(const HeaderCellContext &cell) const
+{
+    return !cell.option.text.isEmpty() || !cell.icon.isNull();
+}
+
+void HeaderLabelLayer::paint(QPainter *painter, const HeaderCellContext &cell) const
+{
+    QStyleOptionHeader option = cell.option;
+    if (cell.foreground.canConvert<QBrush>())
+        option.palette.setBrush(QPalette::ButtonText, qvariant_cast<QBrush>(cell.foreground));
+    // 带图标时图标和文本的摆放交给样式；纯文本用排好版的静态文本，和CE_HeaderLabel一样用ButtonText
+    if (!cell.icon.isNull())
+    {
+        cell.view->style()->drawControl(QStyle::CE_HeaderLabel, &option, painter, cell.view);
+        return;
+    }
+    const QPalette::ColorGroup group = (option.state & QStyle::State_Enabled) ? QPalette::Normal : QPalette::Disabled;
+    painter->setPen(option.palette.color(group, QPalette::ButtonText));
+    // 按字符串缓存，不进LabelTable；比单元格宽时与QPainter::drawText一样裁剪
+    if (!StaticTextCache::instance()->drawCellText(painter, option.rect, option.textAlignment, option.text, cell.view->profiler()))
+        painter->drawText(option.rect, option.textAlignment, option.text);
+}
+
+bool HeaderSortIndicatorLayer::affects(const HeaderCellContext &cell) const
+{
+    const int section = cell.view->sortIndicatorSection();
+    return cell.leaf && cell.view->sectionsSortable() && cell.firstSection <= section && section <= cell.lastSection;
+}
+
+void HeaderSortIndicatorLayer::paint(QPainter *painter, const HeaderCellContext &cell) const
+{
+    QStyleOptionHeader option = cell.option;
+    const int size = cell.view->style()->pixelMetric(QStyle::PM_HeaderMarkSize, nullptr, cell.view);
+    const int margin = cell.view->style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, cell.view);
+    option.rect = QRect(cell.rect.right() - margin - size, cell.rect.center().y() - size / 2, size, size);
+    // 与QHeaderView相同：升序显示向下的箭头
+    option.sortIndicator = (cell.view->sortIndicatorOrder() == Qt::AscendingOrder) ? QStyleOptionHeader::SortDown : QStyleOptionHeader::SortUp;
+    cell.view->style()->drawPrimitive(QStyle::PE_IndicatorHeaderArrow, &option, painter, cell.view);
+}
+
+bool HeaderCheckBoxLayer::affects(const HeaderCellContext &cell) const
+{
+    return cell.view->checkBoxesEnabled();
+}
+
+void HeaderCheckBoxLayer::paint(QPainter *painter, const HeaderCellContext &cell) const
+{
+    QStyleOptionButton option;
+    option.initFrom(cell.view);
+    option.rect = checkBoxRect(cell.rect, cell.view->style());
+    switch (cell.view->sectionCheckState(cell.firstSection, cell.lastSection))
+    {
+    case Qt::Checked:
+        option.state |= QStyle::State_On;
+        break;
+    case Qt::PartiallyChecked:
+        option.state |= QStyle::State_NoChange;
+        break;
+    default:
+        option.state |= QStyle::State_Off;
+        break;
+    }
+    cell.view->style()->drawPrimitive(QStyle::PE_IndicatorCheckBox, &option, painter, cell.view);
+}
+
+QRect HeaderCheckBoxLayer::checkBoxRect(const QRect &cellRect, const QStyle *style)
+{
+    const int width = style->pixelMetric(QStyle::PM_IndicatorWidth);
+    const int height = style->pixelMetric(QStyle::PM_IndicatorHeight);
+    const int margin = style->pixelMetric(QStyle::PM_HeaderMargin);
+    return QRect(cellRect.left() + margin, cellRect.center().y() - height / 2, width, height);
+}
+
+void HeaderBorderLayer::paint(QPainter *painter, const HeaderCellContext &cell) const
+{
+    qDrawShadePanel(painter, cell.rect, cell.option.palette, false, 1, nullptr);
+}
+
+bool HeaderFilterBadgeLayer::affects(const HeaderCellContext &cell) const
+{
+    if (!cell.leaf || !cell.view->hasFilteredSections())
+        return false;
+    for (int section = cell.firstSection; section <= cell.lastSection; ++section)
+    {
+        if (cell.view->isSectionFiltered(section))
+            return true;
+    }
+    return false;
+}
+
+void HeaderFilterBadgeLayer::paint(QPainter *painter, const HeaderCellContext &cell) const
+{
+    const int radius = 3;
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(cell.option.palette.brush(QPalette::Highlight));
+    painter->drawEllipse(QPoint(cell.rect.right() - radius - 2, cell.rect.top() + radius + 2), radius, radius);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QIcon>
+#include <QRect>
+#include <QString>
+#include <QStyleOptionHeader>
+#include <QVariant>
+
+class MultiLevelHeaderView;
+class QPainter;
+class QStyle;
+
+// 一个(合并)单元格的绘制信息，表头在绘制前填好，各层只读
+struct HeaderCellContext
+{
+    int row = -1;          // 根单元格
+    int column = -1;
+    int firstSection = 0;  // 覆盖的section范围[firstSection, lastSection]
+    int lastSection = 0;
+    bool leaf = false;     // 一直延伸到最后一级；排序、过滤以叶子为单位
+    QRect rect;
+    QIcon icon;
+    QVariant background;
+    QVariant foreground;
+    QStyleOptionHeader option; // 已填好text、icon、rect
+    const MultiLevelHeaderView *view = nullptr;
+
+    // 没有图标和自定义颜色，只有基础层时整格可以缓存成位图
+    bool isPlain() const { return icon.isNull() && !background.isValid() && !foreground.isValid(); }
+};
+
+// 表头单元格的绘制层。每层声明自己影响哪些单元格，只有影响到的层才会执行；
+// 只有基础层(背景、文本、边框)的普通单元格直接贴缓存的位图
+class HeaderPaintLayer
+{
+public:
+    virtual ~HeaderPaintLayer() {}
+    virtual const char *name() const = 0;
+    virtual bool isBase() const { return false; }
+    virtual bool affects(const HeaderCellContext &cell) const = 0;
+    virtual void paint(QPainter *painter, const HeaderCellContext &cell) const = 0;
+};
+
+class HeaderBackgroundLayer : public HeaderPaintLayer
+{
+public:
+    const char *name() const override { return "background"; }
+    bool isBase() const override { return true; }
+    bool affects(const HeaderCellContext &) const override { return true; }
+    void paint(QPainter *painter, const HeaderCellContext &cell) const override;
+};
+
+class HeaderLabelLayer : public HeaderPaintLayer
+{
+public:
+    const char *name() const override { return "label"; }
+    bool isBase() const override { return true; }
+    bool affects(const HeaderCellContext &cell) const override;
+    void paint(QPainter *painter, const HeaderCellContext &cell) const override;
+};
+
+// 叶子单元格上的排序箭头，合并到最后一级的单元格也算叶子
+class HeaderSortIndicatorLayer : public HeaderPaintLayer
+{
+public:
+    const char *name() const override { return "sort"; }
+    bool affects(const HeaderCellContext &cell) const override;
+    void paint(QPainter *painter, const HeaderCellContext &cell) const override;
+};
+
+// 检查框：叶子是各自section的状态，上级单元格是所覆盖叶子的汇总(全选/部分选中)
+class HeaderCheckBoxLayer : public HeaderPaintLayer
+{
+public:
+    const char *name() const override { return "checkbox"; }
+    bool affects(const HeaderCellContext &cell) const override;
+    void paint(QPainter *painter, const HeaderCellContext &cell) const override;
+    // 检查框在单元格中的位置，命中测试也用它
+    static QRect checkBoxRect(const QRect &cellRect, const QStyle *style);
+};
+
+class HeaderBorderLayer : public HeaderPaintLayer
+{
+public:
+    const char *name() const override { return "border"; }
+    bool isBase() const override { return true; }
+    bool affects(const HeaderCellContext &) const override { return true; }
+    void paint(QPainter *painter, const HeaderCellContext &cell) const override;
+};
+
+// 设置了过滤条件的叶子section右上角的小圆点
+class HeaderFilterBadgeLayer : public HeaderPaintLayer
+{
+public:
+    const char *name() const override { return "filter"; }
+    bool affects(const HeaderCellContext &cell) const override;
+    void paint(QPainter *painter, const HeaderCellContext &cell) const override;
+};
@@ -0,0 +1,187 @@
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "HeaderProfiler.h"
+
+HeaderProfiler::Scope::Scope(HeaderProfiler *profiler, Phase phase)
+    : m_profiler(profiler && profiler->m_enabled ? profiler : nullptr), m_phase(phase), m_start(m_profiler ? m_profiler->m_clock.nsecsElapsed() : 0)
+{
+}
+
+HeaderProfiler::Scope::~Scope()
+{
+    if (m_profiler)
+        m_profiler->record(m_phase, m_start, m_profiler->m_clock.nsecsElapsed() - m_start);
+}
+
+HeaderProfiler::HeaderProfiler()
+{
+    m_clock.start();
+}
+
+void HeaderProfiler::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+    m_current = Frame();
+}
+
+void HeaderProfiler::setTracing(bool tracing)
+{
+    m_tracing = tracing;
+}
+
+void HeaderProfiler::beginFrame()
+{
+    if (m_enabled)
+        m_frameStart = m_clock.nsecsElapsed();
+}
+
+void HeaderProfiler::endFrame()
+{
+    if (!m_enabled)
+        return;
+    const qint64 now = m_clock.nsecsElapsed();
+    m_current.frameNs = now - m_frameStart;
+    record(-1, m_frameStart, m_current.frameNs);
+
+    for (int i = 0; i < CounterCount; ++i)
+        m_total.counters[i] += m_current.counters[i];
+    for (int i = 0; i < PhaseCount; ++i)
+        m_total.phaseNs[i] += m_current.phaseNs[i];
+    m_total.frameNs += m_current.frameNs;
+    ++m_frames;
+
+    if (m_tracing && (int)m_frameCounters.size() < MaxTraceEvents)
+        m_frameCounters.emplace_back(now, m_current);
+    m_last = m_current;
+    m_current = Frame();
+}
+
+void HeaderProfiler::reset()
+{
+    m_current = Frame();
+    m_last = Frame();
+    m_total = Frame();
+    m_frames = 0;
+    m_events.clear();
+    m_frameCounters.clear();
+    m_droppedEvents = 0;
+}
+
+void HeaderProfiler::record(int phase, qint64 start, qint64 duration)
+{
+    if (phase >= 0)
+        m_current.phaseNs[phase] += duration;
+    if (!m_tracing)
+        return;
+    if ((int)m_events.size() >= MaxTraceEvents)
+    {
+        ++m_droppedEvents;
+        return;
+    }
+    m_events.push_back({phase, start, duration});
+}
+
+QString HeaderProfiler::summary() const
+{
+    auto ms = [](qint64 ns) { return QString::number(ns / 1e6, 'f', 2); };
+    QString text = QString("frame %1 ms").arg(ms(m_last.frameNs));
+    for (int i = 0; i < PhaseCount; ++i)
+    {
+        if (m_last.phaseNs[i] > 0)
+            text += QString(" | %1 %2").arg(phaseName(Phase(i))).arg(ms(m_last.phaseNs[i]));
+    }
+    for (int i = 0; i < CounterCount; ++i)
+        text += QString(" | %1 %2").arg(counterName(Counter(i))).arg(m_last.counters[i]);
+    return text;
+}
+
+bool HeaderProfiler::writeChromeTrace(const QString &path) const
+{
+    // 时间单位为微秒
+    QJsonArray events;
+    for (const TraceEvent &e : m_events)
+    {
+        QJsonObject event;
+        event["name"] = e.phase < 0 ? "frame" : phaseName(Phase(e.phase));
+        event["cat"] = "header";
+        event["ph"] = "X";
+        event["ts"] = e.start / 1000.0;
+        event["dur"] = e.duration / 1000.0;
+        event["pid"] = 1;
+        event["tid"] = 1;
+        events.append(event);
+    }
+    for (const auto &frame : m_frameCounters)
+    {
+        QJsonObject args;
+        for (int i = 0; i < CounterCount; ++i)
+            args[counterName(Counter(i))] = frame.second.counters[i];
+        QJsonObject event;
+        event["name"] = "counters";
+        event["cat"] = "header";
+        event["ph"] = "C";
+        event["ts"] = frame.first / 1000.0;
+        event["pid"] = 1;
+        event["args"] = args;
+        events.append(event);
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+    trace["droppedEvents"] = m_droppedEvents;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) >= 0;
+}
+
+const char *HeaderProfiler::counterName(Counter counter)
+{
+    switch (counter)
+    {
+    case SectionsPainted:
+        return "sections";
+    case CellsDrawn:
+        return "cells";
+    case DataCalls:
+        return "data";
+    case RootLookups:
+        return "roots";
+    case CellSetNodes:
+        return "set_nodes";
+    case LayersRun:
+        return "layers";
+    case CachedCells:
+        return "blits";
+    case TextCacheHits:
+        return "text_hits";
+    case TextCacheMisses:
+        return "text_misses";
+    default:
+        return "";
+    }
+}
+
+const char *HeaderProfiler::phaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case SpanLookupPhase:
+        return "span";
+    case StyleDrawPhase:
+        return "style";
+    case LayoutPhase:
+        return "layout";
+    case TablePaintPhase:
+        return "table";
+    default:
+        return "";
+    }
+}
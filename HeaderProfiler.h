@@ -0,0 +1,114 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <vector>
+
+// 表头的性能统计：每帧的计数器、各阶段耗时，可以导出为Chrome trace-event JSON
+// (chrome://tracing 或 Perfetto 打开)。默认关闭，关闭时每个统计点只有一次判断
+// 只在GUI线程中使用
+class HeaderProfiler
+{
+public:
+    enum Counter
+    {
+        SectionsPainted,
+        CellsDrawn,   // 绘制的(合并)单元格
+        DataCalls,    // 表头模型的data()调用
+        RootLookups,  // 查找合并单元格的根单元格
+        CellSetNodes, // 绘制路径上std::set<Cell>的节点数(每个节点一次堆分配，不是全部的分配)
+        LayersRun,    // 执行的绘制层
+        CachedCells,  // 直接贴缓存位图的普通单元格
+        TextCacheHits,   // StaticTextCache中已排版好的文本
+        TextCacheMisses, // 需要重新排版的文本
+        CounterCount
+    };
+
+    enum Phase
+    {
+        SpanLookupPhase, // 查找需要绘制的合并单元格及其矩形
+        StyleDrawPhase,  // QStyle绘制边框和文本
+        LayoutPhase,     // 尺寸变化写入前缀和、批量隐藏/显示
+        TablePaintPhase, // 表格视口的绘制（EwsTableView）
+        PhaseCount
+    };
+
+    struct Frame
+    {
+        qint64 counters[CounterCount] = {};
+        qint64 phaseNs[PhaseCount] = {};
+        qint64 frameNs = 0;
+    };
+
+    // 在作用域内计时，profiler为空或未启用时什么都不做
+    class Scope
+    {
+    public:
+        Scope(HeaderProfiler *profiler, Phase phase);
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        HeaderProfiler *m_profiler;
+        Phase m_phase;
+        qint64 m_start;
+    };
+
+    HeaderProfiler();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    // 启用时同时记录trace事件，最多MaxTraceEvents个
+    void setTracing(bool tracing);
+    bool isTracing() const { return m_tracing; }
+    void setOverlayVisible(bool visible) { m_overlay = visible; }
+    bool isOverlayVisible() const { return m_overlay; }
+
+    void count(Counter counter, qint64 n = 1)
+    {
+        if (m_enabled)
+            m_current.counters[counter] += n;
+    }
+
+    // 一帧是表头的一次paintEvent，两帧之间的计数（如sizeHint、命中测试）算入下一帧
+    void beginFrame();
+    void endFrame();
+
+    const Frame &lastFrame() const { return m_last; }
+    const Frame &total() const { return m_total; }
+    int frameCount() const { return m_frames; }
+    void reset();
+
+    // 上一帧的单行摘要，用于屏幕上的统计层
+    QString summary() const;
+    bool writeChromeTrace(const QString &path) const;
+
+    static const char *counterName(Counter counter);
+    static const char *phaseName(Phase phase);
+
+    static const int MaxTraceEvents = 1 << 20;
+
+private:
+    struct TraceEvent
+    {
+        int phase; // -1 为整帧
+        qint64 start;
+        qint64 duration;
+    };
+
+    void record(int phase, qint64 start, qint64 duration);
+
+    bool m_enabled = false;
+    bool m_tracing = false;
+    bool m_overlay = false;
+    QElapsedTimer m_clock;
+    qint64 m_frameStart = 0;
+    int m_frames = 0;
+    Frame m_current;
+    Frame m_last;
+    Frame m_total;
+    std::vector<TraceEvent> m_events;
+    std::vector<std::pair<qint64, Frame>> m_frameCounters; // 帧结束时间 -> 计数
+    qint64 m_droppedEvents = 0;
+};
@@ -0,0 +1,24 @@
+#include "HeaderSkinProvider.h"
+
+LocalSkinProvider::LocalSkinProvider(QObject *parent) : HeaderSkinProvider(parent)
+{
+}
+
+QString LocalSkinProvider::resourcePrefix() const
+{
+    return m_prefix;
+}
+
+QString LocalSkinProvider::skinId() const
+{
+    return m_skinId;
+}
+
+void LocalSkinProvider::setSkin(const QString &prefix, const QString &skinId)
+{
+    if (prefix == m_prefix && skinId == m_skinId)
+        return;
+    m_prefix = prefix;
+    m_skinId = skinId;
+    emit skinChanged();
+}
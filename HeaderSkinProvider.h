@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+// 表头的皮肤来源：图标缓存通过它得到当前皮肤，换肤时发出skinChanged。
+// 表头组件不依赖具体的皮肤框架，宿主程序实现这个接口(例如转发HCore的当前皮肤)并设置给HeaderIconCache
+class HeaderSkinProvider : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeaderSkinProvider(QObject *parent = nullptr) : QObject(parent) {}
+
+    // 图标文件为"<resourcePrefix>:<skinId>/<path>"，skinId为空时直接使用path
+    virtual QString resourcePrefix() const = 0;
+    virtual QString skinId() const = 0;
+
+signals:
+    void skinChanged();
+};
+
+// 默认实现：没有皮肤框架时使用，图标直接按路径加载，也可以手动指定前缀和皮肤
+class LocalSkinProvider : public HeaderSkinProvider
+{
+    Q_OBJECT
+public:
+    explicit LocalSkinProvider(QObject *parent = nullptr);
+
+    QString resourcePrefix() const override;
+    QString skinId() const override;
+    void setSkin(const QString &prefix, const QString &skinId);
+
+private:
+    QString m_prefix;
+    QString m_skinId;
+};
@@ -0,0 +1,539 @@
+#include <QDebug>
+
+#include "HeaderTree.h"
+#include "MultiLevelHeaderModel.h"
+#include "MultiLevelHeaderView.h"
+#include "data_model.h"
+
+HeaderNode::HeaderNode(const QString &text) : text(text)
+{
+}
+
+HeaderNode::~HeaderNode()
+{
+    qDeleteAll(children);
+}
+
+HeaderNode *HeaderNode::addChild(const QString &text)
+{
+    HeaderNode *child = new HeaderNode(text);
+    child->parent = this;
+    children.append(child);
+    return child;
+}
+
+int HeaderNode::level() const
+{
+    int l = -1;
+    for (const HeaderNode *p = parent; p; p = p->parent)
+        ++l;
+    return l;
+}
+
+int HeaderNode::childIndex() const
+{
+    return parent ? parent->children.indexOf(const_cast<HeaderNode *>(this)) : -1;
+}
+
+HeaderTree::HeaderTree(MultiLevelHeaderView *view, QObject *parent) : QObject(parent), m_view(view), m_root(new HeaderNode)
+{
+    // 根节点不显示，没有工具时不占用section
+    m_root->leafCount = 0;
+}
+
+HeaderTree::~HeaderTree()
+{
+    delete m_root;
+}
+
+HeaderNode *HeaderTree::root() const
+{
+    return m_root;
+}
+
+HeaderNode *HeaderTree::createToolNode(const ToolNode *tool)
+{
+    HeaderNode *node = new HeaderNode(tool->name);
+    addParams(node, tool->params_list, tool->params_dict);
+    return node;
+}
+
+void HeaderTree::addParams(HeaderNode *node, const QStringList &keys, const QVariantMap &params)
+{
+    for (const QString &key : keys)
+    {
+        HeaderNode *child = node->addChild(key);
+        // 参数值为QVariantMap时表示子参数
+        QVariant value = params.value(key);
+        if (value.type() == QVariant::Map)
+        {
+            QVariantMap subParams = value.toMap();
+            addParams(child, subParams.keys(), subParams);
+        }
+    }
+}
+
+int HeaderTree::updateLeafCounts(HeaderNode *node)
+{
+    if (node->children.isEmpty())
+    {
+        node->leafCount = 1;
+        return 1;
+    }
+    int count = 0;
+    for (HeaderNode *child : node->children)
+        count += updateLeafCounts(child);
+    node->leafCount = count;
+    return count;
+}
+
+int HeaderTree::depth(const HeaderNode *node)
+{
+    int deepest = 0;
+    for (const HeaderNode *child : node->children)
+        deepest = qMax(deepest, depth(child));
+    return deepest + 1;
+}
+
+bool HeaderTree::canInsert(const HeaderNode *parent, const HeaderNode *subtree) const
+{
+    if (!subtree)
+        return false;
+    const int parentLevel = (parent && parent != m_root) ? parent->level() : -1;
+    return parentLevel + depth(subtree) < m_view->levelCount();
+}
+
+int HeaderTree::firstSection(const HeaderNode *node) const
+{
+    int first = 0;
+    for (const HeaderNode *n = node; n && n->parent; n = n->parent)
+    {
+        for (const HeaderNode *sibling : n->parent->children)
+        {
+            if (sibling == n)
+                break;
+            first += sibling->leafCount;
+        }
+    }
+    return first;
+}
+
+HeaderNode *HeaderTree::nodeAt(int level, int section) const
+{
+    if (level < 0 || section < 0 || section >= m_root->leafCount)
+        return nullptr;
+
+    HeaderNode *node = m_root;
+    for (int l = 0; l <= level; ++l)
+    {
+        // 叶子节点向下一直延伸到最后一级
+        if (node->children.isEmpty())
+            return node;
+        HeaderNode *next = nullptr;
+        for (HeaderNode *child : node->children)
+        {
+            if (section < child->leafCount)
+            {
+                next = child;
+                break;
+            }
+            section -= child->leafCount;
+        }
+        if (!next)
+            return nullptr;
+        node = next;
+    }
+    return node;
+}
+
+QVector<QVector<int>> HeaderTree::collapsedPaths() const
+{
+    QVector<QVector<int>> paths;
+    QVector<int> path;
+    collectCollapsed(m_root, path, paths);
+    return paths;
+}
+
+void HeaderTree::collectCollapsed(const HeaderNode *node, QVector<int> &path, QVector<QVector<int>> &paths)
+{
+    if (node->collapsed)
+        paths.append(path);
+    for (int i = 0; i < node->children.size(); ++i)
+    {
+        path.append(i);
+        collectCollapsed(node->children[i], path, paths);
+        path.removeLast();
+    }
+}
+
+void HeaderTree::clearCollapsed(HeaderNode *node)
+{
+    node->collapsed = false;
+    for (HeaderNode *child : node->children)
+        clearCollapsed(child);
+}
+
+bool HeaderTree::canRestoreCollapsed(const QVector<QVector<int>> &paths) const
+{
+    for (const QVector<int> &path : paths)
+    {
+        const HeaderNode *node = nodeAtPath(path);
+        if (!node || node == m_root || node->children.isEmpty())
+            return false;
+    }
+    return true;
+}
+
+void HeaderTree::restoreCollapsed(const QVector<QVector<int>> &paths)
+{
+    clearCollapsed(m_root);
+    for (const QVector<int> &path : paths)
+    {
+        HeaderNode *node = nodeAtPath(path);
+        if (node && node != m_root)
+            node->collapsed = true;
+    }
+}
+
+QVector<int> HeaderTree::pathOf(const HeaderNode *node) const
+{
+    QVector<int> path;
+    for (const HeaderNode *n = node; n && n->parent; n = n->parent)
+        path.prepend(n->childIndex());
+    return path;
+}
+
+HeaderNode *HeaderTree::nodeAtPath(const QVector<int> &path) const
+{
+    HeaderNode *node = m_root;
+    for (int index : path)
+    {
+        if (index < 0 || index >= node->children.size())
+            return nullptr;
+        node = node->children[index];
+    }
+    return node;
+}
+
+void HeaderTree::setSectionText(int level, int section, const QString &text)
+{
+    if (m_view->orientation() == Qt::Horizontal)
+        m_view->setCellText(level, section, text);
+    else
+        m_view->setCellText(section, level, text);
+}
+
+void HeaderTree::applyNodeSpan(HeaderNode *node, int first)
+{
+    const int level = node->level();
+    const int levels = m_view->levelCount();
+    // 根节点；insertSubtree已拒绝超出级别数的子树
+    if (level < 0 || level >= levels)
+        return;
+
+    // 叶子节点纵向合并到最后一级
+    const int levelSpan = node->children.isEmpty() ? levels - level : 1;
+    if (m_view->orientation() == Qt::Horizontal)
+        m_view->setCellSpan(level, first, levelSpan, node->leafCount);
+    else
+        m_view->setCellSpan(first, level, node->leafCount, levelSpan);
+    setSectionText(level, first, node->text);
+}
+
+void HeaderTree::applySpans(HeaderNode *node, int first)
+{
+    applyNodeSpan(node, first);
+    int childFirst = first;
+    for (HeaderNode *child : node->children)
+    {
+        applySpans(child, childFirst);
+        childFirst += child->leafCount;
+    }
+}
+
+void HeaderTree::applyAncestorSpans(HeaderNode *node)
+{
+    for (HeaderNode *p = node; p && p != m_root; p = p->parent)
+        applyNodeSpan(p, firstSection(p));
+}
+
+bool HeaderTree::isHiddenByAncestors(const HeaderNode *node) const
+{
+    // 折叠的节点只显示第一列
+    for (const HeaderNode *n = node; n->parent; n = n->parent)
+    {
+        if (n->parent->collapsed && n->childIndex() > 0)
+            return true;
+    }
+    return false;
+}
+
+void HeaderTree::collectVisibility(const HeaderNode *node, bool hidden, std::vector<char> &states) const
+{
+    if (node->children.isEmpty())
+    {
+        states.push_back(hidden);
+        return;
+    }
+    for (int i = 0; i < node->children.size(); ++i)
+        collectVisibility(node->children[i], hidden || (node->collapsed && i > 0), states);
+}
+
+std::vector<char> HeaderTree::expandedVisibility(const HeaderNode *node) const
+{
+    std::vector<char> states;
+    states.reserve(node->leafCount);
+    for (const HeaderNode *child : node->children)
+        collectVisibility(child, false, states);
+    return states;
+}
+
+void HeaderTree::applyVisibility(HeaderNode *node, int first, bool hidden)
+{
+    std::vector<char> states;
+    states.reserve(node->leafCount);
+    collectVisibility(node, hidden, states);
+
+    // 合并成连续的区间，每个区间只做一次区间操作
+    int runStart = 0;
+    for (int i = 1; i <= (int)states.size(); ++i)
+    {
+        if (i == (int)states.size() || states[i] != states[runStart])
+        {
+            m_view->setSectionRangeHidden(first + runStart, i - runStart, states[runStart]);
+            runStart = i;
+        }
+    }
+}
+
+void HeaderTree::refreshVisibility(HeaderNode *node)
+{
+    // 只有位于折叠节点内部时可见性才会受影响，从最外层的折叠祖先开始重新计算
+    HeaderNode *top = nullptr;
+    for (HeaderNode *p = node; p && p != m_root; p = p->parent)
+    {
+        if (p->collapsed)
+            top = p;
+    }
+    if (top)
+        applyVisibility(top, firstSection(top), isHiddenByAncestors(top));
+}
+
+bool HeaderTree::insertSubtree(HeaderNode *parent, int pos, HeaderNode *subtree)
+{
+    if (!subtree)
+        return false;
+    if (!parent)
+        parent = m_root;
+    if (!canInsert(parent, subtree))
+    {
+        qInfo() << "HeaderTree insertSubtree" << subtree->text << "needs" << (parent == m_root ? 0 : parent->level() + 1) + depth(subtree) << "levels, header has" << m_view->levelCount();
+        return false;
+    }
+    pos = qBound(0, pos, parent->children.size());
+    updateLeafCounts(subtree);
+
+    if (m_updateDepth > 0)
+    {
+        // 只修改树，section和合并单元格留到endUpdate
+        if (parent != m_root && parent->children.isEmpty() && !m_batchSubtrees.contains(parent))
+            m_batchInherits.insert(parent);
+        const int inserted = (parent != m_root && parent->children.isEmpty()) ? subtree->leafCount - 1 : subtree->leafCount;
+        subtree->parent = parent;
+        parent->children.insert(pos, subtree);
+        for (HeaderNode *p = parent; p; p = p->parent)
+        {
+            p->leafCount += inserted;
+            m_batchDirty.insert(p);
+        }
+        m_batchSubtrees.insert(subtree);
+        return true;
+    }
+
+    // 父节点原来是叶子时，它占用的section留给子树的第一列
+    const bool parentWasLeaf = (parent != m_root && parent->children.isEmpty());
+    int first = firstSection(parent);
+    for (int i = 0; i < pos; ++i)
+        first += parent->children[i]->leafCount;
+    const int inserted = parentWasLeaf ? subtree->leafCount - 1 : subtree->leafCount;
+    const int insertAt = parentWasLeaf ? first + 1 : first;
+
+    subtree->parent = parent;
+    parent->children.insert(pos, subtree);
+    for (HeaderNode *p = parent; p; p = p->parent)
+        p->leafCount += inserted;
+
+    if (inserted > 0)
+    {
+        m_view->insertSections(insertAt, inserted);
+        emit sectionsInserted(insertAt, inserted);
+    }
+
+    // 只重新推导新子树和它的祖先，其余合并单元格只是被平移
+    applySpans(subtree, first);
+    applyAncestorSpans(parent);
+    refreshVisibility(subtree);
+    return true;
+}
+
+void HeaderTree::removeSubtree(HeaderNode *node)
+{
+    delete takeSubtree(node);
+}
+
+HeaderNode *HeaderTree::takeSubtree(HeaderNode *node)
+{
+    Q_ASSERT(m_updateDepth == 0);
+    if (!node || node == m_root || !node->parent)
+        return nullptr;
+
+    HeaderNode *parent = node->parent;
+    const int first = firstSection(node);
+    // 父节点失去最后一个子节点后变回叶子，保留一列给它
+    const bool parentBecomesLeaf = (parent != m_root && parent->children.size() == 1);
+    const int removed = parentBecomesLeaf ? node->leafCount - 1 : node->leafCount;
+    const int removeAt = parentBecomesLeaf ? first + 1 : first;
+
+    parent->children.removeOne(node);
+    for (HeaderNode *p = parent; p; p = p->parent)
+        p->leafCount -= removed;
+
+    if (removed > 0)
+    {
+        m_view->removeSections(removeAt, removed);
+        emit sectionsRemoved(removeAt, removed);
+    }
+
+    if (parentBecomesLeaf)
+    {
+        for (int level = parent->level() + 1; level < m_view->levelCount(); ++level)
+            setSectionText(level, first, QString());
+        m_view->setSectionRangeHidden(first, 1, isHiddenByAncestors(parent));
+    }
+    applyAncestorSpans(parent);
+    refreshVisibility(parent);
+    node->parent = nullptr;
+    return node;
+}
+
+void HeaderTree::beginUpdate()
+{
+    ++m_updateDepth;
+}
+
+void HeaderTree::collectInserted(const HeaderNode *node, bool inserted, bool inheritsSection, std::vector<char> &states) const
+{
+    inserted = inserted || m_batchSubtrees.contains(const_cast<HeaderNode *>(node));
+    if (node->children.isEmpty())
+    {
+        // 继承了父节点原有section的叶子不算新插入的
+        states.push_back(inserted && !inheritsSection);
+        return;
+    }
+    const bool inherits = inheritsSection || m_batchInherits.contains(const_cast<HeaderNode *>(node));
+    for (int i = 0; i < node->children.size(); ++i)
+        collectInserted(node->children[i], inserted, inherits && i == 0, states);
+}
+
+void HeaderTree::collectBatchSpans(HeaderNode *node, int first, bool inserted, QVector<RootCell> &cells, QVector<HeaderNode *> &nodes, QVector<int> &firsts) const
+{
+    inserted = inserted || m_batchSubtrees.contains(node);
+    if (!inserted && !m_batchDirty.contains(node))
+        return;
+
+    const int level = node->level();
+    const int levels = m_view->levelCount();
+    if (node != m_root && level < levels)
+    {
+        const int levelSpan = node->children.isEmpty() ? levels - level : 1;
+        RootCell cell;
+        cell.row = (m_view->orientation() == Qt::Horizontal) ? level : first;
+        cell.column = (m_view->orientation() == Qt::Horizontal) ? first : level;
+        cell.span.rowSpan = (m_view->orientation() == Qt::Horizontal) ? levelSpan : node->leafCount;
+        cell.span.columnSpan = (m_view->orientation() == Qt::Horizontal) ? node->leafCount : levelSpan;
+        cells.append(cell);
+        nodes.append(node);
+        firsts.append(first);
+    }
+    for (HeaderNode *child : node->children)
+    {
+        collectBatchSpans(child, first, inserted, cells, nodes, firsts);
+        first += child->leafCount;
+    }
+}
+
+void HeaderTree::endUpdate()
+{
+    if (m_updateDepth <= 0 || --m_updateDepth > 0)
+        return;
+    if (m_batchSubtrees.isEmpty())
+        return;
+
+    // 新section在最终位置上按从左到右的顺序插入，前面的段插入后后面的位置正好正确
+    std::vector<char> states;
+    states.reserve(m_root->leafCount);
+    collectInserted(m_root, false, false, states);
+    m_view->setUpdatesEnabled(false);
+    for (int i = 0; i < (int)states.size();)
+    {
+        if (!states[i])
+        {
+            ++i;
+            continue;
+        }
+        int runEnd = i;
+        while (runEnd < (int)states.size() && states[runEnd])
+            ++runEnd;
+        m_view->insertSections(i, runEnd - i);
+        emit sectionsInserted(i, runEnd - i);
+        i = runEnd;
+    }
+
+    // 新子树和跨度变化的祖先一次性设置合并单元格，其余的只是被平移
+    QVector<RootCell> cells;
+    QVector<HeaderNode *> nodes;
+    QVector<int> firsts;
+    collectBatchSpans(m_root, 0, false, cells, nodes, firsts);
+    m_view->setCellSpans(cells);
+    for (int i = 0; i < nodes.size(); ++i)
+        setSectionText(nodes[i]->level(), firsts[i], nodes[i]->text);
+
+    QSet<HeaderNode *> subtrees;
+    subtrees.swap(m_batchSubtrees);
+    m_batchInherits.clear();
+    m_batchDirty.clear();
+    for (HeaderNode *subtree : subtrees)
+        refreshVisibility(subtree);
+    m_view->setUpdatesEnabled(true);
+}
+
+void HeaderTree::setNodeText(HeaderNode *node, const QString &text)
+{
+    if (!node || node == m_root)
+        return;
+    node->text = text;
+    const int level = node->level();
+    if (level < m_view->levelCount())
+        setSectionText(level, firstSection(node), text);
+}
+
+void HeaderTree::setCollapsed(HeaderNode *node, bool collapsed, std::function<void()> done)
+{
+    if (!node || node == m_root || node->collapsed == collapsed || node->children.isEmpty())
+    {
+        if (done)
+            done();
+        return;
+    }
+    node->collapsed = collapsed;
+    // 被外层折叠隐藏时只记录状态，外层展开时再生效
+    if (isHiddenByAncestors(node))
+    {
+        if (done)
+            done();
+        return;
+    }
+
+    // 动画宽度和展开后的可见性都只算展开时可见的section，内部仍折叠的子节点保持隐藏
+    m_view->setSectionGroupCollapsed(firstSection(node), node->leafCount, collapsed, expandedVisibility(node), done);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+class MultiLevelHeaderView;
+struct RootCell;
+class ToolNode;
+
+// 表头树中的一个节点：工具 -> 参数 -> 子参数 ...
+// 叶子节点占一个section，非叶子节点横跨其所有叶子
+class HeaderNode
+{
+public:
+    explicit HeaderNode(const QString &text = QString());
+    ~HeaderNode();
+
+    // 只用于构建尚未插入到树中的子树
+    HeaderNode *addChild(const QString &text);
+    // tool nodes are on level 0
+    int level() const;
+    int childIndex() const;
+
+    QString text;
+    HeaderNode *parent = nullptr;
+    QList<HeaderNode *> children;
+    int leafCount = 1; // 子树占用的section数
+    bool collapsed = false;
+
+private:
+    Q_DISABLE_COPY(HeaderNode)
+};
+
+// 以树为准的多级表头：合并单元格和文本都由树推导出来
+// 插入/删除子树只更新受影响的section范围，折叠/展开只隐藏section，不重建表头。
+// 树的层数不能超过表头的级别数(构造MultiLevelHeaderView时固定)，更深的子树不能插入
+class HeaderTree : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeaderTree(MultiLevelHeaderView *view, QObject *parent = nullptr);
+    ~HeaderTree();
+
+    HeaderNode *root() const;
+    static HeaderNode *createToolNode(const ToolNode *tool);
+
+    // 插到parent下之后最深的节点仍在表头的级别数之内，parent == nullptr表示根节点
+    bool canInsert(const HeaderNode *parent, const HeaderNode *subtree) const;
+    // subtree is taken over by the tree, parent == nullptr means root
+    // 子树太深时不插入并返回false，subtree仍归调用者
+    bool insertSubtree(HeaderNode *parent, int pos, HeaderNode *subtree);
+    // 批量插入：beginUpdate/endUpdate之间的insertSubtree只修改树，endUpdate时
+    // 每段连续的新section只插入一次、发一次sectionsInserted，合并单元格一次性设置。
+    // 期间只能插入，可以嵌套
+    void beginUpdate();
+    void endUpdate();
+    void removeSubtree(HeaderNode *node);
+    // 与removeSubtree相同，但子树不删除而是交给调用者，可以再用insertSubtree插回去
+    HeaderNode *takeSubtree(HeaderNode *node);
+    void setNodeText(HeaderNode *node, const QString &text);
+    // done在折叠/展开的动画结束后调用(不需要动画时立即调用)
+    void setCollapsed(HeaderNode *node, bool collapsed, std::function<void()> done = nullptr);
+    // 所有折叠节点的路径，和表头布局一起保存
+    QVector<QVector<int>> collapsedPaths() const;
+    // 每条路径都指向当前树中的一个非叶子节点时才能恢复(树的形状与保存时一致)
+    bool canRestoreCollapsed(const QVector<QVector<int>> &paths) const;
+    // 只恢复折叠标记，section的隐藏状态和尺寸由MultiLevelHeaderView::restoreHeaderState恢复
+    void restoreCollapsed(const QVector<QVector<int>> &paths);
+
+    // 沿祖先累加左侧兄弟的leafCount，O(兄弟数×深度)；工具/参数通常只有几十个，没有缓存偏移
+    int firstSection(const HeaderNode *node) const;
+    // 覆盖(level, section)的节点，没有则返回nullptr
+    HeaderNode *nodeAt(int level, int section) const;
+    // 节点在树中的路径(每一层的childIndex)，根节点为空；撤销命令用路径而不是指针记录节点
+    QVector<int> pathOf(const HeaderNode *node) const;
+    HeaderNode *nodeAtPath(const QVector<int> &path) const;
+
+signals:
+    // 表头插入/删除了section，数据模型需要同步插入/删除列
+    void sectionsInserted(int first, int count);
+    void sectionsRemoved(int first, int count);
+
+private:
+    static int updateLeafCounts(HeaderNode *node);
+    // 子树的层数，叶子为1
+    static int depth(const HeaderNode *node);
+    static void addParams(HeaderNode *node, const QStringList &keys, const QVariantMap &params);
+    static void collectCollapsed(const HeaderNode *node, QVector<int> &path, QVector<QVector<int>> &paths);
+    static void clearCollapsed(HeaderNode *node);
+    void applyNodeSpan(HeaderNode *node, int first);
+    void applySpans(HeaderNode *node, int first);
+    void applyAncestorSpans(HeaderNode *node);
+    void collectVisibility(const HeaderNode *node, bool hidden, std::vector<char> &states) const;
+    // node本身展开时其下各section的隐藏状态(只考虑内部的折叠)
+    std::vector<char> expandedVisibility(const HeaderNode *node) const;
+    void applyVisibility(HeaderNode *node, int first, bool hidden);
+    bool isHiddenByAncestors(const HeaderNode *node) const;
+    void refreshVisibility(HeaderNode *node);
+    void setSectionText(int level, int section, const QString &text);
+    void collectInserted(const HeaderNode *node, bool inserted, bool inheritsSection, std::vector<char> &states) const;
+    void collectBatchSpans(HeaderNode *node, int first, bool inserted, QVector<RootCell> &cells, QVector<HeaderNode *> &nodes, QVector<int> &firsts) const;
+
+    MultiLevelHeaderView *m_view;
+    HeaderNode *m_root;
+    int m_updateDepth = 0;
+    QSet<HeaderNode *> m_batchSubtrees;  // 本批插入的子树
+    QSet<HeaderNode *> m_batchInherits;  // 原来是叶子的父节点，它的section留给第一个子节点
+    QSet<HeaderNode *> m_batchDirty;     // 跨度发生变化的祖先节点
+};
@@ -0,0 +1,49 @@
+#include "LabelTable.h"
+
+LabelTable::LabelTable()
+{
+    // id 0固定为空文本
+    m_ids.insert(QString(), 0);
+    m_texts.append(QString());
+}
+
+LabelTable *LabelTable::instance()
+{
+    static LabelTable table;
+    return &table;
+}
+
+int LabelTable::intern(const QString &text)
+{
+    if (text.isEmpty())
+        return 0;
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_ids.constFind(text);
+        if (it != m_ids.constEnd())
+            return it.value();
+    }
+    QWriteLocker locker(&m_lock);
+    // 换写锁期间其他线程可能已经插入
+    auto it = m_ids.constFind(text);
+    if (it != m_ids.constEnd())
+        return it.value();
+    int id = m_texts.size();
+    m_texts.append(text);
+    m_ids.insert(text, id);
+    return id;
+}
+
+QString LabelTable::text(int id) const
+{
+    QReadLocker locker(&m_lock);
+    if (id < 0 || id >= m_texts.size())
+        return QString();
+    return m_texts.at(id);
+}
+
+int LabelTable::count() const
+{
+    QReadLocker locker(&m_lock);
+    return m_texts.size();
+}
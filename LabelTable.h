@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+// 表头/单元格文本的字符串池：相同的文本只保存一份，用整数id代替字符串做缓存的key
+// 可以在多个线程中同时使用
+class LabelTable
+{
+public:
+    static LabelTable *instance();
+
+    // 返回文本的id，第一次出现时加入池中，之后不再释放；空文本的id为0
+    int intern(const QString &text);
+    // id无效时返回空文本
+    QString text(int id) const;
+    int count() const;
+
+private:
+    LabelTable();
+
+    mutable QReadWriteLock m_lock;
+    QHash<QString, int> m_ids;
+    QVector<QString> m_texts;
+};
@@ -0,0 +1,683 @@
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+#include <QSize>
+
+#include "HeaderProfiler.h"
+#include "MultiLevelHeaderModel.h"
+
+MultiLevelHeaderModel::MultiLevelHeaderModel(Qt::Orientation orientation, int rows, int cols, QObject *parent) : QAbstractTableModel(parent), m_orientation(orientation), m_rowCount(rows), m_columnCount(cols), m_defaultSectionSize(0)
+{
+    m_rowLayout.resize(rows, 0);
+    m_columnLayout.resize(cols, 0);
+    m_data.assign(levelCount(), std::vector<QMap<int, QVariant>>(sectionCount()));
+    m_spans.assign(levelCount(), std::vector<SpanEntry>());
+    m_checkedAny = SectionCounter(sectionCount());
+    m_checkedAll = SectionCounter(sectionCount());
+    m_filtered = SectionCounter(sectionCount());
+}
+
+MultiLevelHeaderModel::~MultiLevelHeaderModel()
+{
+}
+
+QModelIndex MultiLevelHeaderModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+        return QModelIndex();
+
+    return createIndex(row, column, nullptr);
+}
+
+int MultiLevelHeaderModel::rowCount(const QModelIndex &parent) const
+{
+    return m_rowCount;
+}
+int MultiLevelHeaderModel::columnCount(const QModelIndex &parent) const
+{
+    return m_columnCount;
+}
+
+int MultiLevelHeaderModel::levelOf(int row, int column) const
+{
+    return (m_orientation == Qt::Horizontal) ? row : column;
+}
+
+int MultiLevelHeaderModel::sectionOf(int row, int column) const
+{
+    return (m_orientation == Qt::Horizontal) ? column : row;
+}
+
+int MultiLevelHeaderModel::levelCount() const
+{
+    return (m_orientation == Qt::Horizontal) ? m_rowCount : m_columnCount;
+}
+
+int MultiLevelHeaderModel::sectionCount() const
+{
+    return (m_orientation == Qt::Horizontal) ? m_columnCount : m_rowCount;
+}
+
+QVariant MultiLevelHeaderModel::data(const QModelIndex &index, int role) const
+{
+    if (m_profiler)
+        m_profiler->count(HeaderProfiler::DataCalls);
+    if (!index.isValid())
+        return QVariant();
+
+    if (index.row() >= m_rowCount || index.row() < 0 || index.column() >= m_columnCount || index.column() < 0)
+        return QVariant();
+
+    const int level = levelOf(index.row(), index.column());
+    const int section = sectionOf(index.row(), index.column());
+    if (role == COLUMN_SPAN_ROLE || role == ROW_SPAN_ROLE)
+    {
+        // 只有合并单元格的左上角单元格才有跨度
+        CellSpan span = spanOf(index.row(), index.column());
+        if (!span.isValid())
+            return QVariant();
+        return (role == COLUMN_SPAN_ROLE) ? span.columnSpan : span.rowSpan;
+    }
+
+    const QMap<int, QVariant> &roles = m_data[level][section];
+    auto it = roles.find(role);
+    if (it != roles.end())
+        return it.value();
+
+    // default value
+    if (role == Qt::BackgroundRole)
+        // return QColor(0xcfcfcf);
+
+        if (role == Qt::SizeHintRole)
+        {
+            return QSize(m_columnLayout.size(index.column()), m_rowLayout.size(index.row()));
+        }
+    return QVariant();
+}
+
+bool MultiLevelHeaderModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (index.isValid())
+    {
+        if (role == COLUMN_SPAN_ROLE || role == ROW_SPAN_ROLE)
+        {
+            int span = value.toInt();
+            if (span > 0) // span size should be more than 1, else nothing to do
+            {
+                CellSpan current = spanOf(index.row(), index.column());
+                int rowSpanCount = current.isValid() ? current.rowSpan : 1;
+                int columnSpanCount = current.isValid() ? current.columnSpan : 1;
+                if (role == COLUMN_SPAN_ROLE)
+                    columnSpanCount = span;
+                else
+                    rowSpanCount = span;
+                setSpan(index.row(), index.column(), rowSpanCount, columnSpanCount);
+                emit dataChanged(index, index, QVector<int>() << role);
+            }
+            return true;
+        }
+
+        if (value.isValid())
+        {
+            if (role == Qt::SizeHintRole)
+            {
+                m_columnLayout.setSize(index.column(), value.toSize().width());
+                m_rowLayout.setSize(index.row(), value.toSize().height());
+            }
+            else
+            {
+                const int level = levelOf(index.row(), index.column());
+                const int section = sectionOf(index.row(), index.column());
+                m_data[level][section].insert(role, value);
+                if (level == levelCount() - 1 && role == Qt::CheckStateRole)
+                {
+                    const int state = value.toInt();
+                    m_checkedAny.set(section, state != Qt::Unchecked ? 1 : 0);
+                    m_checkedAll.set(section, state == Qt::Checked ? 1 : 0);
+                }
+                else if (level == levelCount() - 1 && role == FILTER_ROLE)
+                {
+                    m_filtered.set(section, value.toBool() ? 1 : 0);
+                }
+            }
+            // 视图按合并单元格换算出需要重绘的区域
+            emit dataChanged(index, index, QVector<int>() << role);
+        }
+        // 此处可以做一些数据置空的操作
+
+        return true;
+    }
+    return false;
+}
+
+Qt::ItemFlags MultiLevelHeaderModel::flags(const QModelIndex &index) const
+{
+    return Qt::NoItemFlags | QAbstractTableModel::flags(index);
+}
+
+QHash<int, QByteArray> MultiLevelHeaderModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractTableModel::roleNames();
+    roles.insert(Qt::BackgroundRole, "background");
+    roles.insert(Qt::ForegroundRole, "foreground");
+    roles.insert(Qt::SizeHintRole, "sizeHint");
+    roles.insert(COLUMN_SPAN_ROLE, "columnSpan");
+    roles.insert(ROW_SPAN_ROLE, "rowSpan");
+    return roles;
+}
+
+bool MultiLevelHeaderModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    if (m_orientation != Qt::Vertical || parent.isValid() || count <= 0 || row < 0 || row > m_rowCount)
+        return false;
+    beginInsertRows(QModelIndex(), row, row + count - 1);
+    insertSections(row, count);
+    endInsertRows();
+    return true;
+}
+
+bool MultiLevelHeaderModel::insertColumns(int column, int count, const QModelIndex &parent)
+{
+    if (m_orientation != Qt::Horizontal || parent.isValid() || count <= 0 || column < 0 || column > m_columnCount)
+        return false;
+    beginInsertColumns(QModelIndex(), column, column + count - 1);
+    insertSections(column, count);
+    endInsertColumns();
+    return true;
+}
+
+bool MultiLevelHeaderModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (m_orientation != Qt::Vertical || parent.isValid() || count <= 0 || row < 0 || row + count > m_rowCount)
+        return false;
+    beginRemoveRows(QModelIndex(), row, row + count - 1);
+    removeSections(row, count);
+    endRemoveRows();
+    return true;
+}
+
+bool MultiLevelHeaderModel::removeColumns(int column, int count, const QModelIndex &parent)
+{
+    if (m_orientation != Qt::Horizontal || parent.isValid() || count <= 0 || column < 0 || column + count > m_columnCount)
+        return false;
+    beginRemoveColumns(QModelIndex(), column, column + count - 1);
+    removeSections(column, count);
+    endRemoveColumns();
+    return true;
+}
+
+void MultiLevelHeaderModel::insertSections(int first, int count)
+{
+    for (auto &spans : m_spans)
+    {
+        // 结束位置在插入点之前的区间不受影响
+        auto it = std::upper_bound(spans.begin(), spans.end(), first, [](int section, const SpanEntry &e) { return section < e.start + e.sectionSpan; });
+        for (; it != spans.end(); ++it)
+        {
+            if (it->start >= first)
+                it->start += count;
+            else
+                it->sectionSpan += count; // 插入点在合并单元格内部，合并单元格随之变宽
+        }
+    }
+    for (auto &roles : m_data)
+        roles.insert(roles.begin() + first, count, QMap<int, QVariant>());
+    m_checkedAny.insert(first, count);
+    m_checkedAll.insert(first, count);
+    m_filtered.insert(first, count);
+
+    if (m_orientation == Qt::Horizontal)
+    {
+        m_columnLayout.insert(first, count, m_defaultSectionSize);
+        m_columnCount += count;
+    }
+    else
+    {
+        m_rowLayout.insert(first, count, m_defaultSectionSize);
+        m_rowCount += count;
+    }
+}
+
+void MultiLevelHeaderModel::removeSections(int first, int count)
+{
+    const int last = first + count;
+    for (auto &spans : m_spans)
+    {
+        auto it = std::upper_bound(spans.begin(), spans.end(), first, [](int section, const SpanEntry &e) { return section < e.start + e.sectionSpan; });
+        auto out = it;
+        for (; it != spans.end(); ++it)
+        {
+            SpanEntry e = *it;
+            const int end = e.start + e.sectionSpan;
+            if (e.start >= last)
+            {
+                e.start -= count;
+            }
+            else
+            {
+                // 与删除范围重叠：保留左右两侧剩下的部分
+                int remaining = std::max(0, std::min(end, first) - e.start) + std::max(0, end - last);
+                if (remaining <= 0)
+                    continue;
+                e.start = std::min(e.start, first);
+                e.sectionSpan = remaining;
+            }
+            *out++ = e;
+        }
+        spans.erase(out, spans.end());
+    }
+    for (auto &roles : m_data)
+        roles.erase(roles.begin() + first, roles.begin() + last);
+    m_checkedAny.remove(first, count);
+    m_checkedAll.remove(first, count);
+    m_filtered.remove(first, count);
+
+    if (m_orientation == Qt::Horizontal)
+    {
+        m_columnLayout.remove(first, count);
+        m_columnCount -= count;
+    }
+    else
+    {
+        m_rowLayout.remove(first, count);
+        m_rowCount -= count;
+    }
+}
+
+void MultiLevelHeaderModel::setRowHeight(int row, int size)
+{
+    if (row >= 0 && row < m_rowCount)
+    {
+        m_rowLayout.setSize(row, size);
+        emit dataChanged(index(row, 0), index(row, m_columnCount - 1), QVector<int>() << Qt::SizeHintRole);
+    }
+}
+
+int MultiLevelHeaderModel::getRowHeight(int row) const
+{
+    if (row >= 0 && row < m_rowCount)
+        return m_rowLayout.size(row);
+    return 0;
+}
+
+void MultiLevelHeaderModel::setColumnWidth(int col, int size)
+{
+    if (col >= 0 && col < m_columnCount)
+    {
+        m_columnLayout.setSize(col, size);
+        emit dataChanged(index(0, col), index(m_rowCount - 1, col), QVector<int>() << Qt::SizeHintRole);
+    }
+}
+
+int MultiLevelHeaderModel::getColumnWidth(int col) const
+{
+    if (col >= 0 && col < m_columnCount)
+        return m_columnLayout.size(col);
+    return 0;
+}
+
+void MultiLevelHeaderModel::setRowHeights(const QMap<int, int> &sizes)
+{
+    int first = m_rowCount, last = -1;
+    for (auto it = sizes.cbegin(); it != sizes.cend(); ++it)
+    {
+        if (it.key() < 0 || it.key() >= m_rowCount)
+            continue;
+        m_rowLayout.setSize(it.key(), it.value());
+        first = qMin(first, it.key());
+        last = qMax(last, it.key());
+    }
+    if (last >= 0)
+        emit dataChanged(index(first, 0), index(last, m_columnCount - 1), QVector<int>() << Qt::SizeHintRole);
+}
+
+void MultiLevelHeaderModel::setColumnWidths(const QMap<int, int> &sizes)
+{
+    int first = m_columnCount, last = -1;
+    for (auto it = sizes.cbegin(); it != sizes.cend(); ++it)
+    {
+        if (it.key() < 0 || it.key() >= m_columnCount)
+            continue;
+        m_columnLayout.setSize(it.key(), it.value());
+        first = qMin(first, it.key());
+        last = qMax(last, it.key());
+    }
+    if (last >= 0)
+        emit dataChanged(index(0, first), index(m_rowCount - 1, last), QVector<int>() << Qt::SizeHintRole);
+}
+
+int MultiLevelHeaderModel::rowPosition(int row) const
+{
+    return m_rowLayout.position(row);
+}
+
+int MultiLevelHeaderModel::columnPosition(int col) const
+{
+    return m_columnLayout.position(col);
+}
+
+int MultiLevelHeaderModel::rowSpanHeight(int from, int spanCount) const
+{
+    return m_rowLayout.extent(from, spanCount);
+}
+
+int MultiLevelHeaderModel::columnSpanWidth(int from, int spanCount) const
+{
+    return m_columnLayout.extent(from, spanCount);
+}
+
+int MultiLevelHeaderModel::rowAt(int y) const
+{
+    return m_rowLayout.indexAt(y);
+}
+
+int MultiLevelHeaderModel::columnAt(int x) const
+{
+    return m_columnLayout.indexAt(x);
+}
+
+void MultiLevelHeaderModel::setDefaultSectionSize(int size)
+{
+    m_defaultSectionSize = size;
+}
+
+void MultiLevelHeaderModel::setSectionsHidden(int first, int count, bool hidden)
+{
+    SectionLayout &layout = (m_orientation == Qt::Horizontal) ? m_columnLayout : m_rowLayout;
+    layout.setHidden(first, count, hidden);
+}
+
+bool MultiLevelHeaderModel::isSectionHidden(int section) const
+{
+    const SectionLayout &layout = (m_orientation == Qt::Horizontal) ? m_columnLayout : m_rowLayout;
+    return layout.isHidden(section);
+}
+
+int MultiLevelHeaderModel::sectionRawExtent(int first, int count) const
+{
+    const SectionLayout &layout = (m_orientation == Qt::Horizontal) ? m_columnLayout : m_rowLayout;
+    return layout.rawExtent(first, count);
+}
+
+int MultiLevelHeaderModel::sectionSize(int section) const
+{
+    const SectionLayout &layout = (m_orientation == Qt::Horizontal) ? m_columnLayout : m_rowLayout;
+    return layout.size(section);
+}
+
+bool MultiLevelHeaderModel::setSectionLayout(const std::vector<int> &sizes, const std::vector<char> &hidden)
+{
+    if (int(sizes.size()) != sectionCount() || int(hidden.size()) != sectionCount())
+        return false;
+    SectionLayout &layout = (m_orientation == Qt::Horizontal) ? m_columnLayout : m_rowLayout;
+    layout.reset(sizes, hidden);
+    return true;
+}
+
+const MultiLevelHeaderModel::SpanEntry *MultiLevelHeaderModel::findSpan(int level, int section) const
+{
+    if (level < 0 || level >= (int)m_spans.size())
+        return nullptr;
+    const std::vector<SpanEntry> &spans = m_spans[level];
+    // 最后一个起点 <= section 的区间
+    auto it = std::upper_bound(spans.begin(), spans.end(), section, [](int s, const SpanEntry &e) { return s < e.start; });
+    if (it == spans.begin())
+        return nullptr;
+    --it;
+    return (section < it->start + it->sectionSpan) ? &*it : nullptr;
+}
+
+void MultiLevelHeaderModel::removeSpan(SpanEntry entry)
+{
+    for (int level = entry.rootLevel; level < entry.rootLevel + entry.levelSpan && level < (int)m_spans.size(); ++level)
+    {
+        std::vector<SpanEntry> &spans = m_spans[level];
+        auto it = std::lower_bound(spans.begin(), spans.end(), entry.start, [](const SpanEntry &e, int section) { return e.start < section; });
+        if (it != spans.end() && it->start == entry.start && it->rootLevel == entry.rootLevel)
+            spans.erase(it);
+    }
+}
+
+void MultiLevelHeaderModel::setSpan(int row, int column, int rowSpanCount, int columnSpanCount)
+{
+    if (row < 0 || row >= m_rowCount || column < 0 || column >= m_columnCount)
+        return;
+    // span size should be less than whole rows/columns
+    rowSpanCount = qMin(rowSpanCount, m_rowCount - row);
+    columnSpanCount = qMin(columnSpanCount, m_columnCount - column);
+    if (rowSpanCount <= 0 || columnSpanCount <= 0)
+        return;
+
+    const bool horizontal = (m_orientation == Qt::Horizontal);
+    SpanEntry entry;
+    entry.rootLevel = horizontal ? row : column;
+    entry.start = horizontal ? column : row;
+    entry.levelSpan = horizontal ? rowSpanCount : columnSpanCount;
+    entry.sectionSpan = horizontal ? columnSpanCount : rowSpanCount;
+    const int end = entry.start + entry.sectionSpan;
+
+    // 被新区域覆盖的旧合并单元格整个移除（包括它在其他级别上的部分）
+    std::vector<SpanEntry> overlapped;
+    for (int level = entry.rootLevel; level < entry.rootLevel + entry.levelSpan; ++level)
+    {
+        const std::vector<SpanEntry> &spans = m_spans[level];
+        auto it = std::upper_bound(spans.begin(), spans.end(), entry.start, [](int section, const SpanEntry &e) { return section < e.start + e.sectionSpan; });
+        for (; it != spans.end() && it->start < end; ++it)
+            overlapped.push_back(*it);
+    }
+    for (const SpanEntry &e : overlapped)
+        removeSpan(e);
+
+    for (int level = entry.rootLevel; level < entry.rootLevel + entry.levelSpan; ++level)
+    {
+        std::vector<SpanEntry> &spans = m_spans[level];
+        auto it = std::lower_bound(spans.begin(), spans.end(), entry.start, [](const SpanEntry &e, int section) { return e.start < section; });
+        spans.insert(it, entry);
+    }
+}
+
+void MultiLevelHeaderModel::setSpans(const QVector<RootCell> &cells)
+{
+    const bool horizontal = (m_orientation == Qt::Horizontal);
+    std::vector<SpanEntry> added;
+    added.reserve(cells.size());
+    for (const RootCell &cell : cells)
+    {
+        if (cell.row < 0 || cell.row >= m_rowCount || cell.column < 0 || cell.column >= m_columnCount)
+            continue;
+        const int rowSpanCount = qMin(cell.span.rowSpan, m_rowCount - cell.row);
+        const int columnSpanCount = qMin(cell.span.columnSpan, m_columnCount - cell.column);
+        if (rowSpanCount <= 0 || columnSpanCount <= 0)
+            continue;
+        SpanEntry entry;
+        entry.rootLevel = horizontal ? cell.row : cell.column;
+        entry.start = horizontal ? cell.column : cell.row;
+        entry.levelSpan = horizontal ? rowSpanCount : columnSpanCount;
+        entry.sectionSpan = horizontal ? columnSpanCount : rowSpanCount;
+        added.push_back(entry);
+    }
+    if (added.empty())
+        return;
+    std::sort(added.begin(), added.end(), [](const SpanEntry &a, const SpanEntry &b) { return a.start < b.start; });
+
+    // 被覆盖的旧合并单元格，用根单元格(rootLevel, start)标识
+    std::set<std::pair<int, int>> removed;
+    for (const SpanEntry &entry : added)
+    {
+        const int end = entry.start + entry.sectionSpan;
+        for (int level = entry.rootLevel; level < entry.rootLevel + entry.levelSpan; ++level)
+        {
+            const std::vector<SpanEntry> &spans = m_spans[level];
+            auto it = std::upper_bound(spans.begin(), spans.end(), entry.start, [](int section, const SpanEntry &e) { return section < e.start + e.sectionSpan; });
+            for (; it != spans.end() && it->start < end; ++it)
+                removed.insert(std::make_pair(it->rootLevel, it->start));
+        }
+    }
+
+    // 逐级重建：去掉被覆盖的，再与新的区间按起点归并
+    for (int level = 0; level < levelCount(); ++level)
+    {
+        std::vector<SpanEntry> levelAdded;
+        for (const SpanEntry &entry : added)
+        {
+            if (entry.rootLevel <= level && level < entry.rootLevel + entry.levelSpan)
+                levelAdded.push_back(entry);
+        }
+        if (levelAdded.empty() && removed.empty())
+            continue;
+
+        std::vector<SpanEntry> kept;
+        kept.reserve(m_spans[level].size());
+        for (const SpanEntry &entry : m_spans[level])
+        {
+            if (!removed.count(std::make_pair(entry.rootLevel, entry.start)))
+                kept.push_back(entry);
+        }
+        std::vector<SpanEntry> merged;
+        merged.reserve(kept.size() + levelAdded.size());
+        std::merge(kept.begin(), kept.end(), levelAdded.begin(), levelAdded.end(), std::back_inserter(merged), [](const SpanEntry &a, const SpanEntry &b) { return a.start < b.start; });
+        m_spans[level].swap(merged);
+    }
+}
+
+QVector<RootCell> MultiLevelHeaderModel::spans() const
+{
+    QVector<RootCell> cells;
+    for (int level = 0; level < levelCount(); ++level)
+    {
+        for (const SpanEntry &entry : m_spans[level])
+        {
+            if (entry.rootLevel != level)
+                continue;
+            RootCell cell;
+            const bool horizontal = (m_orientation == Qt::Horizontal);
+            cell.row = horizontal ? entry.rootLevel : entry.start;
+            cell.column = horizontal ? entry.start : entry.rootLevel;
+            cell.span.rowSpan = horizontal ? entry.levelSpan : entry.sectionSpan;
+            cell.span.columnSpan = horizontal ? entry.sectionSpan : entry.levelSpan;
+            cells.append(cell);
+        }
+    }
+    return cells;
+}
+
+void MultiLevelHeaderModel::clearSpans()
+{
+    for (std::vector<SpanEntry> &spans : m_spans)
+        spans.clear();
+}
+
+bool MultiLevelHeaderModel::getRootCell(int row, int column, int &rootCellRow, int &rootCellColumn) const
+{
+    RootCell root = rootOf(row, column);
+    if (!root.isValid())
+        return false;
+    rootCellRow = root.row;
+    rootCellColumn = root.column;
+    return true;
+}
+
+CellSpan MultiLevelHeaderModel::spanOf(int row, int column) const
+{
+    if (row < 0 || row >= m_rowCount || column < 0 || column >= m_columnCount)
+        return CellSpan();
+    const int level = levelOf(row, column);
+    const int section = sectionOf(row, column);
+    const SpanEntry *entry = findSpan(level, section);
+    if (!entry || entry->start != section || entry->rootLevel != level)
+        return CellSpan();
+
+    CellSpan span;
+    span.rowSpan = (m_orientation == Qt::Horizontal) ? entry->levelSpan : entry->sectionSpan;
+    span.columnSpan = (m_orientation == Qt::Horizontal) ? entry->sectionSpan : entry->levelSpan;
+    return span;
+}
+
+RootCell MultiLevelHeaderModel::rootOf(int row, int column) const
+{
+    if (m_profiler)
+        m_profiler->count(HeaderProfiler::RootLookups);
+    if (row < 0 || row >= m_rowCount || column < 0 || column >= m_columnCount)
+        return RootCell();
+    const SpanEntry *entry = findSpan(levelOf(row, column), sectionOf(row, column));
+    if (!entry)
+        return RootCell();
+
+    RootCell root;
+    if (m_orientation == Qt::Horizontal)
+    {
+        root.row = entry->rootLevel;
+        root.column = entry->start;
+        root.span.rowSpan = entry->levelSpan;
+        root.span.columnSpan = entry->sectionSpan;
+    }
+    else
+    {
+        root.row = entry->start;
+        root.column = entry->rootLevel;
+        root.span.rowSpan = entry->sectionSpan;
+        root.span.columnSpan = entry->levelSpan;
+    }
+    return root;
+}
+
+Qt::CheckState MultiLevelHeaderModel::sectionCheckState(int first, int last) const
+{
+    if (m_checkedAny.sum(first, last) == 0)
+        return Qt::Unchecked;
+    const int count = qMin(last, sectionCount() - 1) - qMax(first, 0) + 1;
+    return (m_checkedAll.sum(first, last) == count) ? Qt::Checked : Qt::PartiallyChecked;
+}
+
+int MultiLevelHeaderModel::filteredSectionCount() const
+{
+    return m_filtered.total();
+}
+
+void MultiLevelHeaderModel::setProfiler(HeaderProfiler *profiler)
+{
+    m_profiler = profiler;
+}
+
+bool MultiLevelHeaderModel::checkInvariants(QString *error) const
+{
+    auto fail = [error](const QString &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    const int levels = levelCount();
+    const int sections = sectionCount();
+    if (m_rowLayout.count() != m_rowCount || m_columnLayout.count() != m_columnCount)
+        return fail(QString("layout has %1x%2 sections, model is %3x%4").arg(m_rowLayout.count()).arg(m_columnLayout.count()).arg(m_rowCount).arg(m_columnCount));
+    if ((int)m_data.size() != levels || (int)m_spans.size() != levels)
+        return fail(QString("%1 levels but %2 data / %3 span levels").arg(levels).arg(m_data.size()).arg(m_spans.size()));
+
+    for (int level = 0; level < levels; ++level)
+    {
+        if ((int)m_data[level].size() != sections)
+            return fail(QString("level %1 stores data for %2 of %3 sections").arg(level).arg(m_data[level].size()).arg(sections));
+
+        int end = 0;
+        for (const SpanEntry &e : m_spans[level])
+        {
+            if (e.sectionSpan <= 0 || e.levelSpan <= 0)
+                return fail(QString("level %1: empty span at section %2").arg(level).arg(e.start));
+            if (e.start < end)
+                return fail(QString("level %1: span at section %2 overlaps the previous one").arg(level).arg(e.start));
+            if (e.start + e.sectionSpan > sections)
+                return fail(QString("level %1: span at section %2 ends after the last section").arg(level).arg(e.start));
+            if (level < e.rootLevel || level >= e.rootLevel + e.levelSpan || e.rootLevel + e.levelSpan > levels)
+                return fail(QString("level %1: span at section %2 claims levels [%3, %4)").arg(level).arg(e.start).arg(e.rootLevel).arg(e.rootLevel + e.levelSpan));
+
+            // 跨多个级别的合并单元格在每一级都要有完全相同的记录
+            const SpanEntry *root = findSpan(e.rootLevel, e.start);
+            if (!root || root->start != e.start || root->sectionSpan != e.sectionSpan || root->rootLevel != e.rootLevel || root->levelSpan != e.levelSpan)
+                return fail(QString("level %1: span at section %2 differs from its root level %3").arg(level).arg(e.start).arg(e.rootLevel));
+            end = e.start + e.sectionSpan;
+        }
+    }
+    return true;
+}
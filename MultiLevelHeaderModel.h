@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QMap>
+#include <QVector>
+#include <QVariant>
+
+#include "SectionCounter.h"
+#include "SectionLayout.h"
+
+class HeaderProfiler;
+
+enum ItemDataRole
+{
+    COLUMN_SPAN_ROLE = Qt::UserRole + 1,
+    ROW_SPAN_ROLE,
+    FILTER_ROLE,     // 最后一级单元格上，bool，该section设置了过滤条件
+};
+
+struct Cell
+{
+    Cell(int r, int c) : row(r), column(c) {}
+    int row = 0;
+    int column = 0;
+    bool operator<(const Cell &oth) const
+    {
+        if (row < oth.row)
+            return true;
+        if (row == oth.row)
+            return column < oth.column;
+        return false;
+    }
+};
+
+// 合并单元格的跨度，不是根单元格时为0
+struct CellSpan
+{
+    int rowSpan = 0;
+    int columnSpan = 0;
+    bool isValid() const { return rowSpan > 0 && columnSpan > 0; }
+};
+
+// 覆盖某个单元格的合并单元格：左上角(根)单元格和跨度
+struct RootCell
+{
+    int row = -1;
+    int column = -1;
+    CellSpan span;
+    bool isValid() const { return row >= 0; }
+};
+
+// 多级表头的数据模型
+// 水平表头每一行是一个级别(level)、每一列是一个section；竖直表头正好相反
+// 合并单元格按级别保存为有序的区间表，查找所属合并单元格是 O(log n)，
+// 插入/删除section时只需要平移区间的起点，不需要逐个单元格重写
+class MultiLevelHeaderModel : public QAbstractTableModel
+{
+public:
+    MultiLevelHeaderModel(Qt::Orientation orientation, int rows, int cols, QObject *parent = 0);
+    virtual ~MultiLevelHeaderModel();
+
+public:
+    // override
+    virtual QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    virtual QVariant data(const QModelIndex &index, int role) const override;
+    virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    virtual Qt::ItemFlags flags(const QModelIndex &index) const override;
+    virtual QHash<int, QByteArray> roleNames() const override;
+    // 只能插入/删除section：水平表头为列，竖直表头为行
+    virtual bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    virtual bool insertColumns(int column, int count, const QModelIndex &parent = QModelIndex()) override;
+    virtual bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    virtual bool removeColumns(int column, int count, const QModelIndex &parent = QModelIndex()) override;
+
+    void setRowHeight(int row, int size);
+    int getRowHeight(int row) const;
+    void setColumnWidth(int col, int size);
+    int getColumnWidth(int col) const;
+    // 批量设置尺寸，只发一次dataChanged
+    void setRowHeights(const QMap<int, int> &sizes);
+    void setColumnWidths(const QMap<int, int> &sizes);
+    int rowPosition(int row) const;
+    int columnPosition(int col) const;
+    int rowSpanHeight(int from, int spanCount) const;
+    int columnSpanWidth(int from, int spanCount) const;
+    // 坐标所在的行/列，O(log n)，超出范围返回-1
+    int rowAt(int y) const;
+    int columnAt(int x) const;
+    // 新插入section的尺寸
+    void setDefaultSectionSize(int size);
+    // 隐藏/显示一段连续的section，O(log n)，section保留原来的尺寸
+    void setSectionsHidden(int first, int count, bool hidden);
+    bool isSectionHidden(int section) const;
+    // 不考虑隐藏时[first, first + count)的尺寸之和
+    int sectionRawExtent(int first, int count) const;
+    // 不考虑隐藏时section的尺寸
+    int sectionSize(int section) const;
+    // 一次替换所有section的尺寸和隐藏状态，数量必须与section数相同，只重建一次前缀和
+    bool setSectionLayout(const std::vector<int> &sizes, const std::vector<char> &hidden);
+
+    // 合并(row, column)开始的单元格，被覆盖的旧合并单元格会被整个移除
+    void setSpan(int row, int column, int rowSpanCount, int columnSpanCount);
+    // 批量合并：每一级的区间表只重建一次。cells之间不能重叠，被覆盖的旧合并单元格同样整个移除
+    void setSpans(const QVector<RootCell> &cells);
+    // 所有合并单元格，按级别、起点排序；跨多级的只出现一次
+    QVector<RootCell> spans() const;
+    void clearSpans();
+    bool getRootCell(int row, int column, int &rootCellRow, int &rootCellColumn) const;
+    // 直接从区间表读取，不经过QVariant和虚函数，表头内部使用；
+    // COLUMN_SPAN_ROLE/ROW_SPAN_ROLE只是给外部调用者的兼容接口
+    CellSpan spanOf(int row, int column) const;
+    RootCell rootOf(int row, int column) const;
+
+    // 最后一级单元格上Qt::CheckStateRole的汇总：全部选中、全部未选中或部分选中，O(log n)
+    Qt::CheckState sectionCheckState(int first, int last) const;
+    // 最后一级单元格上FILTER_ROLE为true的section数
+    int filteredSectionCount() const;
+
+    // 检查内部数据结构的一致性：区间表有序且互不重叠、跨级别的合并单元格在每一级都有记录、
+    // 尺寸和数据的维度与行列数一致。不一致时返回false，error中是第一个问题
+    bool checkInvariants(QString *error = nullptr) const;
+
+    // data()和根单元格查找的调用次数计入profiler，为空时不统计
+    void setProfiler(HeaderProfiler *profiler);
+
+private:
+    struct SpanEntry
+    {
+        int start;       // 左上角单元格所在的section
+        int sectionSpan;
+        int rootLevel;   // 左上角单元格所在的级别
+        int levelSpan;
+    };
+
+    int levelOf(int row, int column) const;
+    int sectionOf(int row, int column) const;
+    int levelCount() const;
+    int sectionCount() const;
+    const SpanEntry *findSpan(int level, int section) const;
+    void removeSpan(SpanEntry entry);
+    void insertSections(int first, int count);
+    void removeSections(int first, int count);
+
+    Qt::Orientation m_orientation;
+    int m_rowCount;
+    int m_columnCount;
+    int m_defaultSectionSize;
+    SectionLayout m_rowLayout;
+    SectionLayout m_columnLayout;
+    std::vector<std::vector<QMap<int, QVariant>>> m_data; // [level][section]
+    std::vector<std::vector<SpanEntry>> m_spans;          // [level]，按start排序且互不重叠
+    // 最后一级上的检查/过滤状态计数，随section插入/删除
+    SectionCounter m_checkedAny;  // 检查状态不是Unchecked
+    SectionCounter m_checkedAll;  // 检查状态是Checked
+    SectionCounter m_filtered;
+    HeaderProfiler *m_profiler = nullptr;
+};
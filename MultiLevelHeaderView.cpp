@@ -1,239 +1,72 @@
+#include <algorithm>
+#include <limits>
 #include <set>
 
-#include <QAbstractTableModel>
 #include <QMap>
 #include <QPainter>
 #include <QMouseEvent>
 #include <QVariant>
 #include <QBrush>
+#include <QDataStream>
 #include <qdrawutil.h>
 #include <QDebug>
+#include <QFontMetrics>
+#include <QHash>
 #include <QPixmap>
-#include <QVBoxLayout>
-#include <QLineEdit>
-#include <QDialog>
-#include <QLabel>
-#include <QPushButton>
-#include <QMessageBox>
-
+#include <QStyle>
+#include <QVarLengthArray>
+#include <QWindow>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include "HeaderIconCache.h"
+#include "HeaderInlineEditor.h"
+#include "HeaderPaintLayers.h"
 #include "MultiLevelHeaderView.h"
+#include "MultiLevelHeaderModel.h"
+#include "RoleProfilingProxyModel.h"
+#include "TextMetricsCache.h"
 
-struct Cell
-{
-    Cell(int r, int c) : row(r), column(c) {}
-    int row = 0;
-    int column = 0;
-    bool operator<(const Cell &oth) const
-    {
-        if (row < oth.row)
-            return true;
-        if (row == oth.row)
-            return column < oth.column;
-        return false;
-    }
-};
-
-class MultiLevelHeaderModel : public QAbstractTableModel
-{
-public:
-    MultiLevelHeaderModel(Qt::Orientation orientation, int rows, int cols, QObject *parent = 0);
-    virtual ~MultiLevelHeaderModel();
-
-public:
-    // override
-    virtual QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
-    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const override;
-    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const override;
-    virtual QVariant data(const QModelIndex &index, int role) const override;
-    virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
-    virtual Qt::ItemFlags flags(const QModelIndex &index) const override;
-    void setRowHeight(int row, int size);
-    int getRowHeight(int row) const;
-    void setColumnWidth(int col, int size);
-    int getColumnWidth(int col) const;
-    void setRootCell(int row, int column, int rootRow, int rootColumn);
-    bool getRootCell(int row, int column, int &rootCellRow, int &rootCellColumn) const;
-
-private:
-    Qt::Orientation m_orientation;
-    int m_rowCount;
-    int m_columnCount;
-    std::vector<int> m_rowSizes;
-    std::vector<int> m_columnSizes;
-    QMap<Cell, QMap<int, QVariant>> m_data;
-    QMap<QString, Cell> m_rootCellMap;
-};
-
-MultiLevelHeaderModel::MultiLevelHeaderModel(Qt::Orientation orientation, int rows, int cols, QObject *parent) : QAbstractTableModel(parent), m_orientation(orientation), m_rowCount(rows), m_columnCount(cols)
-{
-    m_rowSizes.resize(rows, 0);
-    m_columnSizes.resize(cols, 0);
-}
-
-MultiLevelHeaderModel::~MultiLevelHeaderModel()
+namespace
 {
-}
+const quint32 HeaderStateMagic = 0x4d4c4853; // "MLHS"
+const quint8 HeaderStateVersion = 1;
 
-QModelIndex MultiLevelHeaderModel::index(int row, int column, const QModelIndex &parent) const
+// 游程编码：(值, 长度)对
+template <typename Value>
+void writeRuns(QDataStream &out, int count, Value value)
 {
-    if (!hasIndex(row, column, parent))
-        return QModelIndex();
-
-    return createIndex(row, column, nullptr);
-}
-
-int MultiLevelHeaderModel::rowCount(const QModelIndex &parent) const
-{
-    return m_rowCount;
-}
-int MultiLevelHeaderModel::columnCount(const QModelIndex &parent) const
-{
-    return m_columnCount;
-}
-
-QVariant MultiLevelHeaderModel::data(const QModelIndex &index, int role) const
-{
-    if (!index.isValid())
-        return QVariant();
-
-    if (index.row() >= m_rowCount || index.row() < 0 || index.column() >= m_columnCount || index.column() < 0)
-        return QVariant();
-
-    auto it = m_data.find(Cell(index.row(), index.column()));
-    if (it != m_data.end())
+    QVector<qint32> runs;
+    for (int i = 0; i < count;)
     {
-        auto it2 = it.value().find(role);
-        if (it2 != it.value().end())
-            return it2.value();
+        const int v = value(i);
+        int j = i + 1;
+        while (j < count && value(j) == v)
+            ++j;
+        runs << v << (j - i);
+        i = j;
     }
-
-    // default value
-    if (role == Qt::BackgroundRole)
-        // return QColor(0xcfcfcf);
-
-        if (role == Qt::SizeHintRole)
-        {
-            return QSize(m_columnSizes[index.column()], m_rowSizes[index.row()]);
-        }
-    return QVariant();
+    out << qint32(runs.size() / 2);
+    for (qint32 x : runs)
+        out << x;
 }
 
-bool MultiLevelHeaderModel::setData(const QModelIndex &index, const QVariant &value, int role)
+// 值超出[minValue, maxValue]时返回false
+bool readRuns(QDataStream &in, int count, int minValue, int maxValue, std::vector<int> &values)
 {
-    if (index.isValid())
+    qint32 runCount = 0;
+    in >> runCount;
+    values.clear();
+    values.reserve(count);
+    for (int r = 0; r < runCount && in.status() == QDataStream::Ok; ++r)
     {
-        QVariant value2;
-        if (role == COLUMN_SPAN_ROLE)
-        {
-            int col = index.column();
-            int span = value.toInt();
-            if (span > 0) // span size should be more than 1, else nothing to do
-            {
-                if (col + span - 1 >= m_columnCount) // span size should be less than whole columns,
-                    span = m_columnCount - col;
-                value2 = span;
-            }
-        }
-        else if (role == ROW_SPAN_ROLE)
-        {
-            int row = index.row();
-            int span = value.toInt();
-            if (span > 0) // span size should be more than 1, else nothing to do
-            {
-                if (row + span - 1 >= m_rowCount)
-                    span = m_rowCount - row;
-                value2 = span;
-            }
-        }
-        else
-        {
-            value2 = value;
-        }
-        if (value.isValid())
-        {
-            if (role == Qt::SizeHintRole)
-            {
-                m_columnSizes[index.column()] = value.toSize().width();
-                m_rowSizes[index.row()] = value.toSize().height();
-            }
-            else
-            {
-                for(auto it = m_data.begin(); it != m_data.end(); ++it)
-                {
-                    if (it.key().row == index.row() && it.key().column == index.column())
-                    {
-                        auto it2 = it.value().find(role);
-                        if (it2 != it.value().end())
-                        {
-                            it.value().insert(role, value2);
-                            return true;
-                        }
-                    }
-                }
-                auto &map = m_data[Cell(index.row(), index.column())];
-                map.insert(role, value2);
-            }
-        }
-        // 此处可以做一些数据置空的操作
-
-        return true;
+        qint32 v = 0, length = 0;
+        in >> v >> length;
+        if (length <= 0 || int(values.size()) + length > count || v < minValue || v > maxValue)
+            return false;
+        values.insert(values.end(), length, v);
     }
-    return false;
+    return in.status() == QDataStream::Ok && int(values.size()) == count;
 }
-
-Qt::ItemFlags MultiLevelHeaderModel::flags(const QModelIndex &index) const
-{
-    return Qt::NoItemFlags | QAbstractTableModel::flags(index);
-}
-
-void MultiLevelHeaderModel::setRowHeight(int row, int size)
-{
-    if (row >= 0 && row < m_rowCount)
-    {
-        m_rowSizes[row] = size;
-        emit dataChanged(index(row, 0), index(row, m_columnCount - 1), QVector<int>() << Qt::SizeHintRole);
-    }
-}
-
-int MultiLevelHeaderModel::getRowHeight(int row) const
-{
-    if (row >= 0 && row < m_rowCount)
-        return m_rowSizes[row];
-    return 0;
-}
-
-void MultiLevelHeaderModel::setColumnWidth(int col, int size)
-{
-    if (col >= 0 && col < m_columnCount)
-    {
-        m_columnSizes[col] = size;
-        emit dataChanged(index(0, col), index(m_rowCount - 1, col), QVector<int>() << Qt::SizeHintRole);
-    }
-}
-
-int MultiLevelHeaderModel::getColumnWidth(int col) const
-{
-    if (col >= 0 && col < m_columnCount)
-        return m_columnSizes[col];
-    return 0;
-}
-
-void MultiLevelHeaderModel::setRootCell(int row, int column, int rootRow, int rootColumn)
-{
-    QString key = QString("%1,%2").arg(row).arg(column);
-    Cell rc{rootRow, rootColumn};
-    m_rootCellMap.insert(key, rc);
-}
-
-bool MultiLevelHeaderModel::getRootCell(int row, int column, int &rootCellRow, int &rootCellColumn) const
-{
-    QString key = QString("%1,%2").arg(row).arg(column);
-    auto it = m_rootCellMap.find(key);
-    if (it == m_rootCellMap.end())
-        return false;
-    rootCellRow = it.value().row;
-    rootCellColumn = it.value().column;
-    return true;
 }
 
 MultiLevelHeaderView::MultiLevelHeaderView(Qt::Orientation orientation, int rows, int columns, QWidget *parent) : QHeaderView(orientation, parent)
@@ -257,11 +90,49 @@ MultiLevelHeaderView::MultiLevelHeaderView(Qt::Orientation orientation, int rows
         for (int col = 0; col < columns; ++col)
             m->setColumnWidth(col, defaultSectionSize());
     }
+    else
+    {
+        // 竖直表头每一级占一列，section是行
+        for (int col = 0; col < columns; ++col)
+            m->setColumnWidth(col, 32);
+        for (int row = 0; row < rows; ++row)
+            m->setRowHeight(row, defaultSectionSize());
+    }
 
+    m->setDefaultSectionSize(defaultSectionSize());
+    m->setProfiler(&m_profiler);
     setModel(m);
 
     connect(this, SIGNAL(sectionResized(int, int, int)), this, SLOT(onSectionResized(int, int, int)));
 
+    // 拖动列宽时按帧合并处理
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setInterval(16);
+    connect(&m_frameTimer, &QTimer::timeout, this, &MultiLevelHeaderView::flushPendingResize);
+    connect(&m_frameTimer, &QTimer::timeout, this, &MultiLevelHeaderView::flushDirtyCells);
+
+    // 折叠/展开动画
+    m_groupAnimation.setDuration(200);
+    m_groupAnimation.setEasingCurve(QEasingCurve::OutCubic);
+    connect(&m_groupAnimation, &QVariantAnimation::finished, this, [this]() {
+        std::function<void()> done;
+        std::swap(done, m_groupAnimationDone);
+        if (done)
+            done();
+    });
+
+    // 添加工具/参数的输入条，只创建一次
+    m_editor = new HeaderInlineEditor(this);
+    connect(m_editor, &HeaderInlineEditor::committed, this, &MultiLevelHeaderView::on_editor_committed);
+
+    // 绘制层，顺序即绘制顺序
+    m_layers << new HeaderBackgroundLayer << new HeaderLabelLayer << new HeaderSortIndicatorLayer
+             << new HeaderCheckBoxLayer << new HeaderFilterBadgeLayer << new HeaderBorderLayer;
+    m_cellCache.setMaxCost(16 * 1024);
+
+    // 换肤后图标缓存已清空，先按新皮肤预加载再重绘
+    connect(HeaderIconCache::instance(), &HeaderIconCache::skinChanged, this, &MultiLevelHeaderView::preloadIcons);
+
     init_tool_menu();
 
     init_param_menu();
@@ -269,6 +140,8 @@ MultiLevelHeaderView::MultiLevelHeaderView(Qt::Orientation orientation, int rows
 
 MultiLevelHeaderView::~MultiLevelHeaderView()
 {
+    qDeleteAll(m_layers);
+    delete m_editor;
     MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
     if (m)
         delete m;
@@ -278,7 +151,11 @@ MultiLevelHeaderView::~MultiLevelHeaderView()
 void MultiLevelHeaderView::setRowHeight(int row, int rowHeight)
 {
     MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
-    resizeSection(row, rowHeight);
+    m->setRowHeight(row, rowHeight);
+    if (orientation() == Qt::Vertical)
+        resizeSection(row, rowHeight);
+    else
+        levelSizeChanged();
 }
 
 void MultiLevelHeaderView::setColumnWidth(int col, int colWidth)
@@ -287,6 +164,17 @@ void MultiLevelHeaderView::setColumnWidth(int col, int colWidth)
     m->setColumnWidth(col, colWidth);
     if (orientation() == Qt::Horizontal)
         resizeSection(col, colWidth);
+    else
+        levelSizeChanged();
+}
+
+void MultiLevelHeaderView::levelSizeChanged()
+{
+    // 级别的尺寸决定了整个表头的高度（竖直表头为宽度），让QHeaderView重新计算sizeHint
+    if (count() > 0)
+        headerDataChanged(orientation(), 0, 0);
+    updateGeometry();
+    viewport()->update();
 }
 
 void MultiLevelHeaderView::setCellData(int row, int column, int role, const QVariant &value)
@@ -300,19 +188,143 @@ void MultiLevelHeaderView::setCellSpan(int row, int column, int rowSpanCount, in
     Q_ASSERT(rowSpanCount > 0);
     Q_ASSERT(columnSpanCount > 0);
     MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
-    QModelIndex idx = m->index(row, column);
-    m->setData(idx, rowSpanCount, ROW_SPAN_ROLE);
-    m->setData(idx, columnSpanCount, COLUMN_SPAN_ROLE);
-    int lastRow = row + rowSpanCount;
-    int lastCol = column + columnSpanCount;
-    for (int i = row; i < lastRow; ++i)
-    {
-        for (int j = column; j < lastCol; ++j)
+    m->setSpan(row, column, rowSpanCount, columnSpanCount);
+}
+
+void MultiLevelHeaderView::setCellSpans(const QVector<RootCell> &cells)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    m->setSpans(cells);
+}
+
+int MultiLevelHeaderView::levelCount() const
+{
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    return (orientation() == Qt::Horizontal) ? m->rowCount() : m->columnCount();
+}
+
+void MultiLevelHeaderView::shiftPendingSizes(int first, int delta)
+{
+    // 拖动中还没处理的尺寸跟着section移动，key >= first的整体平移delta
+    QMap<int, int> shifted;
+    for (auto it = m_pendingSizes.cbegin(); it != m_pendingSizes.cend(); ++it)
+        shifted.insert(it.key() >= first ? it.key() + delta : it.key(), it.value());
+    m_pendingSizes.swap(shifted);
+}
+
+void MultiLevelHeaderView::insertSections(int first, int count)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    shiftPendingSizes(first, count);
+    if (orientation() == Qt::Horizontal)
+        m->insertColumns(first, count);
+    else
+        m->insertRows(first, count);
+}
+
+void MultiLevelHeaderView::removeSections(int first, int count)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    // 被删除section的尺寸变化不需要再处理
+    for (int i = first; i < first + count; ++i)
+        m_pendingSizes.remove(i);
+    shiftPendingSizes(first + count, -count);
+    if (orientation() == Qt::Horizontal)
+        m->removeColumns(first, count);
+    else
+        m->removeRows(first, count);
+}
+
+void MultiLevelHeaderView::setSectionRangeHidden(int first, int count, bool hidden)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    first = qMax(first, 0);
+    count = qMin(count, this->count() - first);
+    if (count <= 0)
+        return;
+
+    HeaderProfiler::Scope scope(&m_profiler, HeaderProfiler::LayoutPhase);
+    // 前缀和上一次区间操作，模型中保留各section原来的尺寸
+    m->setSectionsHidden(first, count, hidden);
+
+    // QHeaderView没有批量接口，逐个设置但关掉重绘，也不再逐个更新前缀和
+    m_batchLayout = true;
+    setUpdatesEnabled(false);
+    for (int i = first; i < first + count; ++i)
+        setSectionHidden(i, hidden);
+    setUpdatesEnabled(true);
+    m_batchLayout = false;
+}
+
+void MultiLevelHeaderView::setSectionGroupCollapsed(int first, int count, bool collapsed, const std::vector<char> &expandedHidden, std::function<void()> done)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    // 上一个动画直接跳到结束状态
+    if (m_groupAnimation.state() == QAbstractAnimation::Running)
+        m_groupAnimation.setCurrentTime(m_groupAnimation.duration());
+    if (count <= 1)
+    {
+        if (done)
+            done();
+        return;
+    }
+
+    // 展开状态下组内的可见区间，内部折叠子组隐藏的section不计入宽度
+    QVector<QPair<int, int>> visibleRuns;
+    int groupSize = sectionSize(first);
+    auto isHidden = [&expandedHidden](int i) { return i < int(expandedHidden.size()) && expandedHidden[i]; };
+    for (int i = 1; i < count;)
+    {
+        const bool hidden = isHidden(i);
+        int end = i + 1;
+        while (end < count && isHidden(end) == hidden)
+            ++end;
+        if (!hidden)
+        {
+            visibleRuns.append(qMakePair(first + i, end - i));
+            groupSize += m->sectionRawExtent(first + i, end - i);
+        }
+        i = end;
+    }
+
+    const int summarySize = sectionSize(first);
+    if (collapsed)
+    {
+        // 先隐藏其余section并让汇总列占满整组，再把汇总列收缩回原来的宽度
+        setSectionRangeHidden(first + 1, count - 1, true);
+        if (groupSize <= summarySize)
         {
-            m->setRootCell(i, j, row, column);
-            // qDebug() << "i=" << i << "j:" << j << "row:" << row << "column:" << column;
+            if (done)
+                done();
+            return;
         }
+        resizeSection(first, groupSize);
+        m_groupAnimation.setStartValue(groupSize);
+        m_groupAnimation.setEndValue(summarySize);
+        m_groupAnimationDone = [this, first, summarySize, done]() {
+            resizeSection(first, summarySize);
+            if (done)
+                done();
+        };
+    }
+    else
+    {
+        // 汇总列先展开到整组的宽度，结束时再换回各个section，内部仍折叠的子组保持隐藏
+        m_groupAnimation.setStartValue(summarySize);
+        m_groupAnimation.setEndValue(groupSize);
+        m_groupAnimationDone = [this, first, summarySize, visibleRuns, done]() {
+            resizeSection(first, summarySize);
+            for (const auto &run : visibleRuns)
+                setSectionRangeHidden(run.first, run.second, false);
+            if (done)
+                done();
+        };
     }
+    disconnect(&m_groupAnimation, &QVariantAnimation::valueChanged, this, nullptr);
+    connect(&m_groupAnimation, &QVariantAnimation::valueChanged, this, [this, first](const QVariant &value) {
+        resizeSection(first, value.toInt());
+    });
+    m_groupAnimation.start();
 }
 
 void MultiLevelHeaderView::setCellBackgroundColor(int row, int column, const QColor &color)
@@ -339,8 +351,30 @@ void MultiLevelHeaderView::setCellIcon(int row, int column, const QIcon &icon)
     m->setData(m->index(row, column), icon, Qt::DecorationRole);
 }
 
+void MultiLevelHeaderView::setCellIcon(int row, int column, const QString &iconPath)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    m_iconPaths.insert(iconPath);
+    HeaderIconCache::instance()->preload(iconPath, style()->pixelMetric(QStyle::PM_SmallIconSize, nullptr, this), devicePixelRatioF());
+    m->setData(m->index(row, column), iconPath, Qt::DecorationRole);
+}
+
+void MultiLevelHeaderView::preloadIcons()
+{
+    HeaderIconCache *cache = HeaderIconCache::instance();
+    const int extent = style()->pixelMetric(QStyle::PM_SmallIconSize, nullptr, this);
+    const qreal dpr = devicePixelRatioF();
+    for (const QString &path : m_iconPaths)
+        cache->preload(path, extent, dpr);
+    m_cellCache.clear();
+    viewport()->update();
+}
+
 void MultiLevelHeaderView::mousePressEvent(QMouseEvent *event)
 {
+    RoleProfilingProxyModel::PhaseScope phase(m_roleProfiler, "mouse");
+    if (event->button() == Qt::LeftButton)
+        m_pressPos = event->pos();
     QHeaderView::mousePressEvent(event);
     QPoint pos = event->pos();
     QModelIndex index = indexAt(pos);
@@ -388,10 +422,10 @@ void MultiLevelHeaderView::mousePressEvent(QMouseEvent *event)
                     if (beginSection <= logicalIdx && logicalIdx <= endSection)
                     {
                         int beginLevel = (orient == Qt::Horizontal) ? cellIndex.row() : cellIndex.column();
-                        QVariant levelSpanCnt = cellIndex.data((orient == Qt::Horizontal) ? ROW_SPAN_ROLE : COLUMN_SPAN_ROLE);
-                        if (!levelSpanCnt.isValid())
+                        CellSpan span = m->spanOf(cellIndex.row(), cellIndex.column());
+                        if (!span.isValid())
                             continue;
-                        int endLevel = beginLevel + levelSpanCnt.toInt() - 1;
+                        int endLevel = beginLevel + ((orient == Qt::Horizontal) ? span.rowSpan : span.columnSpan) - 1;
                         if (beginLevel <= curLevel && curLevel <= endLevel)
                         {
                             emit sectionPressed(beginSection, endSection);
@@ -408,38 +442,21 @@ QModelIndex MultiLevelHeaderView::indexAt(const QPoint &pos) const
 {
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
     const int orient = orientation();
-    const int ROWS = m->rowCount();
-    const int COLS = m->columnCount();
     int logicalIdx = logicalIndexAt(pos);
+    if (logicalIdx < 0)
+        return QModelIndex();
 
+    // 级别方向用前缀和二分查找，section方向由QHeaderView查找
     if (orient == Qt::Horizontal)
     {
-        int dY = 0;
-        for (int row = 0; row < ROWS; ++row)
-        {
-            dY += m->getRowHeight(row);
-            if (pos.y() <= dY)
-            {
-                QModelIndex cellIndex = m->index(row, logicalIdx);
-                return cellIndex;
-            }
-        }
+        int row = m->rowAt(pos.y());
+        return row >= 0 ? m->index(row, logicalIdx) : QModelIndex();
     }
     else
     {
-        int dX = 0;
-        for (int col = 0; col < COLS; ++col)
-        {
-            dX += m->getColumnWidth(col);
-            if (pos.x() <= dX)
-            {
-                QModelIndex cellIndex = m->index(logicalIdx, col);
-                return cellIndex;
-            }
-        }
+        int col = m->columnAt(pos.x());
+        return col >= 0 ? m->index(logicalIdx, col) : QModelIndex();
     }
-
-    return QModelIndex();
 }
 
 std::set<Cell> getCellsToBeDrawn(const MultiLevelHeaderView *view, const MultiLevelHeaderModel *m, int orient, int levelCount, int logicalIdx)
@@ -462,63 +479,26 @@ void MultiLevelHeaderView::paintSection(QPainter *painter, const QRect &rect, in
 #if 1
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
     const int orient = orientation();
-    const int levelCount = m->rowCount();
-    std::set<Cell> cellsToBeDrawn = getCellsToBeDrawn(this, m, orient, levelCount, logicalIdx);
+    const int levelCount = (orient == Qt::Horizontal) ? m->rowCount() : m->columnCount();
+    RoleProfilingProxyModel::PhaseScope phase(m_roleProfiler, "paint");
+    m_profiler.count(HeaderProfiler::SectionsPainted);
+    std::set<Cell> cellsToBeDrawn;
+    {
+        HeaderProfiler::Scope scope(&m_profiler, HeaderProfiler::SpanLookupPhase);
+        cellsToBeDrawn = getCellsToBeDrawn(this, m, orient, levelCount, logicalIdx);
+    }
+    m_profiler.count(HeaderProfiler::CellSetNodes, cellsToBeDrawn.size());
 
     for (const auto &cell : cellsToBeDrawn)
     {
-        QRect sectionRect = getCellRect(cell.row, cell.column);
-        // sectionRect.setHeight(sectionRect.height()+20);
-        qInfo() << "paintSection row:"<< cell.row << ", col:" << cell.column;
-        // draw section with style
-        QStyleOptionHeader sectionStyle;
-        initStyleOption(&sectionStyle);
-        sectionStyle.textAlignment = Qt::AlignCenter;
-        sectionStyle.section = logicalIdx;
-        if (cell.row == 0)
+        m_profiler.count(HeaderProfiler::CellsDrawn);
+        HeaderCellContext context;
         {
-            // sectionStyle.iconAlignment = Qt::AlignVCenter | Qt::AlignCenter;
-            // QPixmap pixmap;
-            // pixmap.load("eDevice.png");
-            // qInfo() << "ttttttttttttttttttttt:" << pixmap.isNull();
-            // pixmap = pixmap.scaled(64, 64, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-            // sectionStyle.icon = QIcon("");
-            // sectionStyle.icon = QIcon("eDevice.png");
-            // sectionStyle.icon = QIcon(pixmap);
-            // sectionStyle.iconAlignment = Qt::AlignVCenter | Qt::AlignCenter;
+            HeaderProfiler::Scope scope(&m_profiler, HeaderProfiler::SpanLookupPhase);
+            initCellContext(context, cell.row, cell.column);
         }
-        // add by hqh
-        if (cell.row == 1)
-        {
-            sectionStyle.textAlignment = Qt::AlignCenter;
-        }
-
-        QModelIndex cellIndex = m->index(cell.row, cell.column);
-
-        sectionStyle.text = cellIndex.data(Qt::DisplayRole).toString();
-        sectionStyle.rect = sectionRect;
-
-        // file background or foreground color of the cell
-        //        QVariant bg = cellIndex.data(Qt::BackgroundRole);
-        //        QVariant fg = cellIndex.data(Qt::ForegroundRole);
-
-        //        if (bg.canConvert(QVariant::Brush))
-        //        {
-        //            sectionStyle.palette.setBrush(QPalette::Button, qvariant_cast<QBrush>(bg));
-        //            sectionStyle.palette.setBrush(QPalette::Window, qvariant_cast<QBrush>(bg));
-        //        }
-        //        if (fg.canConvert(QVariant::Brush))
-        //        {
-        //            sectionStyle.palette.setBrush(QPalette::ButtonText, qvariant_cast<QBrush>(fg));
-        //        }
-
-        painter->save();
-        //        sectionStyle.rect.setHeight(sectionStyle.rect.height()+20);
-        qDrawShadePanel(painter, sectionStyle.rect, sectionStyle.palette, false, 1, &sectionStyle.palette.brush(QPalette::Button));
-        //        painter->drawRect(sectionStyle.rect);
-        style()->drawControl(QStyle::CE_HeaderLabel, &sectionStyle, painter, this);
-        //         style()->drawControl(QStyle::CE_HeaderLabel, &opt, painter, this);
-        painter->restore();
+        HeaderProfiler::Scope scope(&m_profiler, HeaderProfiler::StyleDrawPhase);
+        drawCell(painter, context);
     }
 
 #else
@@ -537,85 +517,42 @@ void MultiLevelHeaderView::paintSection(QPainter *painter, const QRect &rect, in
 QSize MultiLevelHeaderView::sectionSizeFromContents(int logicalIdx) const
 {
     const MultiLevelHeaderModel *m = static_cast<const MultiLevelHeaderModel *>(this->model());
-    const int orient = orientation();
-    const int levelCount = (orient == Qt::Horizontal) ? m->rowCount() : m->columnCount();
 
-    int w = 0, h = 0;
-    if (orient == Qt::Horizontal)
-    {
-        w = m->getColumnWidth(logicalIdx);
-        for (int i = 0; i < levelCount; ++i)
-        {
-            h += m->getRowHeight(i);
-        }
-    }
-    else
-    {
-        for (int i = 0; i < levelCount; ++i)
-        {
-            w += m->getColumnWidth(i);
-        }
-        h = m->getRowHeight(logicalIdx);
-    }
-    return QSize(w, h);
+    // 各级别尺寸之和直接取前缀和的根节点，不再逐级累加
+    if (orientation() == Qt::Horizontal)
+        return QSize(m->getColumnWidth(logicalIdx), m->rowSpanHeight(0, m->rowCount()));
+    return QSize(m->columnSpanWidth(0, m->columnCount()), m->getRowHeight(logicalIdx));
 }
 
 QModelIndex MultiLevelHeaderView::columnSpanIndex(const QModelIndex &currentIdx) const
 {
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
-    const int curRow = currentIdx.row();
-    const int curCol = currentIdx.column();
-    int i = curCol;
-    while (i >= 0)
-    {
-        QModelIndex spanIndex = m->index(curRow, i);
-        QVariant span = spanIndex.data(COLUMN_SPAN_ROLE);
-        if (span.isValid() && spanIndex.column() + span.toInt() - 1 >= curCol)
-            return spanIndex;
-        i--;
-    }
-    return QModelIndex();
+    // 合并单元格互不重叠，覆盖当前单元格的只有一个，它的根在同一行时才是列方向的合并
+    RootCell root = m->rootOf(currentIdx.row(), currentIdx.column());
+    if (!root.isValid() || root.row != currentIdx.row())
+        return QModelIndex();
+    return m->index(root.row, root.column);
 }
 
 QModelIndex MultiLevelHeaderView::rowSpanIndex(const QModelIndex &currentIdx) const
 {
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
-    const int curRow = currentIdx.row();
-    const int curCol = currentIdx.column();
-    int i = curRow;
-    while (i >= 0)
-    {
-        QModelIndex spanIndex = m->index(i, curCol);
-        QVariant span = spanIndex.data(ROW_SPAN_ROLE);
-        if (span.isValid() && spanIndex.row() + span.toInt() - 1 >= curRow)
-            return spanIndex;
-        i--;
-    }
-    return QModelIndex();
+    RootCell root = m->rootOf(currentIdx.row(), currentIdx.column());
+    if (!root.isValid() || root.column != currentIdx.column())
+        return QModelIndex();
+    return m->index(root.row, root.column);
 }
 
 int MultiLevelHeaderView::columnSpanSize(int row, int from, int spanCount) const
 {
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
-    int span = 0;
-    for (int i = from; i < from + spanCount; ++i)
-    {
-        int colWidth = m->getColumnWidth(i);
-        span += colWidth;
-    }
-    return span;
+    return m->columnSpanWidth(from, spanCount);
 }
 
 int MultiLevelHeaderView::rowSpanSize(int column, int from, int spanCount) const
 {
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
-    int span = 0;
-    for (int i = from; i < from + spanCount; ++i)
-    {
-        int rowHeight = m->getRowHeight(i);
-        span += rowHeight;
-    }
-    return span;
+    return m->rowSpanHeight(from, spanCount);
 }
 
 bool MultiLevelHeaderView::getRootCell(int row, int column, int &rootCellRow, int &rootCellColumn) const
@@ -628,25 +565,21 @@ QRect MultiLevelHeaderView::getCellRect(int row, int column) const
 {
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
     const int orient = orientation();
-    QModelIndex cellIndex = m->index(row, column);
-    auto colSpanVar = cellIndex.data(COLUMN_SPAN_ROLE);
-    auto rowSpanVar = cellIndex.data(ROW_SPAN_ROLE);
-    //    Q_ASSERT(colSpanVar.isValid() && rowSpanVar.isValid());
-    int colSpan = colSpanVar.toInt();
-    int rowSpan = rowSpanVar.toInt();
+    CellSpan span = m->spanOf(row, column);
+    //    Q_ASSERT(span.isValid());
+    int colSpan = span.columnSpan;
+    int rowSpan = span.rowSpan;
     int w = 0, h = 0, l = 0, t = 0;
     w = columnSpanSize(row, column, colSpan);
     h = rowSpanSize(column, row, rowSpan);
     if (orient == Qt::Horizontal)
     {
         l = sectionViewportPosition(column);
-        for (int i = 0; i < row; ++i)
-            t += m->getRowHeight(i);
+        t = m->rowPosition(row);
     }
     else
     {
-        for (int i = 0; i < column; ++i)
-            l += m->getColumnWidth(i);
+        l = m->columnPosition(column);
         t = sectionViewportPosition(row);
     }
 
@@ -659,16 +592,14 @@ QRect MultiLevelHeaderView::getCellRect(int row, int column) const
  */
 int MultiLevelHeaderView::getSectionRange(QModelIndex &index, int *beginSection, int *endSection) const
 {
-    int row = index.row(), column = index.column();
-    int rootRow, rootCol;
-    bool success = getRootCell(row, column, rootRow, rootCol);
-    if (!success)
-        return 0;
     const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
-    QModelIndex rootIndex = m->index(rootRow, rootCol);
+    RootCell root = m->rootOf(index.row(), index.column());
+    if (!root.isValid())
+        return 0;
+    QModelIndex rootIndex = m->index(root.row, root.column);
     if (orientation() == Qt::Horizontal)
     {
-        int colSpanCnt = rootIndex.data(COLUMN_SPAN_ROLE).toInt();
+        int colSpanCnt = root.span.columnSpan;
         *beginSection = rootIndex.column();
         *endSection = *beginSection + colSpanCnt - 1;
         index = rootIndex;
@@ -676,7 +607,7 @@ int MultiLevelHeaderView::getSectionRange(QModelIndex &index, int *beginSection,
     }
     else
     {
-        int rowSpanCnt = rootIndex.data(ROW_SPAN_ROLE).toInt();
+        int rowSpanCnt = root.span.rowSpan;
         *beginSection = rootIndex.row();
         ;
         *endSection = *beginSection + rowSpanCnt - 1;
@@ -687,30 +618,712 @@ int MultiLevelHeaderView::getSectionRange(QModelIndex &index, int *beginSection,
 
 void MultiLevelHeaderView::onSectionResized(int logicalIndex, int oldSize, int newSize)
 {
+    Q_UNUSED(oldSize);
+    if (m_batchLayout)
+        return;
+    // 拖动时每移动一个像素都会触发，这里只记录，每帧统一处理一次
+    m_pendingSizes.insert(logicalIndex, newSize);
+    if (!m_frameTimer.isActive())
+        m_frameTimer.start();
+}
+
+void MultiLevelHeaderView::flushPendingResize()
+{
+    QRegion dirty = applyPendingResize();
+    if (!dirty.isEmpty())
+        viewport()->update(dirty);
+}
+
+QRegion MultiLevelHeaderView::applyPendingResize()
+{
+    if (m_pendingSizes.isEmpty())
+        return QRegion();
+
+    HeaderProfiler::Scope scope(&m_profiler, HeaderProfiler::LayoutPhase);
+    RoleProfilingProxyModel::PhaseScope phase(m_roleProfiler, "layout");
     MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
     const int orient = orientation();
     const int levelCount = (orient == Qt::Horizontal) ? m->rowCount() : m->columnCount();
+    QMap<int, int> sizes;
+    sizes.swap(m_pendingSizes);
     if (orient == Qt::Horizontal)
+        m->setColumnWidths(sizes);
+    else
+        m->setRowHeights(sizes);
+
+    // 右侧被平移的section由QHeaderView::resizeSection自己重绘，
+    // 这里只需要补画跨过被拖动section的合并单元格
+    std::set<Cell> cellsToBeDrawn;
+    for (auto it = sizes.cbegin(); it != sizes.cend(); ++it)
     {
-        m->setColumnWidth(logicalIndex, newSize);
+        std::set<Cell> cells = getCellsToBeDrawn(this, m, orient, levelCount, it.key());
+        cellsToBeDrawn.insert(cells.begin(), cells.end());
     }
-
-    std::set<Cell> cellsToBeDrawn = getCellsToBeDrawn(this, m, orient, levelCount, logicalIndex);
+    QRegion dirty;
     for (const auto &cell : cellsToBeDrawn)
+        dirty += getCellRect(cell.row, cell.column);
+    return dirty;
+}
+
+void MultiLevelHeaderView::dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    // 尺寸变化由sectionResized/levelSizeChanged负责重绘
+    if (roles.size() == 1 && roles.first() == Qt::SizeHintRole)
+        return;
+    if (!topLeft.isValid() || !bottomRight.isValid())
+    {
+        viewport()->update();
+        return;
+    }
+    // 范围太大时逐个记录不划算，直接整体重绘
+    const qint64 cellCount = qint64(bottomRight.row() - topLeft.row() + 1) * (bottomRight.column() - topLeft.column() + 1);
+    if (cellCount > 4096)
     {
-        QRect sectionRect = getCellRect(cell.row, cell.column);
-        if (orient == Qt::Horizontal)
+        viewport()->update();
+        return;
+    }
+
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+    {
+        for (int column = topLeft.column(); column <= bottomRight.column(); ++column)
         {
-            sectionRect.setWidth(viewport()->width() - sectionRect.left());
+            RootCell root = m->rootOf(row, column);
+            if (root.isValid())
+                m_dirtyCells.insert({root.row, root.column});
+            else
+                m_dirtyCells.insert({row, column});
+        }
+    }
+    // 检查状态变化时上级单元格的汇总状态也会变，整列(行)的根单元格都要重绘
+    if (roles.contains(Qt::CheckStateRole))
+    {
+        const bool horizontal = (orientation() == Qt::Horizontal);
+        const int first = horizontal ? topLeft.column() : topLeft.row();
+        const int last = horizontal ? bottomRight.column() : bottomRight.row();
+        for (int section = first; section <= last; ++section)
+        {
+            for (int level = 0; level < levelCount(); ++level)
+            {
+                const int row = horizontal ? level : section;
+                const int column = horizontal ? section : level;
+                RootCell root = m->rootOf(row, column);
+                if (root.isValid())
+                    m_dirtyCells.insert({root.row, root.column});
+                else
+                    m_dirtyCells.insert({row, column});
+            }
         }
+    }
+    if (!m_frameTimer.isActive())
+        m_frameTimer.start();
+}
+
+QRegion MultiLevelHeaderView::pendingDirtyRegion() const
+{
+    // 到帧末才换算矩形，期间的合并/尺寸变化都已生效；根单元格重新查一次，合并可能已经变了
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    std::set<Cell> roots;
+    for (const Cell &cell : m_dirtyCells)
+    {
+        if (cell.row >= m->rowCount() || cell.column >= m->columnCount())
+            continue;
+        RootCell root = m->rootOf(cell.row, cell.column);
+        if (root.isValid())
+            roots.insert({root.row, root.column});
         else
+            roots.insert(cell);
+    }
+    QRegion dirty;
+    const QRect visible = viewport()->rect();
+    for (const Cell &cell : roots)
+    {
+        QRect rect = getCellRect(cell.row, cell.column) & visible;
+        if (!rect.isEmpty())
+            dirty += rect;
+    }
+    return dirty;
+}
+
+void MultiLevelHeaderView::flushDirtyCells()
+{
+    if (m_dirtyCells.empty())
+        return;
+    QRegion dirty = pendingDirtyRegion();
+    m_dirtyCells.clear();
+    if (!dirty.isEmpty())
+        viewport()->update(dirty);
+}
+
+void MultiLevelHeaderView::paintEvent(QPaintEvent *event)
+{
+    // 只为刷新统计层而来的重绘不计为一帧，否则统计层显示的总是它自己
+    const bool overlayOnly = !m_overlayRect.isEmpty() && m_overlayRect.contains(event->rect());
+    if (!overlayOnly)
+        m_profiler.beginFrame();
+    // 先把尚未处理的尺寸变化写入前缀和，保证这一帧绘制的合并单元格尺寸是最新的
+    // 本次重绘已经覆盖的部分不再安排第二次重绘，只补画区域外的合并单元格
+    if (!m_pendingSizes.isEmpty())
+    {
+        QRegion dirty = applyPendingResize() - event->region();
+        if (!dirty.isEmpty())
+            viewport()->update(dirty);
+    }
+    QHeaderView::paintEvent(event);
+    if (!overlayOnly)
+        m_profiler.endFrame();
+
+    if (m_profiler.isEnabled() && m_profiler.isOverlayVisible())
+    {
+        // 统计层本身不计入帧时间
+        QPainter painter(viewport());
+        const QString text = m_profiler.summary();
+        QRect rect = painter.fontMetrics().boundingRect(text).adjusted(-4, -2, 4, 2);
+        rect.moveTopLeft(QPoint(2, 2));
+        painter.fillRect(rect, QColor(0, 0, 0, 160));
+        painter.setPen(Qt::yellow);
+        painter.drawText(rect, Qt::AlignCenter, text);
+        // 绘制被裁剪在本次重绘区域内，局部重绘后统计层的数字会过时，
+        // 没被完整覆盖时单独再刷新一次统计层(包括文本变短后旧矩形的残留)
+        const QRect dirty = rect | m_overlayRect;
+        m_overlayRect = rect;
+        if (!overlayOnly && !(QRegion(dirty) - event->region()).isEmpty())
+            viewport()->update(dirty);
+    }
+    else
+    {
+        m_overlayRect = QRect();
+    }
+}
+
+QByteArray MultiLevelHeaderView::saveHeaderState() const
+{
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    const bool horizontal = (orientation() == Qt::Horizontal);
+    const int levels = levelCount();
+    const int sections = count();
+
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << HeaderStateMagic << HeaderStateVersion << qint32(orientation()) << qint32(levels) << qint32(sections);
+    for (int level = 0; level < levels; ++level)
+        out << qint32(horizontal ? m->getRowHeight(level) : m->getColumnWidth(level));
+    // 还没有flush的拖动尺寸以QHeaderView为准
+    writeRuns(out, sections, [this, m](int section) { return m_pendingSizes.value(section, m->sectionSize(section)); });
+    writeRuns(out, sections, [m](int section) { return m->isSectionHidden(section) ? 1 : 0; });
+
+    const QVector<RootCell> cells = m->spans();
+    out << qint32(cells.size());
+    for (const RootCell &cell : cells)
+        out << qint32(cell.row) << qint32(cell.column) << qint32(cell.span.rowSpan) << qint32(cell.span.columnSpan);
+
+    out << isSortIndicatorShown() << qint32(sortIndicatorSection()) << qint32(sortIndicatorOrder());
+    return state;
+}
+
+bool MultiLevelHeaderView::restoreHeaderState(const QByteArray &state)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    const bool horizontal = (orientation() == Qt::Horizontal);
+    QDataStream in(state);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint8 version = 0;
+    qint32 orient = 0, levels = 0, sections = 0;
+    in >> magic >> version >> orient >> levels >> sections;
+    if (in.status() != QDataStream::Ok || magic != HeaderStateMagic || version != HeaderStateVersion
+        || orient != qint32(orientation()) || levels != levelCount() || sections != count())
+        return false;
+
+    QMap<int, int> levelSizes;
+    for (int level = 0; level < levels; ++level)
+    {
+        qint32 size = 0;
+        in >> size;
+        if (size <= 0)
+            return false;
+        levelSizes.insert(level, size);
+    }
+    std::vector<int> sizes, hiddenRuns;
+    if (!readRuns(in, sections, 1, std::numeric_limits<qint32>::max(), sizes) || !readRuns(in, sections, 0, 1, hiddenRuns))
+        return false;
+
+    qint32 spanCount = 0;
+    in >> spanCount;
+    if (spanCount < 0)
+        return false;
+    QVector<RootCell> cells;
+    cells.reserve(qMin(spanCount, levels * sections));
+    // setSpans要求合并单元格互不重叠，逐个标记覆盖到的单元格
+    const int rowCount = horizontal ? levels : sections;
+    const int columnCount = horizontal ? sections : levels;
+    std::vector<char> covered(size_t(rowCount) * columnCount, 0);
+    for (int i = 0; i < spanCount && in.status() == QDataStream::Ok; ++i)
+    {
+        RootCell cell;
+        qint32 row = 0, column = 0, rowSpan = 0, columnSpan = 0;
+        in >> row >> column >> rowSpan >> columnSpan;
+        if (row < 0 || column < 0 || rowSpan <= 0 || columnSpan <= 0 || rowSpan > rowCount - row || columnSpan > columnCount - column)
+            return false;
+        for (int r = row; r < row + rowSpan; ++r)
         {
-            sectionRect.setHeight(viewport()->height() - sectionRect.top());
+            for (int c = column; c < column + columnSpan; ++c)
+            {
+                char &mark = covered[size_t(r) * columnCount + c];
+                if (mark)
+                    return false;
+                mark = 1;
+            }
         }
-        viewport()->update(sectionRect);
+        cell.row = row;
+        cell.column = column;
+        cell.span.rowSpan = rowSpan;
+        cell.span.columnSpan = columnSpan;
+        cells.append(cell);
+    }
+    bool sortShown = false;
+    qint32 sortSection = -1, sortOrder = Qt::AscendingOrder;
+    in >> sortShown >> sortSection >> sortOrder;
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    // 全部读完并校验通过后才修改，失败时表头保持原样
+    HeaderProfiler::Scope scope(&m_profiler, HeaderProfiler::LayoutPhase);
+    // QHeaderView中隐藏section的尺寸取不到，用模型(加上还没处理的拖动)记录的原尺寸比较
+    std::vector<int> oldSizes(sections);
+    for (int section = 0; section < sections; ++section)
+        oldSizes[section] = m_pendingSizes.value(section, m->sectionSize(section));
+    m_pendingSizes.clear();
+    m_dirtyCells.clear();
+    const std::vector<char> hidden(hiddenRuns.begin(), hiddenRuns.end());
+    m->setSectionLayout(sizes, hidden);
+    if (horizontal)
+        m->setRowHeights(levelSizes);
+    else
+        m->setColumnWidths(levelSizes);
+    m->clearSpans();
+    m->setSpans(cells);
+
+    // QHeaderView自己也保存了一份尺寸，只改不一样的section，期间不重绘、不逐个更新前缀和
+    m_batchLayout = true;
+    setUpdatesEnabled(false);
+    for (int section = 0; section < sections; ++section)
+    {
+        const bool wasHidden = isSectionHidden(section);
+        if (oldSizes[section] == sizes[section])
+        {
+            if (wasHidden != bool(hidden[section]))
+                setSectionHidden(section, hidden[section]);
+            continue;
+        }
+        // 隐藏的section要先显示出来才能改尺寸
+        if (wasHidden)
+            setSectionHidden(section, false);
+        resizeSection(section, sizes[section]);
+        if (hidden[section])
+            setSectionHidden(section, true);
+    }
+    setUpdatesEnabled(true);
+    m_batchLayout = false;
+
+    setSortIndicatorShown(sortShown);
+    setSortIndicator(sortSection, Qt::SortOrder(sortOrder));
+    levelSizeChanged();
+    return true;
+}
+
+void MultiLevelHeaderView::initCellContext(HeaderCellContext &cell, int row, int column) const
+{
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
+    const bool horizontal = (orientation() == Qt::Horizontal);
+    const CellSpan span = m->spanOf(row, column);
+    const int level = horizontal ? row : column;
+    const int levelSpan = span.isValid() ? (horizontal ? span.rowSpan : span.columnSpan) : 1;
+    const int sectionSpan = span.isValid() ? (horizontal ? span.columnSpan : span.rowSpan) : 1;
+
+    cell.row = row;
+    cell.column = column;
+    cell.firstSection = horizontal ? column : row;
+    cell.lastSection = cell.firstSection + sectionSpan - 1;
+    cell.leaf = (level + levelSpan >= levelCount());
+    cell.rect = getCellRect(row, column);
+    cell.view = this;
+
+    const QModelIndex cellIndex = m->index(row, column);
+    initStyleOption(&cell.option);
+    cell.option.textAlignment = Qt::AlignCenter;
+    cell.option.section = cell.firstSection;
+    cell.option.rect = cell.rect;
+    cell.option.text = cellData(cellIndex, Qt::DisplayRole).toString();
+    // 路径形式的图标从缓存中取，绘制时不读文件
+    const QVariant decoration = cellData(cellIndex, Qt::DecorationRole);
+    if (decoration.type() == QVariant::String)
+        cell.icon = HeaderIconCache::instance()->icon(decoration.toString(), style()->pixelMetric(QStyle::PM_SmallIconSize, nullptr, this), devicePixelRatioF());
+    else if (decoration.canConvert<QIcon>())
+        cell.icon = qvariant_cast<QIcon>(decoration);
+    cell.option.icon = cell.icon;
+    cell.background = cellData(cellIndex, Qt::BackgroundRole);
+    cell.foreground = cellData(cellIndex, Qt::ForegroundRole);
+}
+
+void MultiLevelHeaderView::drawCell(QPainter *painter, const HeaderCellContext &cell) const
+{
+    QVarLengthArray<const HeaderPaintLayer *, 8> active;
+    bool plain = cell.isPlain();
+    for (const HeaderPaintLayer *layer : m_layers)
+    {
+        if (layer->affects(cell))
+        {
+            active.append(layer);
+            plain = plain && layer->isBase();
+        }
+    }
+    if (plain && drawCachedCell(painter, cell))
+        return;
+    for (const HeaderPaintLayer *layer : active)
+    {
+        m_profiler.count(HeaderProfiler::LayersRun);
+        painter->save();
+        layer->paint(painter, cell);
+        painter->restore();
     }
 }
 
+bool MultiLevelHeaderView::drawCachedCell(QPainter *painter, const HeaderCellContext &cell) const
+{
+    const QSize size = cell.rect.size();
+    if (size.isEmpty())
+        return false;
+    const qreal dpr = painter->device()->devicePixelRatioF();
+    if (!qFuzzyCompare(dpr, m_cellCacheDpr))
+    {
+        m_cellCache.clear();
+        m_cellCacheDpr = dpr;
+    }
+
+    const CellCacheKey key = { cell.option.text, size };
+    if (const QPixmap *cached = m_cellCache.object(key))
+    {
+        m_profiler.count(HeaderProfiler::CachedCells);
+        painter->drawPixmap(cell.rect.topLeft(), *cached);
+        return true;
+    }
+
+    QPixmap pixmap(size * dpr);
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+    {
+        QPainter cellPainter(&pixmap);
+        cellPainter.setFont(painter->font());
+        HeaderCellContext local = cell;
+        local.rect = QRect(QPoint(0, 0), size);
+        local.option.rect = local.rect;
+        for (const HeaderPaintLayer *layer : m_layers)
+        {
+            if (layer->isBase() && layer->affects(local))
+            {
+                m_profiler.count(HeaderProfiler::LayersRun);
+                layer->paint(&cellPainter, local);
+            }
+        }
+    }
+    painter->drawPixmap(cell.rect.topLeft(), pixmap);
+    // 放不进缓存(比整个预算还大)时QCache直接丢弃，不影响这次绘制
+    const int cost = qMax(1, int(qint64(pixmap.width()) * pixmap.height() * 4 / 1024));
+    m_cellCache.insert(key, new QPixmap(pixmap), cost);
+    return true;
+}
+
+QModelIndex MultiLevelHeaderView::leafIndex(int section) const
+{
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
+    const int leafLevel = levelCount() - 1;
+    return (orientation() == Qt::Horizontal) ? m->index(leafLevel, section) : m->index(section, leafLevel);
+}
+
+void MultiLevelHeaderView::setSectionsSortable(bool sortable)
+{
+    m_sortable = sortable;
+    viewport()->update();
+}
+
+bool MultiLevelHeaderView::sectionsSortable() const
+{
+    return m_sortable;
+}
+
+void MultiLevelHeaderView::setCheckBoxesEnabled(bool enabled)
+{
+    m_checkBoxes = enabled;
+    viewport()->update();
+}
+
+bool MultiLevelHeaderView::checkBoxesEnabled() const
+{
+    return m_checkBoxes;
+}
+
+void MultiLevelHeaderView::setSectionCheckState(int section, Qt::CheckState state)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    m->setData(leafIndex(section), int(state), Qt::CheckStateRole);
+}
+
+Qt::CheckState MultiLevelHeaderView::sectionCheckState(int section) const
+{
+    return Qt::CheckState(cellData(leafIndex(section), Qt::CheckStateRole).toInt());
+}
+
+Qt::CheckState MultiLevelHeaderView::sectionCheckState(int first, int last) const
+{
+    // 模型按section维护计数，跨整个表头的根单元格也是O(log n)
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    return m->sectionCheckState(first, last);
+}
+
+void MultiLevelHeaderView::setSectionFiltered(int section, bool filtered)
+{
+    if (section < 0 || section >= count() || isSectionFiltered(section) == filtered)
+        return;
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    m->setData(leafIndex(section), filtered, FILTER_ROLE);
+}
+
+bool MultiLevelHeaderView::isSectionFiltered(int section) const
+{
+    return cellData(leafIndex(section), FILTER_ROLE).toBool();
+}
+
+bool MultiLevelHeaderView::hasFilteredSections() const
+{
+    // 计数在模型中随section删除，不会过时
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    return m->filteredSectionCount() > 0;
+}
+
+void MultiLevelHeaderView::addPaintLayer(HeaderPaintLayer *layer)
+{
+    // 边框始终最后画
+    m_layers.insert(m_layers.size() - 1, layer);
+    viewport()->update();
+}
+
+void MultiLevelHeaderView::changeEvent(QEvent *event)
+{
+    QHeaderView::changeEvent(event);
+    // 缓存的单元格位图与调色板颜色组(激活/非激活)和启用状态有关，key中没有这两项
+    if (event->type() == QEvent::StyleChange || event->type() == QEvent::FontChange || event->type() == QEvent::PaletteChange
+        || event->type() == QEvent::ActivationChange || event->type() == QEvent::EnabledChange)
+        m_cellCache.clear();
+    if (event->type() == QEvent::StyleChange)
+        preloadIcons();
+}
+
+void MultiLevelHeaderView::showEvent(QShowEvent *event)
+{
+    QHeaderView::showEvent(event);
+    if (QWindow *handle = window()->windowHandle())
+        connect(handle, &QWindow::screenChanged, this, &MultiLevelHeaderView::preloadIcons, Qt::UniqueConnection);
+}
+
+HeaderProfiler *MultiLevelHeaderView::profiler() const
+{
+    return &m_profiler;
+}
+
+void MultiLevelHeaderView::setProfilingEnabled(bool enabled, bool overlay)
+{
+    m_profiler.setEnabled(enabled);
+    m_profiler.setOverlayVisible(overlay);
+    viewport()->update();
+}
+
+RoleProfilingProxyModel *MultiLevelHeaderView::roleProfiler() const
+{
+    return m_roleProfiler;
+}
+
+void MultiLevelHeaderView::setRoleProfilingEnabled(bool enabled)
+{
+    if (enabled == (m_roleProfiler != nullptr))
+        return;
+    if (enabled)
+    {
+        // 只用来读取单元格数据，QHeaderView本身仍然使用表头模型，section的状态不受影响
+        m_roleProfiler = new RoleProfilingProxyModel(this);
+        m_roleProfiler->setSourceModel(model());
+    }
+    else
+    {
+        delete m_roleProfiler;
+        m_roleProfiler = nullptr;
+    }
+}
+
+QVariant MultiLevelHeaderView::cellData(const QModelIndex &cellIndex, int role) const
+{
+    if (m_roleProfiler)
+        return m_roleProfiler->mapFromSource(cellIndex).data(role);
+    return cellIndex.data(role);
+}
+
+namespace
+{
+struct SectionFitJob
+{
+    int section = 0;
+    QStringList headerTexts; // 只覆盖本section的表头单元格
+    QStringList dataTexts;
+    int size = 0;
+};
+
+struct SpanFit
+{
+    int first = 0;
+    int count = 0;
+    QString text;
+};
+}
+
+void MultiLevelHeaderView::autoFitSections(const QAbstractItemModel *dataModel, int sampleCount)
+{
+    MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
+    const bool horizontal = (orientation() == Qt::Horizontal);
+    const int levelCount = horizontal ? m->rowCount() : m->columnCount();
+    const int sectionCount = horizontal ? m->columnCount() : m->rowCount();
+    if (sectionCount <= 0)
+        return;
+    RoleProfilingProxyModel::PhaseScope phase(m_roleProfiler, "autofit");
+
+    // 在GUI线程中收集文本（QString是隐式共享的，只拷贝引用），测量放到线程池中进行
+    QVector<SectionFitJob> jobs(sectionCount);
+    std::vector<SpanFit> spans;
+    for (int section = 0; section < sectionCount; ++section)
+    {
+        SectionFitJob &job = jobs[section];
+        job.section = section;
+        for (int level = 0; level < levelCount; ++level)
+        {
+            int row = horizontal ? level : section;
+            int column = horizontal ? section : level;
+            CellSpan cellSpan = m->spanOf(row, column);
+            if (!cellSpan.isValid())
+                continue;
+            QModelIndex cellIndex = m->index(row, column);
+            int span = horizontal ? cellSpan.columnSpan : cellSpan.rowSpan;
+            if (span > 1)
+            {
+                SpanFit fit;
+                fit.first = section;
+                fit.count = qMin(span, sectionCount - section);
+                fit.text = cellData(cellIndex, Qt::DisplayRole).toString();
+                spans.push_back(fit);
+            }
+            else
+            {
+                job.headerTexts.append(cellData(cellIndex, Qt::DisplayRole).toString());
+            }
+        }
+    }
+
+    if (dataModel)
+    {
+        const int itemCount = horizontal ? dataModel->rowCount() : dataModel->columnCount();
+        const int dataSections = qMin(sectionCount, horizontal ? dataModel->columnCount() : dataModel->rowCount());
+        // sampleCount > 0 时按固定步长抽样，否则全量扫描
+        int step = 1;
+        if (sampleCount > 0 && itemCount > sampleCount)
+            step = itemCount / sampleCount;
+        for (int section = 0; section < dataSections; ++section)
+        {
+            QStringList &texts = jobs[section].dataTexts;
+            for (int i = 0; i < itemCount; i += step)
+            {
+                QModelIndex idx = horizontal ? dataModel->index(i, section) : dataModel->index(section, i);
+                texts.append(idx.data(Qt::DisplayRole).toString());
+            }
+        }
+    }
+
+    const QFont headerFont = font();
+    const QFont dataFont = parentWidget() ? parentWidget()->font() : font();
+    const int headerMargin = 2 * style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, this);
+    const int dataMargin = 2 * (style()->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, this) + 1);
+    const int minSize = minimumSectionSize();
+
+    QtConcurrent::blockingMap(jobs, [=](SectionFitJob &job) {
+        TextMetricsCache *cache = TextMetricsCache::instance();
+        int size = minSize;
+        for (const QString &text : job.headerTexts)
+        {
+            QSize s = cache->textSize(headerFont, text);
+            size = qMax(size, (horizontal ? s.width() : s.height()) + headerMargin);
+        }
+        // 数据单元格的值大多只出现一次，不放进全局的LabelTable/TextMetricsCache(不会释放)，
+        // 只在本列内去重
+        QFontMetrics dataMetrics(dataFont);
+        QHash<QString, int> measured;
+        for (const QString &text : job.dataTexts)
+        {
+            auto it = measured.constFind(text);
+            if (it == measured.constEnd())
+            {
+                QSize s = dataMetrics.size(0, text);
+                it = measured.insert(text, horizontal ? s.width() : s.height());
+            }
+            size = qMax(size, it.value() + dataMargin);
+        }
+        job.size = size;
+    });
+
+    QVector<int> sizes(sectionCount);
+    for (int i = 0; i < sectionCount; ++i)
+        sizes[i] = jobs[i].size;
+
+    // 合并单元格至少要能放下自己的文本，不够的部分平均分给下面的各个section
+    // 先处理跨度小的，这样外层的合并单元格看到的是已经调整过的子列宽
+    std::sort(spans.begin(), spans.end(), [](const SpanFit &a, const SpanFit &b) { return a.count < b.count; });
+    for (const SpanFit &span : spans)
+    {
+        QSize s = TextMetricsCache::instance()->textSize(headerFont, span.text);
+        int required = (horizontal ? s.width() : s.height()) + headerMargin;
+        int current = 0;
+        for (int i = span.first; i < span.first + span.count; ++i)
+            current += sizes[i];
+        if (current >= required)
+            continue;
+        int extra = required - current;
+        for (int k = 0; k < span.count; ++k)
+            sizes[span.first + k] += extra / span.count + (k < extra % span.count ? 1 : 0);
+    }
+
+    // 一次性写入模型和QHeaderView，只触发一次重绘
+    QMap<int, int> changed;
+    for (int i = 0; i < sectionCount; ++i)
+    {
+        if (sizes[i] != sectionSize(i))
+            changed.insert(i, sizes[i]);
+    }
+    if (changed.isEmpty())
+        return;
+
+    if (horizontal)
+        m->setColumnWidths(changed);
+    else
+        m->setRowHeights(changed);
+
+    setUpdatesEnabled(false);
+    for (auto it = changed.cbegin(); it != changed.cend(); ++it)
+    {
+        resizeSection(it.key(), it.value());
+        // 模型已经更新过了，不需要再按帧处理
+        m_pendingSizes.remove(it.key());
+    }
+    setUpdatesEnabled(true);
+}
+
 void MultiLevelHeaderView::add_tool(ToolNode* tool_node)
 {
     qInfo() << "MultiLevelHeaderView add_tool done";
@@ -724,88 +1337,16 @@ void MultiLevelHeaderView::add_tool(ToolNode* tool_node)
 
 void MultiLevelHeaderView::init_tool_menu()
 {
-    MultiLevelHeaderView* header_view = this;
     _tool_menu.addAction(
-        "添加工具", [&]()
+        "添加工具", [this]()
         {
-            QDialog add_tool_dlg;
-            QVBoxLayout *vLayout = new QVBoxLayout;
-
-            QLineEdit* name_edit = new QLineEdit;
-            QLabel* name_label = new QLabel;
-            QHBoxLayout *hLayout1 = new QHBoxLayout;
-            QWidget *widget1 = new QWidget;
-
-            name_label->setText("Name:");
-            name_edit->setPlaceholderText("please input tool Name");
-            hLayout1->addWidget(name_label);
-            hLayout1->addWidget(name_edit);
-            widget1->setLayout(hLayout1);
-            vLayout->addWidget(widget1);
-
-            QLineEdit* binary_edit = new QLineEdit;
-            QLabel* binary_label = new QLabel;
-            QHBoxLayout *hLayout2 = new QHBoxLayout;
-            QWidget *widget2 = new QWidget;
-            binary_label->setText("Binary:");
-            binary_edit->setPlaceholderText("please input tool binary");
-            hLayout2->addWidget(binary_label);
-            hLayout2->addWidget(binary_edit);
-            widget2->setLayout(hLayout2);
-            vLayout->addWidget(widget2);
-
-            QLineEdit* pos_edit = new QLineEdit;
-            QLabel* pos_label = new QLabel;
-            QHBoxLayout *hLayout3 = new QHBoxLayout;
-            QWidget *widget3 = new QWidget;
-            pos_label->setText("Add Tool Pos:");
-            pos_edit->setPlaceholderText("please input tool pos");
-            hLayout3->addWidget(pos_label);
-            hLayout3->addWidget(pos_edit);
-            widget3->setLayout(hLayout3);
-            vLayout->addWidget(widget3);
-
-            QPushButton* ok_btn = new QPushButton;
-            QPushButton* cancel_btn = new QPushButton;
-            ok_btn->setText("OK");
-            cancel_btn->setText("Cancel");
-            QHBoxLayout *hLayout4 = new QHBoxLayout;
-            QWidget *widget4 = new QWidget;
-            hLayout4->addWidget(ok_btn);
-            hLayout4->addWidget(cancel_btn);
-            widget4->setLayout(hLayout4);
-            vLayout->addWidget(widget4);
-            connect(ok_btn, &QPushButton::clicked, [&]()
-                    {
-                        if (name_edit->text().trimmed().isEmpty() || pos_edit->text().trimmed().isEmpty())
-                        {
-                            QMessageBox msgBox;
-                            msgBox.setWindowTitle(tr("警告"));
-                            msgBox.setText(tr("工具名称和位置Pos不能为空"));
-                            msgBox.setStandardButtons(QMessageBox::Ok);
-                            msgBox.setButtonText(QMessageBox::Ok, tr("确定"));
-                            msgBox.setIcon(QMessageBox::Warning);
-                            msgBox.exec();
-                            return;
-                        }
-
-                        qInfo() << "添加的工具为："<< name_edit->text().trimmed() << ",工具位置为：" << pos_edit->text().trimmed();
-                        // ToolNode *tool_node = new ToolNode(name_edit->text().trimmed(), pos_edit->text().trimmed().toInt());
-                        // 添加点工具 暂时先发送基本数据类型，后续再改为结构本
-                        // header_view->add_tool(tool_node);
-                        emit header_add_tool(name_edit->text().trimmed(), pos_edit->text().trimmed().toInt());
-
-                        add_tool_dlg.close();
-                    });
-            connect(cancel_btn, &QPushButton::clicked, [&]()
-                    {
-                        add_tool_dlg.close();
-                    });
-            add_tool_dlg.setLayout(vLayout);
-
-            add_tool_dlg.setWindowTitle("Add Tool");
-            add_tool_dlg.setFixedSize(400, 400);
-            add_tool_dlg.exec(); },
+            QVector<HeaderInlineEditor::Field> fields;
+            fields.append(HeaderInlineEditor::Field("Name:", "please input tool Name", true));
+            fields.append(HeaderInlineEditor::Field("Binary:", "please input tool binary"));
+            fields.append(HeaderInlineEditor::Field("Add Tool Pos:", "please input tool pos", true, true));
+            QVariantMap context;
+            context.insert("kind", "tool");
+            m_editor->open(fields, viewport(), menuCellRect(), context); },
         QKeySequence(Qt::Key_B));
 
     _tool_menu.addAction(
@@ -813,105 +1354,29 @@ void MultiLevelHeaderView::init_tool_menu()
         { qDebug() << "在这里写删除工具的代码"; },
         QKeySequence(Qt::Key_Up));
 
+    _tool_menu.addAction("折叠/展开", [this]() { emitToggleCollapse(); });
+
     setContextMenuPolicy(Qt::CustomContextMenu);
     // modify by hqh
-    connect(this, SIGNAL(sectionClicked(int)), this, SLOT(on_section_clicked(int)));
+    connect(this, SIGNAL(sectionClicked(int)), this, SLOT(on_section_clicked(int)), Qt::UniqueConnection);
     // connect(this, &QHeaderView::customContextMenuRequested, this, &MultiLevelHeaderView::popupMenu);
 }
 
 void MultiLevelHeaderView::init_param_menu()
 {
     _param_menu.addAction(
-        "添加参数", [&]()
+        "添加参数", [this]()
         {
-            QDialog add_param_dlg;
-            QVBoxLayout *vLayout = new QVBoxLayout;
-
-            QLineEdit* name_edit = new QLineEdit;
-            QLabel* name_label = new QLabel;
-            QHBoxLayout *hLayout1 = new QHBoxLayout;
-            QWidget *widget1 = new QWidget;
-            name_label->setText("Parameter:");
-            name_edit->setPlaceholderText("please input Parameter Name");
-            hLayout1->addWidget(name_label);
-            hLayout1->addWidget(name_edit);
-            widget1->setLayout(hLayout1);
-            vLayout->addWidget(widget1);
-
-            QLineEdit* value_edit = new QLineEdit;
-            QLabel* value_label = new QLabel;
-            QHBoxLayout *hLayout2 = new QHBoxLayout;
-            QWidget *widget2 = new QWidget;
-            value_label->setText("Parameter Value:");
-            value_edit->setPlaceholderText("please input Parameter Value");
-            hLayout2->addWidget(value_label);
-            hLayout2->addWidget(value_edit);
-            widget2->setLayout(hLayout2);
-            vLayout->addWidget(widget2);
-
-            QLineEdit* pos_edit = new QLineEdit;
-            QLabel* pos_label = new QLabel;
-            QHBoxLayout *hLayout3 = new QHBoxLayout;
-            QWidget *widget3 = new QWidget;
-            pos_label->setText("Parameter Pos:");
-            pos_edit->setPlaceholderText("please input Parameter Pos");
-            hLayout3->addWidget(pos_label);
-            hLayout3->addWidget(pos_edit);
-            widget3->setLayout(hLayout3);
-            vLayout->addWidget(widget3);
-
-            QPushButton* ok_btn = new QPushButton;
-            QPushButton* cancel_btn = new QPushButton;
-            ok_btn->setText("OK");
-            cancel_btn->setText("Cancel");
-            QHBoxLayout *hLayout4 = new QHBoxLayout;
-            QWidget *widget4 = new QWidget;
-            hLayout4->addWidget(ok_btn);
-            hLayout4->addWidget(cancel_btn);
-            widget4->setLayout(hLayout4);
-            vLayout->addWidget(widget4);
-            connect(ok_btn, &QPushButton::clicked, [&]()
-            {
-                if (name_edit->text().trimmed().isEmpty() || value_edit->text().trimmed().isEmpty())
-                {
-                    QMessageBox msgBox;
-                    msgBox.setWindowTitle(tr("警告"));
-                    msgBox.setText(tr("输入参数不能为空"));
-                    msgBox.setStandardButtons(QMessageBox::Ok);
-                    msgBox.setButtonText(QMessageBox::Ok, tr("确定"));
-                    msgBox.setIcon(QMessageBox::Warning);
-                    msgBox.exec();
-                    return;
-                }
-                int tool_col = 0;
-                QModelIndex index = indexAt(mapFromGlobal( _param_menu.pos()));
-                if (!index.isValid())
-                {
-                    qInfo() << "init_param_menu QModelIndex is not valid!";
-
-                } else
-                {
-                    qInfo() << "init_param_menu QModelIndex is valid row:" << index.row() << ", col:"<<index.column();
-                    tool_col = index.column();
-                }
-
-                QString param_key = name_edit->text().trimmed();
-                QString value_list = value_edit->text().trimmed();
-                int param_pos = pos_edit->text().trimmed().toInt();
-                emit header_add_param(tool_col, param_key, value_list, param_pos);
-                qInfo() << "添加的参数为："<< name_edit->text().trimmed() << ", 参数值为：" << value_edit->text().trimmed()<< ",";
-
-                add_param_dlg.close();
-            });
-            connect(cancel_btn, &QPushButton::clicked, [&]()
-            {
-                add_param_dlg.close();
-            });
-            add_param_dlg.setLayout(vLayout);
-
-            add_param_dlg.setWindowTitle("Add Parameter");
-            add_param_dlg.setFixedSize(400, 400);
-            add_param_dlg.exec(); },
+            QVector<HeaderInlineEditor::Field> fields;
+            fields.append(HeaderInlineEditor::Field("Parameter:", "please input Parameter Name", true));
+            fields.append(HeaderInlineEditor::Field("Parameter Value:", "please input Parameter Value", true));
+            fields.append(HeaderInlineEditor::Field("Parameter Pos:", "please input Parameter Pos", false, true));
+            // 参数加到右键点击的那一列所属的工具上
+            QModelIndex index = indexAt(m_menuPos);
+            QVariantMap context;
+            context.insert("kind", "param");
+            context.insert("tool_col", index.isValid() ? index.column() : 0);
+            m_editor->open(fields, viewport(), menuCellRect(), context); },
         QKeySequence(Qt::Key_B));
 
     _param_menu.addAction(
@@ -919,15 +1384,84 @@ void MultiLevelHeaderView::init_param_menu()
         { qDebug() << "在这里写删除工具的代码"; },
         QKeySequence(Qt::Key_Up));
 
+    // 有子参数的参数也可以折叠
+    _param_menu.addAction("折叠/展开", [this]() { emitToggleCollapse(); });
+
     setContextMenuPolicy(Qt::CustomContextMenu);
     // modify by hqh
-    connect(this, SIGNAL(sectionClicked(int)), this, SLOT(on_section_clicked(int)));
+    connect(this, SIGNAL(sectionClicked(int)), this, SLOT(on_section_clicked(int)), Qt::UniqueConnection);
     // connect(this, &QHeaderView::customContextMenuRequested, this, &MultiLevelHeaderView::popupMenu);
 }
 
+void MultiLevelHeaderView::emitToggleCollapse()
+{
+    QModelIndex index = indexAt(m_menuPos);
+    if (!index.isValid())
+        return;
+    if (orientation() == Qt::Horizontal)
+        emit header_toggle_collapse(index.row(), index.column());
+    else
+        emit header_toggle_collapse(index.column(), index.row());
+}
+
+QRect MultiLevelHeaderView::menuCellRect() const
+{
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(model());
+    QModelIndex index = indexAt(m_menuPos);
+    RootCell root = index.isValid() ? m->rootOf(index.row(), index.column()) : RootCell();
+    if (!root.isValid())
+        return QRect(m_menuPos, QSize(1, 1));
+    return getCellRect(root.row, root.column);
+}
+
+void MultiLevelHeaderView::on_editor_committed(const QStringList &values, const QVariant &context)
+{
+    const QVariantMap ctx = context.toMap();
+    if (ctx.value("kind").toString() == "tool")
+    {
+        qInfo() << "添加的工具为：" << values.value(0) << ",工具位置为：" << values.value(2);
+        // 添加点工具 暂时先发送基本数据类型，后续再改为结构本
+        emit header_add_tool(values.value(0), values.value(2).toInt(), values.value(1));
+    }
+    else
+    {
+        qInfo() << "添加的参数为：" << values.value(0) << ", 参数值为：" << values.value(1);
+        emit header_add_param(ctx.value("tool_col").toInt(), values.value(0), values.value(1), values.value(2).toInt());
+    }
+}
+
 void MultiLevelHeaderView::on_section_clicked(int pos)
 {
     qInfo() << "HeaderView sectionClicked clicked:" << pos;
+    if (!m_sortable && !m_checkBoxes)
+        return;
+    const MultiLevelHeaderModel *m = static_cast<MultiLevelHeaderModel *>(this->model());
+    QModelIndex index = indexAt(m_pressPos);
+    if (!index.isValid())
+        return;
+    RootCell root = m->rootOf(index.row(), index.column());
+    HeaderCellContext cell;
+    if (root.isValid())
+        initCellContext(cell, root.row, root.column);
+    else
+        initCellContext(cell, index.row(), index.column());
+
+    // 检查框：汇总状态为全选时全部取消，否则全部选中
+    if (m_checkBoxes && HeaderCheckBoxLayer::checkBoxRect(cell.rect, style()).contains(m_pressPos))
+    {
+        const Qt::CheckState state = (sectionCheckState(cell.firstSection, cell.lastSection) == Qt::Checked) ? Qt::Unchecked : Qt::Checked;
+        for (int section = cell.firstSection; section <= cell.lastSection; ++section)
+            setSectionCheckState(section, state);
+        emit sectionCheckStateChanged(cell.firstSection, cell.lastSection, state);
+        return;
+    }
+    if (m_sortable && cell.leaf)
+    {
+        const Qt::SortOrder order = (sortIndicatorSection() == cell.firstSection && sortIndicatorOrder() == Qt::AscendingOrder) ? Qt::DescendingOrder : Qt::AscendingOrder;
+        setSortIndicator(cell.firstSection, order);
+        // 排序箭头画在叶子单元格里，QHeaderView只重绘section本身
+        viewport()->update();
+    }
 }
 
 void MultiLevelHeaderView::popup_tool_menu(const QPoint &pos)
@@ -940,7 +1474,9 @@ void MultiLevelHeaderView::popup_tool_menu(const QPoint &pos)
     }
 
     qInfo() << "popup_tool_menu pos row" << index.row() << ",col:" << index.column() << index.isValid() << currentIndex() << currentIndex().isValid();
-    _tool_menu.exec(viewport()->mapToGlobal(pos));
+    // popup不进入嵌套的事件循环
+    m_menuPos = pos;
+    _tool_menu.popup(viewport()->mapToGlobal(pos));
 }
 
 void MultiLevelHeaderView::popup_param_menu(const QPoint &pos)
@@ -957,6 +1493,7 @@ void MultiLevelHeaderView::popup_param_menu(const QPoint &pos)
     QAction* action = _param_menu.menuAction();
     // auto ttt = action->text();
     // _param_menu.activeAction()->setData(click_pos);
-    _param_menu.exec(viewport()->mapToGlobal(pos));
+    m_menuPos = pos;
+    _param_menu.popup(viewport()->mapToGlobal(pos));
     qInfo() << "popup_param_menu "<< _param_menu.pos() << ", global pos:" << mapToGlobal(pos) << pos;
 }
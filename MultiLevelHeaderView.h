@@ -1,15 +1,28 @@
 #pragma once
 
+#include <QCache>
 #include <QHeaderView>
+#include <QList>
 #include <QModelIndex>
 #include <QMenu>
+#include <QMap>
+#include <QPointer>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QTimer>
+#include <QVariantAnimation>
+#include <functional>
+#include <set>
+#include <vector>
 #include "data_model.h"
+#include "HeaderProfiler.h"
+#include "MultiLevelHeaderModel.h"
 
-enum ItemDataRole
-{
-    COLUMN_SPAN_ROLE = Qt::UserRole + 1,
-    ROW_SPAN_ROLE,
-};
+class HeaderInlineEditor;
+class HeaderPaintLayer;
+struct HeaderCellContext;
+class RoleProfilingProxyModel;
 
 class MultiLevelHeaderView : public QHeaderView
 {
@@ -23,10 +36,60 @@ public:
     void setCellData(int row, int column, int role, const QVariant& value);
     // the below methods is just shortcut for setCellData
     void setCellSpan(int row, int column, int rowSpanCount, int columnSpanCount);
+    // 一次设置多个合并单元格，见MultiLevelHeaderModel::setSpans
+    void setCellSpans(const QVector<RootCell>& cells);
     void setCellBackgroundColor(int row, int column, const QColor&);
     void setCellForegroundColor(int row, int column, const QColor&);
     void setCellText(int row, int column, const QString& text);
     void setCellIcon(int row, int column, const QIcon& icon);
+    // 图标文件路径(皮肤内的相对路径)，通过HeaderIconCache预先加载，换肤后自动使用新皮肤的图标
+    void setCellIcon(int row, int column, const QString& iconPath);
+
+    // 级别数：水平表头为行数，竖直表头为列数
+    int levelCount() const;
+    // 插入/删除section，已有的合并单元格随之平移
+    void insertSections(int first, int count);
+    void removeSections(int first, int count);
+    // 一次隐藏/显示一段连续的section：模型的前缀和上是一次O(log n)的区间操作，
+    // QHeaderView没有批量接口，仍逐个setSectionHidden，整体O(k)；期间不重绘，只重绘一次
+    void setSectionRangeHidden(int first, int count, bool hidden);
+    // 折叠/展开一组section，first作为汇总列保留显示；
+    // 汇总列的宽度逐帧过渡，每帧只调整这一个section，与组的大小无关。
+    // expandedHidden是展开时组内各section的隐藏状态(内部仍折叠的子组)，为空表示全部显示
+    void setSectionGroupCollapsed(int first, int count, bool collapsed, const std::vector<char> &expandedHidden = std::vector<char>(), std::function<void()> done = nullptr);
+
+    // 按表头文本和数据内容自动调整section尺寸，dataModel为空时只考虑表头
+    // sampleCount > 0 时每个section最多抽样sampleCount个数据单元格
+    void autoFitSections(const QAbstractItemModel* dataModel = nullptr, int sampleCount = 0);
+
+    // 排序和检查都以叶子(延伸到最后一级的单元格)为单位：点击叶子单元格切换排序，
+    // 点击任意单元格的检查框设置它覆盖的所有叶子section
+    void setSectionsSortable(bool sortable);
+    bool sectionsSortable() const;
+    void setCheckBoxesEnabled(bool enabled);
+    bool checkBoxesEnabled() const;
+    // 状态保存在最后一级单元格的Qt::CheckStateRole/FILTER_ROLE中，随section插入/删除移动
+    void setSectionCheckState(int section, Qt::CheckState state);
+    Qt::CheckState sectionCheckState(int section) const;
+    // [first, last]的汇总：全部选中、全部未选中或部分选中
+    Qt::CheckState sectionCheckState(int first, int last) const;
+    void setSectionFiltered(int section, bool filtered);
+    bool isSectionFiltered(int section) const;
+    bool hasFilteredSections() const;
+    // 自定义绘制层，画在内置层之后、边框之前，表头取得所有权
+    void addPaintLayer(HeaderPaintLayer* layer);
+
+    // 保存/恢复布局：级别尺寸、section尺寸和隐藏状态(游程编码)、合并单元格、排序状态。
+    // 不包含文本。级别数或section数与保存时不同时恢复失败、表头不变
+    QByteArray saveHeaderState() const;
+    bool restoreHeaderState(const QByteArray& state);
+
+    // 性能统计，默认关闭；overlay为true时在表头左上角显示上一帧的统计
+    HeaderProfiler* profiler() const;
+    void setProfilingEnabled(bool enabled, bool overlay = false);
+    // 表头内部读取单元格数据时经过统计代理，按角色/阶段统计data()调用；关闭时返回nullptr
+    RoleProfilingProxyModel* roleProfiler() const;
+    void setRoleProfilingEnabled(bool enabled);
 
     QModelIndex columnSpanIndex(const QModelIndex& currentIndex) const;
     QModelIndex rowSpanIndex(const QModelIndex& currentIndex) const;
@@ -34,9 +97,15 @@ public:
 protected:
     // override
     void mousePressEvent(QMouseEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
     QModelIndex indexAt(const QPoint &point) const override;
     void paintSection(QPainter* painter, const QRect& rect, int logicalIndex) const override;
     QSize sectionSizeFromContents(int logicalIndex) const override;
+    // 单元格数据变化时只记录所在的合并单元格，每帧统一换算成视口区域重绘一次
+    void dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles = QVector<int>()) override;
+    void changeEvent(QEvent* event) override;
+    // 第一次显示时才有窗口，连接screenChanged以便DPR变化后重新预加载图标
+    void showEvent(QShowEvent* event) override;
 
     // inherent features
     int columnSpanSize(int row, int from, int spanCount) const;
@@ -47,28 +116,87 @@ protected:
     int getSectionRange(QModelIndex& index, int* beginSection, int* endSection) const;
     void init_tool_menu();
     void init_param_menu();
+    // 右键菜单所在的合并单元格，输入条显示在它下面
+    QRect menuCellRect() const;
+    void emitToggleCollapse();
+    void levelSizeChanged();
+    // 表头内部统一通过这里读取单元格数据，打开角色统计时经过统计代理
+    QVariant cellData(const QModelIndex& cellIndex, int role) const;
+    // 根单元格(row, column)的绘制信息
+    void initCellContext(HeaderCellContext& cell, int row, int column) const;
+    void drawCell(QPainter* painter, const HeaderCellContext& cell) const;
+    // 只有基础层的普通单元格：按(文本, 尺寸)缓存位图，直接贴图；位图太大放不进缓存时返回false
+    bool drawCachedCell(QPainter* painter, const HeaderCellContext& cell) const;
+    // 最后一级上section对应的单元格
+    QModelIndex leafIndex(int section) const;
+    // 本帧数据变化的合并单元格在视口中的区域
+    QRegion pendingDirtyRegion() const;
+    void shiftPendingSizes(int first, int delta);
+    // 把拖动中的尺寸写入模型，返回需要补画的合并单元格区域
+    QRegion applyPendingResize();
 
 protected slots:
     void onSectionResized(int logicalIdx, int oldSize, int newSize);
+    void flushPendingResize();
+    void flushDirtyCells();
+    // 换肤、换屏幕(DPR)、换风格(图标尺寸)后按新的参数重新读取所有单元格图标，绘制时不读文件
+    void preloadIcons();
     void popup_tool_menu(const QPoint &pos);
 
     void popup_param_menu(const QPoint &pos);
+    void on_editor_committed(const QStringList &values, const QVariant &context);
     // add by hqh
     void on_section_clicked(int pos);
 
 signals:
     void sectionPressed(int from, int to);
+    // 点击检查框改变了[first, last]的检查状态
+    void sectionCheckStateChanged(int first, int last, Qt::CheckState state);
     // 表头添加点工具信号
-    void header_add_tool(QString tool_name, int pos);
+    void header_add_tool(QString tool_name, int pos, QString binary);
 
     // 表头添加点参数信号
     void header_add_param(int tool_id, QString param_key, QString value_list, int param_pos);
+    // 右键菜单"折叠/展开"：level级、section所在的工具或参数
+    void header_toggle_collapse(int level, int section);
 public:
     QList<ToolNode*> tool_list;
     void add_tool(ToolNode* tool_node);
 
 private:
+    // 普通单元格位图缓存的key：按文本本身，不放进LabelTable(绘制时不加锁，改名后旧文本随缓存淘汰)
+    struct CellCacheKey
+    {
+        QString text;
+        QSize size;
+        bool operator==(const CellCacheKey &other) const { return size == other.size && text == other.text; }
+    };
+    friend uint qHash(const CellCacheKey &key, uint seed)
+    {
+        return qHash(key.text, seed) ^ qHash((quint64(key.size.width()) << 32) | quint32(key.size.height()), seed);
+    }
+
     QMenu _tool_menu;
     QMenu _param_menu;
+    QPoint m_menuPos;                // 右键菜单弹出的位置(viewport坐标)
+    QPointer<HeaderInlineEditor> m_editor; // 显示时挂在窗口上，不一定随表头析构
+
+    QTimer m_frameTimer;
+    QMap<int, int> m_pendingSizes;  // 本帧内被拖动的section -> 新尺寸
+    std::set<Cell> m_dirtyCells;    // 本帧内数据变化的根单元格
+    bool m_batchLayout = false;     // 批量隐藏/显示时忽略QHeaderView逐个发出的sectionResized
+    QVariantAnimation m_groupAnimation;
+    std::function<void()> m_groupAnimationDone;
+    mutable HeaderProfiler m_profiler; // paintSection是const的
+    QRect m_overlayRect;               // 统计层上一次绘制的位置
+    RoleProfilingProxyModel* m_roleProfiler = nullptr;
+
+    QList<HeaderPaintLayer*> m_layers;   // 按绘制顺序，最后是边框
+    QPoint m_pressPos;                   // 左键按下的位置，sectionClicked时判断点在哪个单元格上
+    bool m_sortable = false;
+    bool m_checkBoxes = false;
+    QSet<QString> m_iconPaths; // setCellIcon设置过的图标路径
+    mutable QCache<CellCacheKey, QPixmap> m_cellCache; // cost为KB
+    mutable qreal m_cellCacheDpr = 0;
 };
 
@@ -0,0 +1,83 @@
+#include <cstring>
+
+#include <QDataStream>
+#include <QtEndian>
+
+#include "PagedDataSource.h"
+
+BinaryFileDataSource::BinaryFileDataSource(const QString &path) : m_file(path)
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+        return;
+    QDataStream in(&m_file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic = 0, version = 0, reserved = 0;
+    qint64 rows = 0;
+    qint32 columns = 0;
+    in >> magic >> version >> rows >> columns >> reserved;
+    const qint64 expected = HeaderSize + rows * columns * qint64(sizeof(double));
+    if (in.status() != QDataStream::Ok || magic != Magic || version != Version || rows < 0 || columns <= 0 || m_file.size() < expected)
+    {
+        m_file.close();
+        return;
+    }
+    m_rows = rows;
+    m_columns = columns;
+}
+
+bool BinaryFileDataSource::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+qint64 BinaryFileDataSource::rowCount() const
+{
+    return m_rows;
+}
+
+int BinaryFileDataSource::columnCount() const
+{
+    return m_columns;
+}
+
+bool BinaryFileDataSource::readRows(qint64 firstRow, int rowCount, QVector<double> &values) const
+{
+    if (!isOpen() || firstRow < 0 || rowCount <= 0 || firstRow + rowCount > m_rows)
+        return false;
+    const qint64 rowBytes = m_columns * qint64(sizeof(double));
+    values.resize(rowCount * m_columns);
+    char *data = reinterpret_cast<char *>(values.data());
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_file.seek(HeaderSize + firstRow * rowBytes) || m_file.read(data, rowCount * rowBytes) != rowCount * rowBytes)
+            return false;
+    }
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    // 文件中是小端
+    for (double &value : values)
+    {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        bits = qFromLittleEndian(bits);
+        memcpy(&value, &bits, sizeof(bits));
+    }
+#endif
+    return true;
+}
+
+bool BinaryFileDataSource::write(const QString &path, qint64 rows, int columns, const std::function<double(qint64, int)> &value)
+{
+    QFile file(path);
+    if (rows < 0 || columns <= 0 || !file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    out << Magic << Version << rows << qint32(columns) << quint32(0);
+    for (qint64 row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+            out << value(row, column);
+    }
+    return out.status() == QDataStream::Ok;
+}
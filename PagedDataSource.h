@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+// 分页的数据来源：结果集只在需要时按固定行数的页读取，PagedTableModel在工作线程中调用readPage
+class PagedDataSource
+{
+public:
+    virtual ~PagedDataSource() {}
+
+    virtual qint64 rowCount() const = 0;
+    virtual int columnCount() const = 0;
+    // 读取[firstRow, firstRow + rowCount)，按行存放到values(rowCount x columnCount)，
+    // 可能在多个线程中同时调用，必须线程安全
+    virtual bool readRows(qint64 firstRow, int rowCount, QVector<double> &values) const = 0;
+};
+
+// 本地二进制结果文件：文件头(魔数、版本、行数、列数)之后是按行存放的double，
+// 一页就是一段连续的字节，读取时只需要一次seek + read
+class BinaryFileDataSource : public PagedDataSource
+{
+public:
+    explicit BinaryFileDataSource(const QString &path);
+
+    bool isOpen() const;
+    qint64 rowCount() const override;
+    int columnCount() const override;
+    bool readRows(qint64 firstRow, int rowCount, QVector<double> &values) const override;
+
+    // 生成结果文件，value(row, column)给出每个单元格的值，用于测试和基准
+    static bool write(const QString &path, qint64 rows, int columns, const std::function<double(qint64, int)> &value);
+
+private:
+    static const quint32 Magic = 0x50445331; // "PDS1"
+    static const quint32 Version = 1;
+    static const int HeaderSize = 24;        // magic, version, rows(qint64), columns, reserved
+
+    mutable QMutex m_mutex; // 一个文件句柄，seek和read之间不能被打断
+    mutable QFile m_file;
+    qint64 m_rows = 0;
+    int m_columns = 0;
+};
@@ -0,0 +1,206 @@
+#include <limits>
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "PagedDataSource.h"
+#include "PagedTableModel.h"
+
+// 每次fetchMore暴露的页数
+static const int FetchPages = 16;
+static const int DefaultCacheBudget = 64 * 1024 * 1024;
+
+PagedTableModel::PagedTableModel(PagedDataSource *source, int pageRows, QObject *parent)
+    : QAbstractTableModel(parent), m_source(source), m_columns(source->columnCount())
+{
+    // 默认预算要能放下当前页和两边的预取页，否则刚读完的页会被挤掉后又重新请求
+    const qint64 rowBytes = qMax<qint64>(m_columns, 1) * qint64(sizeof(double));
+    const qint64 maxPageRows = DefaultCacheBudget / ((2 * m_prefetchPages + 1) * rowBytes);
+    m_pageRows = int(qBound<qint64>(1, pageRows, qMax<qint64>(maxPageRows, 1)));
+
+    // QAbstractItemModel的行号是int
+    const qint64 rows = qMin<qint64>(source->rowCount(), std::numeric_limits<int>::max());
+    m_pageCount = int((rows + m_pageRows - 1) / m_pageRows);
+    m_exposedRows = int(qMin<qint64>(rows, qint64(m_pageRows) * FetchPages));
+    m_pages.setMaxCost(DefaultCacheBudget);
+    // 顺序读一个文件，两个线程足够让读取和排队重叠
+    m_pool.setMaxThreadCount(2);
+    qRegisterMetaType<QVector<double>>("QVector<double>");
+    connect(this, &PagedTableModel::pageReady, this, &PagedTableModel::onPageReady, Qt::QueuedConnection);
+}
+
+PagedTableModel::~PagedTableModel()
+{
+    // 还在排队的读取不再需要；正在读的等它结束，之后送来的pageReady随模型一起丢弃
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+int PagedTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_exposedRows;
+}
+
+int PagedTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_columns;
+}
+
+QVariant PagedTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole)
+        return QVariant();
+    const int page = index.row() / m_pageRows;
+    const QVector<double> *values = m_pages.object(page);
+    // 先更新焦点页，工作线程按它丢弃滚动离开的预取
+    if (page != m_lastPage)
+        m_focusPage.store(page);
+    if (!values)
+    {
+        // 当前页排在预取之前；读完后发dataChanged，视图再来取
+        ++m_misses;
+        m_wanted.insert(page);
+        requestPage(page, false);
+    }
+    if (page != m_lastPage)
+    {
+        prefetchAround(page);
+        m_lastPage = page;
+    }
+    if (!values)
+        return QVariant();
+    return values->at((index.row() - page * m_pageRows) * m_columns + index.column());
+}
+
+QVariant PagedTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+    return orientation == Qt::Vertical ? QVariant(section + 1) : QVariant(QString("C%1").arg(section + 1));
+}
+
+bool PagedTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_exposedRows < qMin<qint64>(m_source->rowCount(), std::numeric_limits<int>::max());
+}
+
+void PagedTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+    const qint64 total = qMin<qint64>(m_source->rowCount(), std::numeric_limits<int>::max());
+    const int count = int(qMin<qint64>(total - m_exposedRows, qint64(m_pageRows) * FetchPages));
+    beginInsertRows(QModelIndex(), m_exposedRows, m_exposedRows + count - 1);
+    m_exposedRows += count;
+    endInsertRows();
+}
+
+int PagedTableModel::pageRows() const
+{
+    return m_pageRows;
+}
+
+void PagedTableModel::setCacheBudget(int bytes)
+{
+    m_pages.setMaxCost(qMax(bytes, minimumBudget()));
+    m_rejected.clear();
+}
+
+int PagedTableModel::cacheBudget() const
+{
+    return m_pages.maxCost();
+}
+
+void PagedTableModel::setPrefetchPages(int pages)
+{
+    m_prefetchPages = qMax(pages, 0);
+    if (m_pages.maxCost() < minimumBudget())
+        setCacheBudget(minimumBudget());
+}
+
+int PagedTableModel::minimumBudget() const
+{
+    const qint64 bytes = qint64(2 * m_prefetchPages + 1) * m_pageRows * m_columns * qint64(sizeof(double));
+    return int(qMin<qint64>(bytes, std::numeric_limits<int>::max()));
+}
+
+PagedTableModel::Stats PagedTableModel::stats() const
+{
+    Stats stats;
+    stats.pagesRead = m_pagesRead;
+    stats.pagesSkipped = m_skipped.load();
+    stats.misses = m_misses;
+    stats.cachedPages = m_pages.count();
+    stats.cachedBytes = m_pages.totalCost();
+    return stats;
+}
+
+void PagedTableModel::requestPage(int page, bool prefetch) const
+{
+    if (page < 0 || page >= m_pageCount || m_pending.contains(page) || m_pages.contains(page) || m_rejected.contains(page))
+        return;
+    m_pending.insert(page);
+
+    PagedTableModel *self = const_cast<PagedTableModel *>(this);
+    PagedDataSource *source = m_source;
+    const int pageRows = m_pageRows;
+    // 等待期间离开预取窗口的请求不再读取，快速拖动滚动条时不会积压
+    const int window = m_prefetchPages + 2;
+    QtConcurrent::run(&m_pool, [self, source, page, pageRows, window, prefetch]() {
+        QVector<double> values;
+        const bool skipped = prefetch && qAbs(page - self->m_focusPage.load()) > window;
+        if (skipped)
+        {
+            self->m_skipped.ref();
+        }
+        else
+        {
+            const qint64 first = qint64(page) * pageRows;
+            const int rows = int(qMin<qint64>(pageRows, source->rowCount() - first));
+            if (!source->readRows(first, rows, values))
+                values.clear();
+        }
+        emit self->pageReady(page, values, skipped);
+    });
+}
+
+void PagedTableModel::prefetchAround(int page) const
+{
+    m_focusPage.store(page);
+    // 方向未知(第一次访问或跳转)时两边都预取
+    const int direction = (m_lastPage < 0 || qAbs(page - m_lastPage) > 1) ? 0 : page - m_lastPage;
+    for (int i = 1; i <= m_prefetchPages; ++i)
+    {
+        if (direction >= 0)
+            requestPage(page + i, true);
+        if (direction <= 0)
+            requestPage(page - i, true);
+    }
+}
+
+void PagedTableModel::onPageReady(int page, QVector<double> values, bool skipped)
+{
+    m_pending.remove(page);
+    if (skipped && m_wanted.contains(page))
+    {
+        // 作为预取排队时被跳过，但视图已经在等这一页(工作线程判断时焦点还没移过来)
+        requestPage(page, false);
+        return;
+    }
+    m_wanted.remove(page);
+    if (values.isEmpty())
+        return; // 被跳过或读取失败，下次访问时重新请求
+    ++m_pagesRead;
+    const int cost = values.size() * int(sizeof(double));
+    if (!m_pages.insert(page, new QVector<double>(std::move(values)), cost))
+    {
+        // 比整个预算还大，已被QCache删除；视图再来取也拿不到，不发dataChanged也不再请求
+        m_rejected.insert(page);
+        return;
+    }
+
+    const int first = page * m_pageRows;
+    if (first >= m_exposedRows)
+        return;
+    const int last = qMin(first + m_pageRows, m_exposedRows) - 1;
+    emit dataChanged(index(first, 0), index(last, m_columns - 1), { Qt::DisplayRole });
+}
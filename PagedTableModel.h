@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QAtomicInt>
+#include <QCache>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+
+class PagedDataSource;
+
+// 按页加载的只读结果表：data()只查页缓存(LRU，按字节数限制)，没有的页交给工作线程读取，
+// 读完后发出这一页的dataChanged；同时按滚动方向预取后面几页。
+// 行按canFetchMore/fetchMore分批暴露给视图，模型自身的内存占用只取决于页缓存的预算。
+// 限制：视图的QHeaderView仍为每个暴露的行保存section数据，行数很大时视图的内存随暴露的行数增长；
+// EwsTableView目前仍自己创建QStandardItemModel，没有接入本模型，需要时由调用者setModel
+class PagedTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        qint64 pagesRead = 0;    // 从数据源读取的页数
+        qint64 pagesSkipped = 0; // 排队期间已经滚动离开、没有读取的页
+        qint64 misses = 0;       // data()时页不在缓存中
+        int cachedPages = 0;
+        int cachedBytes = 0;
+    };
+
+    // source不归模型所有，生命周期要长于模型
+    explicit PagedTableModel(PagedDataSource *source, int pageRows = 1024, QObject *parent = nullptr);
+    ~PagedTableModel() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    int pageRows() const;
+    // 页缓存的字节预算，默认64MB；至少能放下当前页和两边的预取页，否则取这个下限
+    void setCacheBudget(int bytes);
+    int cacheBudget() const;
+    // 沿滚动方向预取的页数，默认4；预算放不下时同时提高预算
+    void setPrefetchPages(int pages);
+    Stats stats() const;
+
+signals:
+    // 工作线程读完一页，排队送到GUI线程；skipped表示预取在排队期间离开了窗口，没有读取
+    void pageReady(int page, QVector<double> values, bool skipped);
+
+private slots:
+    void onPageReady(int page, QVector<double> values, bool skipped);
+
+private:
+    // prefetch为true时是预取，排队期间离开预取窗口就不再读取；data()直接请求的页总会读取
+    void requestPage(int page, bool prefetch) const;
+    void prefetchAround(int page) const;
+    // 当前页加两边各m_prefetchPages页的字节数
+    int minimumBudget() const;
+
+    PagedDataSource *m_source;
+    int m_pageRows;
+    int m_pageCount;
+    int m_columns;
+    int m_exposedRows = 0;                       // 已经通过fetchMore暴露给视图的行数
+    int m_prefetchPages = 4;
+    mutable QCache<int, QVector<double>> m_pages; // cost为字节数
+    mutable QSet<int> m_pending;                 // 已排队或正在读取的页
+    mutable QSet<int> m_wanted;                  // data()直接请求、还没送到的页
+    QSet<int> m_rejected;                        // 比预算还大、放不进缓存的页，预算变化前不再请求
+    mutable int m_lastPage = -1;                 // 上一次访问的页，用来判断滚动方向
+    mutable QAtomicInt m_focusPage;              // 工作线程据此丢弃已经滚动离开的请求
+    mutable QAtomicInt m_skipped;
+    mutable qint64 m_misses = 0;
+    qint64 m_pagesRead = 0;
+    mutable QThreadPool m_pool;
+};
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+
+#include "RoleProfilingProxyModel.h"
+
+RoleProfilingProxyModel::PhaseScope::PhaseScope(RoleProfilingProxyModel *proxy, const char *phase) : m_proxy(proxy)
+{
+    if (m_proxy)
+    {
+        m_previous = m_proxy->m_phase;
+        m_proxy->m_phase = phase;
+    }
+}
+
+RoleProfilingProxyModel::PhaseScope::~PhaseScope()
+{
+    if (m_proxy)
+        m_proxy->m_phase = m_previous;
+}
+
+RoleProfilingProxyModel::RoleProfilingProxyModel(QObject *parent) : QIdentityProxyModel(parent)
+{
+}
+
+QVariant RoleProfilingProxyModel::data(const QModelIndex &index, int role) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    QVariant value = QIdentityProxyModel::data(index, role);
+    const qint64 nsecs = timer.nsecsElapsed();
+
+    RoleStats &stats = m_roles[role];
+    ++stats.calls;
+    stats.nsecs += nsecs;
+    RoleStats &phaseStats = m_phases[m_phase][role];
+    ++phaseStats.calls;
+    phaseStats.nsecs += nsecs;
+    ++m_rows[index.row()];
+    ++m_columns[index.column()];
+    return value;
+}
+
+void RoleProfilingProxyModel::reset()
+{
+    m_roles.clear();
+    m_phases.clear();
+    m_rows.clear();
+    m_columns.clear();
+}
+
+qint64 RoleProfilingProxyModel::totalCalls() const
+{
+    qint64 calls = 0;
+    for (const RoleStats &stats : m_roles)
+        calls += stats.calls;
+    return calls;
+}
+
+QString RoleProfilingProxyModel::roleName(int role) const
+{
+    QByteArray name = roleNames().value(role);
+    return name.isEmpty() ? QString::number(role) : QString::fromLatin1(name);
+}
+
+QJsonObject RoleProfilingProxyModel::report(int top) const
+{
+    QJsonArray roles;
+    for (auto it = m_roles.cbegin(); it != m_roles.cend(); ++it)
+    {
+        QJsonObject role;
+        role["role"] = roleName(it.key());
+        role["calls"] = it.value().calls;
+        role["ms"] = it.value().nsecs / 1e6;
+        roles.append(role);
+    }
+
+    QJsonObject phases;
+    for (auto it = m_phases.cbegin(); it != m_phases.cend(); ++it)
+    {
+        QJsonObject phase;
+        for (auto r = it.value().cbegin(); r != it.value().cend(); ++r)
+            phase[roleName(r.key())] = r.value().calls;
+        phases[QString::fromLatin1(it.key())] = phase;
+    }
+
+    auto hottest = [top](const QHash<int, qint64> &counts, const char *key) {
+        std::vector<std::pair<qint64, int>> sorted;
+        for (auto it = counts.cbegin(); it != counts.cend(); ++it)
+            sorted.emplace_back(it.value(), it.key());
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<qint64, int> &a, const std::pair<qint64, int> &b) { return a.first > b.first; });
+        QJsonArray result;
+        for (int i = 0; i < (int)sorted.size() && i < top; ++i)
+        {
+            QJsonObject entry;
+            entry[key] = sorted[i].second;
+            entry["calls"] = sorted[i].first;
+            result.append(entry);
+        }
+        return result;
+    };
+
+    QJsonObject report;
+    report["total_calls"] = totalCalls();
+    report["roles"] = roles;
+    report["phases"] = phases;
+    report["rows"] = hottest(m_rows, "row");
+    report["columns"] = hottest(m_columns, "column");
+    return report;
+}
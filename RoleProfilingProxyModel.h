@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QIdentityProxyModel>
+#include <QJsonObject>
+
+// 统计data()调用的代理模型：按角色记录调用次数和耗时，按行/列记录调用次数，
+// 并按调用方所处的阶段(PhaseScope)分别统计，用来找出重复的查询
+// 可以包装表头模型，也可以包装表格的数据模型；只在GUI线程中使用
+class RoleProfilingProxyModel : public QIdentityProxyModel
+{
+    Q_OBJECT
+public:
+    struct RoleStats
+    {
+        qint64 calls = 0;
+        qint64 nsecs = 0;
+    };
+
+    // 作用域内的data()调用计入phase，嵌套时恢复外层的阶段；proxy为空时什么都不做
+    class PhaseScope
+    {
+    public:
+        PhaseScope(RoleProfilingProxyModel *proxy, const char *phase);
+        ~PhaseScope();
+
+    private:
+        Q_DISABLE_COPY(PhaseScope)
+        RoleProfilingProxyModel *m_proxy;
+        QByteArray m_previous;
+    };
+
+    explicit RoleProfilingProxyModel(QObject *parent = nullptr);
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void reset();
+    const QHash<int, RoleStats> &roleStats() const { return m_roles; }
+    qint64 totalCalls() const;
+
+    // {"total_calls", "roles": [...], "phases": {phase: {role: calls}}, "rows": [...], "columns": [...]}
+    // rows/columns只列出调用次数最多的top个
+    QJsonObject report(int top = 10) const;
+
+private:
+    QString roleName(int role) const;
+
+    QByteArray m_phase = "other";
+    mutable QHash<int, RoleStats> m_roles;
+    mutable QHash<QByteArray, QHash<int, RoleStats>> m_phases;
+    mutable QHash<int, qint64> m_rows;
+    mutable QHash<int, qint64> m_columns;
+};
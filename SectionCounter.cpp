@@ -0,0 +1,84 @@
+#include <algorithm>
+
+#include "SectionCounter.h"
+
+SectionCounter::SectionCounter(int count) : m_values(std::max(count, 0), 0)
+{
+    build();
+}
+
+int SectionCounter::count() const
+{
+    return int(m_values.size());
+}
+
+void SectionCounter::insert(int index, int count)
+{
+    if (count <= 0)
+        return;
+    index = std::max(0, std::min(index, this->count()));
+    m_values.insert(m_values.begin() + index, count, 0);
+    build();
+}
+
+void SectionCounter::remove(int index, int count)
+{
+    if (index < 0 || index >= this->count() || count <= 0)
+        return;
+    count = std::min(count, this->count() - index);
+    m_values.erase(m_values.begin() + index, m_values.begin() + index + count);
+    build();
+}
+
+void SectionCounter::set(int index, int value)
+{
+    if (index < 0 || index >= count())
+        return;
+    const int delta = value - m_values[index];
+    if (delta == 0)
+        return;
+    m_values[index] = value;
+    for (int i = index + 1; i < int(m_tree.size()); i += i & -i)
+        m_tree[i] += delta;
+}
+
+int SectionCounter::value(int index) const
+{
+    return (index >= 0 && index < count()) ? m_values[index] : 0;
+}
+
+int SectionCounter::sum(int first, int last) const
+{
+    first = std::max(first, 0);
+    last = std::min(last, count() - 1);
+    if (first > last)
+        return 0;
+    return prefix(last + 1) - prefix(first);
+}
+
+int SectionCounter::total() const
+{
+    return prefix(count());
+}
+
+void SectionCounter::build()
+{
+    // 每个节点加到它的父节点上，O(n)
+    const int n = count();
+    m_tree.assign(n + 1, 0);
+    for (int i = 1; i <= n; ++i)
+    {
+        m_tree[i] += m_values[i - 1];
+        const int parent = i + (i & -i);
+        if (parent <= n)
+            m_tree[parent] += m_tree[i];
+    }
+}
+
+int SectionCounter::prefix(int end) const
+{
+    int sum = 0;
+    for (int i = end; i > 0; i -= i & -i)
+        sum += m_tree[i];
+    return sum;
+}
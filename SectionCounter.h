@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+// 每个section一个计数值的树状数组(Fenwick tree)，与SectionLayout一样随section插入/删除
+// 单点修改和区间求和是 O(log n)，插入/删除需要重建，O(n)
+class SectionCounter
+{
+public:
+    explicit SectionCounter(int count = 0);
+
+    int count() const;
+    // 新插入的section计数为0
+    void insert(int index, int count);
+    void remove(int index, int count);
+
+    void set(int index, int value);
+    int value(int index) const;
+    // [first, last]的计数之和
+    int sum(int first, int last) const;
+    int total() const;
+
+private:
+    void build();
+    int prefix(int end) const; // [0, end)
+
+    std::vector<int> m_values;
+    std::vector<int> m_tree; // 下标从1开始
+};
@@ -0,0 +1,287 @@
+#include <algorithm>
+
+#include "SectionLayout.h"
+
+SectionLayout::SectionLayout(int count, int size) : m_count(0), m_base(1)
+{
+    resize(count, size);
+}
+
+void SectionLayout::resize(int count, int size)
+{
+    if (count < 0)
+        count = 0;
+    pushAll();
+    m_sizes.resize(count, size);
+    m_hidden.resize(count, 0);
+    m_count = count;
+    build();
+}
+
+int SectionLayout::count() const
+{
+    return m_count;
+}
+
+void SectionLayout::insert(int index, int count, int size)
+{
+    if (count <= 0)
+        return;
+    index = std::max(0, std::min(index, m_count));
+    pushAll();
+    m_sizes.insert(m_sizes.begin() + index, count, size);
+    m_hidden.insert(m_hidden.begin() + index, count, 0);
+    m_count += count;
+    build();
+}
+
+void SectionLayout::remove(int index, int count)
+{
+    if (index < 0 || index >= m_count || count <= 0)
+        return;
+    count = std::min(count, m_count - index);
+    pushAll();
+    m_sizes.erase(m_sizes.begin() + index, m_sizes.begin() + index + count);
+    m_hidden.erase(m_hidden.begin() + index, m_hidden.begin() + index + count);
+    m_count -= count;
+    build();
+}
+
+void SectionLayout::reset(const std::vector<int> &sizes, const std::vector<char> &hidden)
+{
+    m_sizes = sizes;
+    m_hidden = hidden;
+    m_count = int(m_sizes.size());
+    m_hidden.resize(m_count, 0);
+    build();
+}
+
+void SectionLayout::build()
+{
+    m_base = 1;
+    while (m_base < m_count)
+        m_base <<= 1;
+    m_sum.assign(2 * m_base, 0);
+    m_raw.assign(2 * m_base, 0);
+    m_lazy.assign(2 * m_base, -1);
+    for (int i = 0; i < m_count; ++i)
+    {
+        m_raw[m_base + i] = m_sizes[i];
+        m_sum[m_base + i] = m_hidden[i] ? 0 : m_sizes[i];
+    }
+    for (int node = m_base - 1; node > 0; --node)
+        pull(node);
+}
+
+void SectionLayout::pushAll()
+{
+    // 父节点的下标总是小于子节点，顺序下推即可把所有标记落到叶子上
+    for (int node = 1; node < m_base && node < (int)m_lazy.size(); ++node)
+        pushDown(node);
+}
+
+void SectionLayout::apply(int node, bool hidden)
+{
+    m_sum[node] = hidden ? 0 : m_raw[node];
+    if (node >= m_base)
+    {
+        if (node - m_base < m_count)
+            m_hidden[node - m_base] = hidden;
+    }
+    else
+    {
+        m_lazy[node] = hidden ? 1 : 0;
+    }
+}
+
+void SectionLayout::pushDown(int node)
+{
+    if (m_lazy[node] < 0)
+        return;
+    apply(2 * node, m_lazy[node] == 1);
+    apply(2 * node + 1, m_lazy[node] == 1);
+    m_lazy[node] = -1;
+}
+
+void SectionLayout::pull(int node)
+{
+    m_sum[node] = m_sum[2 * node] + m_sum[2 * node + 1];
+    m_raw[node] = m_raw[2 * node] + m_raw[2 * node + 1];
+}
+
+void SectionLayout::assign(int node, int lo, int hi, int first, int last, bool hidden)
+{
+    if (last <= lo || hi <= first)
+        return;
+    if (first <= lo && hi <= last)
+    {
+        apply(node, hidden);
+        return;
+    }
+    pushDown(node);
+    int mid = (lo + hi) / 2;
+    assign(2 * node, lo, mid, first, last, hidden);
+    assign(2 * node + 1, mid, hi, first, last, hidden);
+    pull(node);
+}
+
+void SectionLayout::setHidden(int first, int count, bool hidden)
+{
+    first = std::max(0, first);
+    int last = std::min(m_count, first + count);
+    if (first >= last)
+        return;
+    assign(1, 0, m_base, first, last, hidden);
+}
+
+bool SectionLayout::isHidden(int index) const
+{
+    if (index < 0 || index >= m_count)
+        return false;
+    int node = 1;
+    int lo = 0;
+    int width = m_base;
+    while (node < m_base)
+    {
+        if (m_lazy[node] >= 0)
+            return m_lazy[node] == 1;
+        width >>= 1;
+        if (index < lo + width)
+        {
+            node = 2 * node;
+        }
+        else
+        {
+            lo += width;
+            node = 2 * node + 1;
+        }
+    }
+    return m_hidden[index];
+}
+
+void SectionLayout::setSize(int index, int size)
+{
+    if (index < 0 || index >= m_count || m_sizes[index] == size)
+        return;
+
+    int node = 1;
+    int lo = 0;
+    int width = m_base;
+    while (node < m_base)
+    {
+        pushDown(node);
+        width >>= 1;
+        if (index < lo + width)
+        {
+            node = 2 * node;
+        }
+        else
+        {
+            lo += width;
+            node = 2 * node + 1;
+        }
+    }
+    m_sizes[index] = size;
+    m_raw[node] = size;
+    m_sum[node] = m_hidden[index] ? 0 : size;
+    for (node >>= 1; node > 0; node >>= 1)
+        pull(node);
+}
+
+int SectionLayout::size(int index) const
+{
+    if (index < 0 || index >= m_count)
+        return 0;
+    return m_sizes[index];
+}
+
+int SectionLayout::value(int node, int forced) const
+{
+    // forced是祖先上的延迟标记，它覆盖子树中所有更深的标记
+    if (forced < 0)
+        return m_sum[node];
+    return forced ? 0 : m_raw[node];
+}
+
+int SectionLayout::prefix(int index, bool raw) const
+{
+    if (index <= 0)
+        return 0;
+    if (index >= m_count)
+        return raw ? m_raw[1] : total();
+
+    // walk down from the root and add every left subtree we step over
+    int pos = 0;
+    int node = 1;
+    int lo = 0;
+    int width = m_base;
+    int forced = -1;
+    while (node < m_base)
+    {
+        if (!raw && forced < 0 && m_lazy[node] >= 0)
+            forced = m_lazy[node];
+        if (!raw && forced == 1)
+            return pos; // 下面的section全部隐藏
+        width >>= 1;
+        if (index < lo + width)
+        {
+            node = 2 * node;
+        }
+        else
+        {
+            pos += raw ? m_raw[2 * node] : value(2 * node, forced);
+            lo += width;
+            node = 2 * node + 1;
+        }
+    }
+    return pos;
+}
+
+int SectionLayout::position(int index) const
+{
+    return prefix(index, false);
+}
+
+int SectionLayout::extent(int from, int spanCount) const
+{
+    if (spanCount <= 0)
+        return 0;
+    return position(from + spanCount) - position(from);
+}
+
+int SectionLayout::rawExtent(int from, int spanCount) const
+{
+    if (spanCount <= 0)
+        return 0;
+    return prefix(from + spanCount, true) - prefix(from, true);
+}
+
+int SectionLayout::total() const
+{
+    return m_count > 0 ? m_sum[1] : 0;
+}
+
+int SectionLayout::indexAt(int pos) const
+{
+    if (pos < 0 || pos >= total())
+        return -1;
+
+    int node = 1;
+    int forced = -1;
+    while (node < m_base)
+    {
+        if (forced < 0 && m_lazy[node] >= 0)
+            forced = m_lazy[node];
+        int left = value(2 * node, forced);
+        if (pos < left)
+        {
+            node = 2 * node;
+        }
+        else
+        {
+            pos -= left;
+            node = 2 * node + 1;
+        }
+    }
+    return node - m_base;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+// 表头各section尺寸的前缀和索引（线段树）
+// 位置、合并单元格跨度和命中测试都是 O(log n)，不再逐个section累加
+// 隐藏/显示一段连续的section是延迟标记的区间操作，同样是 O(log n)
+class SectionLayout
+{
+public:
+    explicit SectionLayout(int count = 0, int size = 0);
+
+    void resize(int count, int size = 0);
+    int count() const;
+    // 插入/删除需要重建整棵树，O(n)
+    void insert(int index, int count, int size);
+    void remove(int index, int count);
+    // 一次替换全部尺寸和隐藏状态(恢复保存的布局)，O(n)
+    void reset(const std::vector<int> &sizes, const std::vector<char> &hidden);
+
+    // size() is the stored size, hidden sections keep it for when they are shown again
+    void setSize(int index, int size);
+    int size(int index) const;
+    void setHidden(int first, int count, bool hidden);
+    bool isHidden(int index) const;
+
+    // sum of the visible sizes of all sections before index
+    int position(int index) const;
+    // sum of the visible sizes of [from, from + spanCount)
+    int extent(int from, int spanCount) const;
+    // same as extent() but hidden sections are counted with their stored size
+    int rawExtent(int from, int spanCount) const;
+    int total() const;
+    // section which contains pos, -1 if pos is outside
+    int indexAt(int pos) const;
+
+private:
+    void build();
+    void pushAll();
+    void apply(int node, bool hidden);
+    void pushDown(int node);
+    void pull(int node);
+    void assign(int node, int lo, int hi, int first, int last, bool hidden);
+    int value(int node, int forced) const;
+    int prefix(int index, bool raw) const;
+
+    int m_count;
+    int m_base;                 // leaf count, power of two
+    std::vector<int> m_sizes;
+    std::vector<char> m_hidden; // 叶子的隐藏状态，祖先上有延迟标记时以标记为准
+    // m_sum[1] is the root, leaves start at m_base
+    std::vector<int> m_sum;     // 可见尺寸之和
+    std::vector<int> m_raw;     // 不考虑隐藏的尺寸之和
+    std::vector<signed char> m_lazy; // -1 无标记，0 整棵子树显示，1 整棵子树隐藏
+};
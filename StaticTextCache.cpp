@@ -0,0 +1,188 @@
+#include <QCoreApplication>
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QStyle>
+#include <QTextOption>
+
+#include "HeaderProfiler.h"
+#include "LabelTable.h"
+#include "StaticTextCache.h"
+
+// 默认4MB，几万个表头/单元格文本
+static const int DefaultByteBudget = 4 * 1024 * 1024;
+
+StaticTextCache *StaticTextCache::instance()
+{
+    static StaticTextCache cache;
+    return &cache;
+}
+
+StaticTextCache::StaticTextCache()
+{
+    m_entries.setMaxCost(DefaultByteBudget);
+    m_cellEntries.setMaxCost(DefaultByteBudget);
+    // 静态对象析构时QApplication已经不在了，排好的字形要在这之前释放
+    qAddPostRoutine([]() { StaticTextCache::instance()->clear(); });
+}
+
+int StaticTextCache::fontId(const QFont &font)
+{
+    const QString key = font.key();
+    auto it = m_fontIds.constFind(key);
+    if (it != m_fontIds.constEnd())
+        return it.value();
+    const int id = m_fontIds.size();
+    m_fontIds.insert(key, id);
+    return id;
+}
+
+StaticTextCache::Entry *StaticTextCache::layout(const QString &source, int width, int flags, const QFont &font, int &cost)
+{
+    // 与QPainter::drawText一样，换行符按行分隔符排版
+    QString text = source;
+    text.replace(QLatin1Char('\n'), QChar::LineSeparator);
+
+    QFontMetricsF fm(font);
+    Entry *entry = new Entry;
+    QTextOption option(Qt::Alignment(flags & Qt::AlignHorizontal_Mask));
+    option.setWrapMode((flags & Qt::TextWordWrap) ? QTextOption::WordWrap : QTextOption::NoWrap);
+    entry->text.setTextFormat(Qt::PlainText);
+    entry->text.setPerformanceHint(QStaticText::AggressiveCaching);
+    entry->text.setTextOption(option);
+    // 多行文本按最宽的一行对齐
+    entry->text.setTextWidth(width >= 0 ? width : fm.size(0, source).width());
+    entry->text.setText(text);
+    entry->text.prepare(QTransform(), font);
+    entry->size = entry->text.size();
+
+    // QStaticText不报告内存占用，按每个字符一个字形(索引 + 坐标)加上对象本身估算
+    cost = int(sizeof(Entry)) + 256 + text.size() * int(sizeof(quint32) + 2 * sizeof(qreal) + sizeof(QChar));
+    return entry;
+}
+
+StaticTextCache::Entry *StaticTextCache::prepare(const Key &key, const QFont &font)
+{
+    int cost = 0;
+    Entry *entry = layout(LabelTable::instance()->text(key.labelId), key.width, key.flags, font, cost);
+    if (!m_entries.insert(key, entry, cost))
+        return nullptr; // 比整个预算还大，已被QCache删除
+    return entry;
+}
+
+void StaticTextCache::countLookup(bool hit, HeaderProfiler *profiler)
+{
+    if (hit)
+        ++m_hits;
+    else
+        ++m_misses;
+    if (profiler)
+        profiler->count(hit ? HeaderProfiler::TextCacheHits : HeaderProfiler::TextCacheMisses);
+}
+
+void StaticTextCache::drawText(QPainter *painter, const QRect &rect, int flags, int labelId, HeaderProfiler *profiler)
+{
+    if (labelId <= 0)
+        return;
+    const bool wrap = (flags & Qt::TextWordWrap);
+    const Key key = { labelId, fontId(painter->font()), wrap ? rect.width() : -1, flags & (Qt::AlignHorizontal_Mask | Qt::TextWordWrap) };
+
+    Entry *entry = m_entries.object(key);
+    countLookup(entry, profiler);
+    if (!entry)
+    {
+        entry = prepare(key, painter->font());
+        if (!entry)
+        {
+            painter->drawText(rect, flags, LabelTable::instance()->text(labelId));
+            return;
+        }
+    }
+    draw(painter, rect, flags, entry);
+}
+
+bool StaticTextCache::drawCellText(QPainter *painter, const QRect &rect, int flags, const QString &text, HeaderProfiler *profiler)
+{
+    if (text.isEmpty())
+        return true;
+    flags &= ~Qt::TextWordWrap;
+    const CellKey key = { text, fontId(painter->font()), flags & Qt::AlignHorizontal_Mask };
+    Entry *entry = m_cellEntries.object(key);
+    countLookup(entry, profiler);
+    if (!entry)
+    {
+        int cost = 0;
+        entry = layout(text, -1, flags, painter->font(), cost);
+        const QSizeF size = entry->size;
+        if (!m_cellEntries.insert(key, entry, cost))
+        {
+            // 比整个预算还大，已被QCache删除
+            if (size.width() > rect.width())
+                return false;
+            painter->drawText(rect, flags, text);
+            return true;
+        }
+    }
+    if (entry->size.width() > rect.width())
+        return false;
+    draw(painter, rect, flags, entry);
+    return true;
+}
+
+void StaticTextCache::draw(QPainter *painter, const QRect &rect, int flags, const Entry *entry)
+{
+    // 文本块在rect中的位置，块内各行的水平对齐由QTextOption处理
+    const Qt::Alignment align = QStyle::visualAlignment(painter->layoutDirection(), Qt::Alignment(flags));
+    QPointF pos = rect.topLeft();
+    if (align & Qt::AlignRight)
+        pos.rx() += rect.width() - entry->size.width();
+    else if (align & Qt::AlignHCenter)
+        pos.rx() += (rect.width() - entry->size.width()) / 2;
+    if (align & Qt::AlignBottom)
+        pos.ry() += rect.height() - entry->size.height();
+    else if (align & Qt::AlignVCenter)
+        pos.ry() += (rect.height() - entry->size.height()) / 2;
+    // 与QPainter::drawText(rect, ...)一样，放不下时裁剪到rect内，不画到相邻的section上
+    if ((flags & Qt::TextDontClip) || (entry->size.width() <= rect.width() && entry->size.height() <= rect.height()))
+    {
+        painter->drawStaticText(pos, entry->text);
+        return;
+    }
+    painter->save();
+    painter->setClipRect(rect, Qt::IntersectClip);
+    painter->drawStaticText(pos, entry->text);
+    painter->restore();
+}
+
+void StaticTextCache::drawText(QPainter *painter, const QRect &rect, int flags, const QString &text, HeaderProfiler *profiler)
+{
+    drawText(painter, rect, flags, LabelTable::instance()->intern(text), profiler);
+}
+
+void StaticTextCache::setByteBudget(int bytes)
+{
+    m_entries.setMaxCost(bytes);
+    m_cellEntries.setMaxCost(bytes);
+}
+
+int StaticTextCache::byteBudget() const
+{
+    return m_entries.maxCost();
+}
+
+StaticTextCache::Stats StaticTextCache::stats() const
+{
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.entries = m_entries.count() + m_cellEntries.count();
+    stats.bytes = m_entries.totalCost() + m_cellEntries.totalCost();
+    return stats;
+}
+
+void StaticTextCache::clear()
+{
+    m_entries.clear();
+    m_cellEntries.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
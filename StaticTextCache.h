@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QCache>
+#include <QFont>
+#include <QHash>
+#include <QRect>
+#include <QSizeF>
+#include <QStaticText>
+#include <QString>
+
+class HeaderProfiler;
+class QPainter;
+
+// 文本排版缓存：表头的静态文本按(文本id, 字体, 宽度, 对齐)排版成QStaticText，
+// 之后每次绘制只画已经排好的字形，不再重新整形。按估算的字节数做LRU淘汰。
+// 文本id来自LabelTable，只用于数量有限的表头标签；表格单元格和多级表头的文本可能各不相同或经常修改，
+// 用drawCellText按字符串缓存，不进LabelTable，淘汰后整个释放。只在GUI线程中使用
+class StaticTextCache
+{
+public:
+    struct Stats
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        int entries = 0;
+        int bytes = 0;
+    };
+
+    static StaticTextCache *instance();
+
+    // 与QPainter::drawText(rect, flags, text)相同的对齐方式，不换行时宽度不参与key；
+    // 使用painter当前的字体和画笔。profiler不为空时记录命中/未命中
+    void drawText(QPainter *painter, const QRect &rect, int flags, int labelId, HeaderProfiler *profiler = nullptr);
+    // 文本放进LabelTable，只用于表头标签这类数量有限的文本
+    void drawText(QPainter *painter, const QRect &rect, int flags, const QString &text, HeaderProfiler *profiler = nullptr);
+    // 按字符串缓存的文本，不换行(换行符仍分行)；排版后比rect宽时不画并返回false，由调用者画省略号或裁剪
+    bool drawCellText(QPainter *painter, const QRect &rect, int flags, const QString &text, HeaderProfiler *profiler = nullptr);
+
+    // 表头文本和单元格文本各用一份预算
+    void setByteBudget(int bytes);
+    int byteBudget() const;
+    Stats stats() const;
+    void clear();
+
+private:
+    struct Key
+    {
+        int labelId;
+        int fontId;
+        int width;
+        int flags;
+        bool operator==(const Key &other) const
+        {
+            return labelId == other.labelId && fontId == other.fontId && width == other.width && flags == other.flags;
+        }
+    };
+    friend uint qHash(const Key &key, uint seed)
+    {
+        return qHash((quint64(key.labelId) << 32) | quint32(key.fontId), seed) ^ qHash((quint64(key.width) << 32) | quint32(key.flags), seed);
+    }
+
+    struct CellKey
+    {
+        QString text;
+        int fontId;
+        int flags;
+        bool operator==(const CellKey &other) const
+        {
+            return fontId == other.fontId && flags == other.flags && text == other.text;
+        }
+    };
+    friend uint qHash(const CellKey &key, uint seed)
+    {
+        return qHash(key.text, seed) ^ qHash((quint64(key.fontId) << 32) | quint32(key.flags), seed);
+    }
+
+    struct Entry
+    {
+        QStaticText text;
+        QSizeF size;
+    };
+
+    StaticTextCache();
+    int fontId(const QFont &font);
+    Entry *prepare(const Key &key, const QFont &font);
+    // 排版text，cost为估算的字节数；width < 0时按最宽的一行
+    static Entry *layout(const QString &text, int width, int flags, const QFont &font, int &cost);
+    void countLookup(bool hit, HeaderProfiler *profiler);
+    static void draw(QPainter *painter, const QRect &rect, int flags, const Entry *entry);
+
+    QHash<QString, int> m_fontIds;  // QFont::key() -> font id
+    QCache<Key, Entry> m_entries;   // cost为估算的字节数
+    QCache<CellKey, Entry> m_cellEntries;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
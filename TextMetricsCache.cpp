@@ -0,0 +1,61 @@
+#include <QFontMetrics>
+
+#include "TextMetricsCache.h"
+#include "LabelTable.h"
+
+TextMetricsCache *TextMetricsCache::instance()
+{
+    static TextMetricsCache cache;
+    return &cache;
+}
+
+int TextMetricsCache::fontId(const QFont &font)
+{
+    const QString key = font.key();
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_fontIds.constFind(key);
+        if (it != m_fontIds.constEnd())
+            return it.value();
+    }
+    QWriteLocker locker(&m_lock);
+    auto it = m_fontIds.constFind(key);
+    if (it != m_fontIds.constEnd())
+        return it.value();
+    int id = m_fontIds.size();
+    m_fontIds.insert(key, id);
+    return id;
+}
+
+QSize TextMetricsCache::textSize(const QFont &font, int labelId)
+{
+    if (labelId <= 0)
+        return QSize(0, 0);
+
+    const quint64 key = (quint64(fontId(font)) << 32) | quint32(labelId);
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_sizes.constFind(key);
+        if (it != m_sizes.constEnd())
+            return it.value();
+    }
+
+    // 在锁外测量，最坏情况是两个线程重复测量同一个文本
+    QFontMetrics fm(font);
+    QSize size = fm.size(0, LabelTable::instance()->text(labelId));
+
+    QWriteLocker locker(&m_lock);
+    m_sizes.insert(key, size);
+    return size;
+}
+
+QSize TextMetricsCache::textSize(const QFont &font, const QString &text)
+{
+    return textSize(font, LabelTable::instance()->intern(text));
+}
+
+void TextMetricsCache::clear()
+{
+    QWriteLocker locker(&m_lock);
+    m_sizes.clear();
+}
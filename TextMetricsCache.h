@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QFont>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSize>
+
+// 文本尺寸缓存，key为(字体, 文本id)，文本id来自LabelTable
+// 自动列宽在线程池中测量大量单元格，同一个字符串只用QFontMetrics测量一次
+class TextMetricsCache
+{
+public:
+    static TextMetricsCache *instance();
+
+    // 不换行排版的尺寸，多行文本按换行符分行
+    QSize textSize(const QFont &font, int labelId);
+    // 文本会被LabelTable驻留且不释放，只用于表头标签这类数量有限的文本，数据单元格不要用
+    QSize textSize(const QFont &font, const QString &text);
+    // 字体或DPI变化后清空尺寸，字体id保留
+    void clear();
+
+private:
+    TextMetricsCache() {}
+    int fontId(const QFont &font);
+
+    QReadWriteLock m_lock;
+    QHash<QString, int> m_fontIds;   // QFont::key() -> 字体id
+    QHash<quint64, QSize> m_sizes;   // (字体id << 32) | 文本id -> 尺寸
+};
@@ -0,0 +1,81 @@
+#include "UpdateQueue.h"
+
+UpdateQueue::UpdateQueue(int capacity) : m_enqueuePos(0), m_rejected(0)
+{
+    size_t size = 2;
+    while (size < size_t(qMax(capacity, 2)))
+        size <<= 1;
+    m_slots.reset(new Slot[size]);
+    m_mask = size - 1;
+    // 槽位i的序号等于i时可以写入，等于i + 1时可以读取
+    for (size_t i = 0; i < size; ++i)
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool UpdateQueue::push(int row, int column, double value)
+{
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &slot = m_slots[pos & m_mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos);
+        if (diff == 0)
+        {
+            // 抢到pos后这个槽位只属于当前线程
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.update = { qint32(row), qint32(column), value };
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // 槽位还没被消费者取走，队列满
+            m_rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+int UpdateQueue::size() const
+{
+    const size_t enqueued = m_enqueuePos.load(std::memory_order_relaxed);
+    return int(qMin<size_t>(enqueued - qMin(enqueued, m_dequeuePos), m_mask + 1));
+}
+
+UpdateQueue::Stats UpdateQueue::stats() const
+{
+    Stats stats;
+    stats.pushed = qint64(m_enqueuePos.load(std::memory_order_relaxed));
+    stats.rejected = m_rejected.load(std::memory_order_relaxed);
+    stats.drained = m_drained;
+    stats.highWater = m_highWater;
+    stats.capacity = int(m_mask + 1);
+    return stats;
+}
+
+int UpdateQueue::drain(QVector<CellUpdate> &out, int max)
+{
+    m_highWater = qMax(m_highWater, size());
+    int count = 0;
+    while (count < max)
+    {
+        Slot &slot = m_slots[m_dequeuePos & m_mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        // 生产者已经抢到位置但还没写完时停在这里，下一帧再取
+        if (sequence != m_dequeuePos + 1)
+            break;
+        out.append(slot.update);
+        slot.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+        ++m_dequeuePos;
+        ++count;
+    }
+    m_drained += count;
+    return count;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QVector>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// 一个单元格的新值，16字节
+struct CellUpdate
+{
+    qint32 row;
+    qint32 column;
+    double value;
+};
+
+// 工作线程向表格提交结果的通道：有界的无锁多生产者单消费者环形队列(每个槽位带序号)。
+// 生产者push只有一次CAS和两次原子读写，不分配内存；GUI线程每帧drain一次，批量写入模型。
+// 队列满时push返回false，由生产者决定重试、合并还是丢弃，stats()里可以看到背压情况
+class UpdateQueue
+{
+public:
+    struct Stats
+    {
+        qint64 pushed = 0;   // 成功入队
+        qint64 rejected = 0; // 队列满被拒绝
+        qint64 drained = 0;  // 已被GUI线程取走
+        int highWater = 0;   // 一次drain时队列中最多的记录数
+        int capacity = 0;
+    };
+
+    // capacity向上取整为2的幂
+    explicit UpdateQueue(int capacity = 1 << 16);
+
+    // 任意线程
+    bool push(int row, int column, double value);
+
+    // 以下只能在消费者线程(GUI线程)中调用
+    // 最多取max条追加到out，返回取出的条数
+    int drain(QVector<CellUpdate> &out, int max);
+    int size() const;
+    Stats stats() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        CellUpdate update;
+    };
+
+    Q_DISABLE_COPY(UpdateQueue)
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    // 生产者和消费者的位置隔开一个缓存行，避免互相使对方的缓存失效
+    char m_padding0[64];
+    std::atomic<size_t> m_enqueuePos;
+    char m_padding1[64];
+    size_t m_dequeuePos = 0;
+    std::atomic<qint64> m_rejected;
+    qint64 m_drained = 0;
+    int m_highWater = 0;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "MultiLevelHeaderView.h"
+
+// 把受保护的接口开放给基准和压力测试
+class BenchHeaderView : public MultiLevelHeaderView
+{
+public:
+    using MultiLevelHeaderView::MultiLevelHeaderView;
+    using MultiLevelHeaderView::indexAt;
+    using MultiLevelHeaderView::flushPendingResize;
+    using MultiLevelHeaderView::pendingDirtyRegion;
+    using MultiLevelHeaderView::flushDirtyCells;
+};
@@ -0,0 +1,497 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonArray>
+#include <QStandardItemModel>
+#include <QRegion>
+#include <QScrollBar>
+#include <QTableView>
+#include <QTemporaryDir>
+
+#include "BenchHeaderView.h"
+#include "ColumnarTableModel.h"
+#include "EwsTableView.h"
+#include "PagedDataSource.h"
+#include "PagedTableModel.h"
+#include "FastItemDelegate.h"
+#include "HCommonHeaderView.h"
+#include "HeaderIconCache.h"
+#include "HeaderBenchmark.h"
+#include "HeaderTree.h"
+#include "RoleProfilingProxyModel.h"
+#include "StaticTextCache.h"
+#include "UpdateQueue.h"
+
+namespace
+{
+// 除最后一级外，第l级每 2^(levels-1-l) 个section合并成一组，最多64个
+void buildHeader(BenchHeaderView &header, int levels, int columns)
+{
+    for (int level = 0; level < levels; ++level)
+    {
+        int group = level == levels - 1 ? 1 : std::min(64, 1 << (levels - 1 - level));
+        for (int first = 0; first < columns; first += group)
+        {
+            int span = std::min(group, columns - first);
+            if (span > 1)
+                header.setCellSpan(level, first, 1, span);
+            header.setCellText(level, first, QString("L%1-%2").arg(level).arg(first));
+        }
+    }
+}
+
+double msPer(qint64 nsecs, int count)
+{
+    return count > 0 ? nsecs / 1e6 / count : 0.0;
+}
+}
+
+HeaderBenchmark::HeaderBenchmark(const BenchmarkOptions &options) : m_options(options)
+{
+}
+
+QJsonObject HeaderBenchmark::run()
+{
+    QJsonArray results;
+    for (int levels : m_options.levels)
+    {
+        for (int columns : m_options.columns)
+            results.append(measure(columns, levels));
+    }
+    // 单级的HCommonHeaderView与多级表头使用相同的列数和帧数
+    for (int columns : m_options.columns)
+        results.append(measureCommon(columns));
+    for (int columns : m_options.columns)
+        results.append(measureCollapse(columns));
+    // 表格单元格数随列数增长，10万列时模型本身就要几百MB，只测到1万列
+    for (int columns : m_options.columns)
+    {
+        if (columns <= 10000)
+            results.append(measureTable(columns));
+    }
+    results.append(measurePaged());
+    results.append(measureIngestion());
+
+    QJsonObject report;
+    report["platform"] = QGuiApplication::platformName();
+    report["qt"] = QString(qVersion());
+    report["frames"] = m_options.frames;
+    report["hit_tests"] = m_options.hitTests;
+    report["results"] = results;
+    return report;
+}
+
+QJsonObject HeaderBenchmark::measure(int columns, int levels) const
+{
+    QElapsedTimer timer;
+    QJsonObject result;
+    result["view"] = "MultiLevelHeaderView";
+    result["columns"] = columns;
+    result["levels"] = levels;
+
+    // build
+    timer.start();
+    BenchHeaderView header(Qt::Horizontal, levels, columns);
+    buildHeader(header, levels, columns);
+    result["build_ms"] = msPer(timer.nsecsElapsed(), 1);
+
+    int height = m_options.viewport.height() > 0 ? m_options.viewport.height() : header.sizeHint().height();
+    header.resize(m_options.viewport.width(), height);
+    header.show();
+    QCoreApplication::processEvents();
+
+    // paint
+    QImage image(header.size(), QImage::Format_ARGB32_Premultiplied);
+    timer.restart();
+    for (int frame = 0; frame < m_options.frames; ++frame)
+        header.render(&image);
+    result["paint_ms_per_frame"] = msPer(timer.nsecsElapsed(), m_options.frames);
+
+    // 带图标的第0级：绘制过程中不应再读图标文件
+    for (int first = 0; first < std::min(columns, 64); ++first)
+        header.setCellIcon(0, first, QCoreApplication::applicationDirPath() + "/tool.png");
+    const int iconLoads = HeaderIconCache::instance()->loadCount();
+    header.render(&image);
+    result["paint_icon_loads"] = HeaderIconCache::instance()->loadCount() - iconLoads;
+
+    // 一帧中表头内部各角色的data()调用次数，用来确认多余的查询已经去掉
+    header.setRoleProfilingEnabled(true);
+    header.render(&image);
+    QJsonObject dataCalls;
+    for (const QJsonValue &role : header.roleProfiler()->report()["roles"].toArray())
+        dataCalls[role.toObject()["role"].toString()] = role.toObject()["calls"];
+    result["paint_data_calls"] = dataCalls;
+    header.setRoleProfilingEnabled(false);
+
+    // 绘制层：普通单元格贴缓存位图的个数、执行的绘制层数，再打开排序和检查框测一次
+    HeaderProfiler *profiler = header.profiler();
+    profiler->setEnabled(true);
+    header.render(&image);
+    result["paint_blits"] = profiler->lastFrame().counters[HeaderProfiler::CachedCells];
+    result["paint_layers"] = profiler->lastFrame().counters[HeaderProfiler::LayersRun];
+    header.setSectionsSortable(true);
+    header.setCheckBoxesEnabled(true);
+    header.setSortIndicator(0, Qt::AscendingOrder);
+    for (int first = 0; first < columns; first += 2)
+        header.setSectionCheckState(first, Qt::Checked);
+    timer.restart();
+    for (int frame = 0; frame < m_options.frames; ++frame)
+        header.render(&image);
+    result["paint_decorated_ms_per_frame"] = msPer(timer.nsecsElapsed(), m_options.frames);
+    result["paint_decorated_layers"] = profiler->lastFrame().counters[HeaderProfiler::LayersRun];
+    result["paint_decorated_text_misses"] = profiler->lastFrame().counters[HeaderProfiler::TextCacheMisses];
+    header.setSectionsSortable(false);
+    header.setCheckBoxesEnabled(false);
+    profiler->setEnabled(false);
+
+    // index_at
+    std::mt19937 rng(columns * 31 + levels);
+    std::uniform_int_distribution<int> xs(0, header.width() - 1);
+    std::uniform_int_distribution<int> ys(0, header.height() - 1);
+    int hits = 0;
+    timer.restart();
+    for (int i = 0; i < m_options.hitTests; ++i)
+    {
+        if (header.indexAt(QPoint(xs(rng), ys(rng))).isValid())
+            ++hits;
+    }
+    result["index_at_ns"] = double(timer.nsecsElapsed()) / std::max(1, m_options.hitTests);
+    result["index_at_hits"] = hits;
+
+    // resize_drag：鼠标每帧产生几次移动事件，只在帧末flush一次
+    const int movesPerFrame = 4;
+    int section = std::min(2, columns - 1);
+    int baseSize = header.sectionSize(section);
+    qint64 resizeNs = 0;
+    timer.restart();
+    for (int frame = 0; frame < m_options.frames; ++frame)
+    {
+        QElapsedTimer resizeTimer;
+        resizeTimer.start();
+        for (int move = 1; move <= movesPerFrame; ++move)
+            header.resizeSection(section, baseSize + (frame * movesPerFrame + move) % 80);
+        header.flushPendingResize();
+        resizeNs += resizeTimer.nsecsElapsed();
+        header.render(&image);
+    }
+    result["resize_ms_per_frame"] = msPer(resizeNs, m_options.frames);
+    result["drag_frame_ms"] = msPer(timer.nsecsElapsed(), m_options.frames);
+
+    // label_burst：一帧内修改1000个表头文本，统计换算出的重绘区域
+    const int burst = 1000;
+    std::uniform_int_distribution<int> cols(0, columns - 1);
+    std::uniform_int_distribution<int> rows(0, levels - 1);
+    header.flushDirtyCells();
+    timer.restart();
+    for (int i = 0; i < burst; ++i)
+        header.setCellText(rows(rng), cols(rng), QString("B%1").arg(i));
+    QRegion dirty = header.pendingDirtyRegion();
+    result["label_burst_ms"] = msPer(timer.nsecsElapsed(), 1);
+    result["label_burst_rects"] = dirty.rectCount();
+    header.flushDirtyCells();
+
+    // state_restore：保存布局后恢复一次
+    QByteArray state = header.saveHeaderState();
+    timer.restart();
+    header.restoreHeaderState(state);
+    result["state_restore_ms"] = msPer(timer.nsecsElapsed(), 1);
+    result["state_bytes"] = state.size();
+
+    return result;
+}
+
+QJsonObject HeaderBenchmark::measureCommon(int columns) const
+{
+    QElapsedTimer timer;
+    QJsonObject result;
+    result["view"] = "HCommonHeaderView";
+    result["columns"] = columns;
+    result["levels"] = 1;
+
+    // build：每个section的文本、排序列和检查框列都打开，绘制时各个分支都会走到
+    timer.start();
+    QStandardItemModel model(0, columns);
+    HCommonHeaderView header(Qt::Horizontal);
+    header.setModel(&model);
+    QStringList labels;
+    labels.reserve(columns);
+    for (int i = 0; i < columns; ++i)
+        labels.append(QString("C%1").arg(i));
+    header.setHeaderText(labels);
+    header.setCheckBoxForColumn(0);
+    header.setCurSortColumn(std::min(1, columns - 1));
+    result["build_ms"] = msPer(timer.nsecsElapsed(), 1);
+
+    int height = m_options.viewport.height() > 0 ? m_options.viewport.height() : header.sizeHint().height();
+    header.resize(m_options.viewport.width(), height);
+    header.show();
+    QCoreApplication::processEvents();
+
+    QImage image(header.size(), QImage::Format_ARGB32_Premultiplied);
+    const int iconLoads = HeaderIconCache::instance()->loadCount();
+    const StaticTextCache::Stats text = StaticTextCache::instance()->stats();
+    timer.restart();
+    for (int frame = 0; frame < m_options.frames; ++frame)
+        header.render(&image);
+    result["paint_ms_per_frame"] = msPer(timer.nsecsElapsed(), m_options.frames);
+    result["paint_icon_loads"] = HeaderIconCache::instance()->loadCount() - iconLoads;
+    // 第一帧之后文本都应命中
+    result["text_cache_hits"] = StaticTextCache::instance()->stats().hits - text.hits;
+    result["text_cache_misses"] = StaticTextCache::instance()->stats().misses - text.misses;
+    return result;
+}
+
+QJsonObject HeaderBenchmark::measureCollapse(int columns) const
+{
+    QElapsedTimer timer;
+    QJsonObject result;
+    result["view"] = "HeaderTree";
+    result["columns"] = columns;
+    result["levels"] = 2;
+
+    // 一个工具下columns个参数，表头原有的一列占位留在最后
+    timer.start();
+    BenchHeaderView header(Qt::Horizontal, 2, 1);
+    HeaderTree tree(&header);
+    HeaderNode *tool = new HeaderNode("tool");
+    for (int i = 0; i < columns; ++i)
+        tool->addChild(QString("P%1").arg(i));
+    tree.insertSubtree(nullptr, 0, tool);
+    result["build_ms"] = msPer(timer.nsecsElapsed(), 1);
+
+    int height = m_options.viewport.height() > 0 ? m_options.viewport.height() : header.sizeHint().height();
+    header.resize(m_options.viewport.width(), height);
+    header.show();
+    QCoreApplication::processEvents();
+    QImage image(header.size(), QImage::Format_ARGB32_Premultiplied);
+
+    // 调用本身的耗时，以及动画期间每帧(处理事件 + 绘制)的平均和最长耗时；
+    // 展开的最后一帧包括把各个section换回来
+    auto toggle = [&](bool collapsed, const QString &name) {
+        bool finished = false;
+        timer.restart();
+        tree.setCollapsed(tool, collapsed, [&finished]() { finished = true; });
+        result[name + "_call_ms"] = msPer(timer.nsecsElapsed(), 1);
+        int frames = 0;
+        qint64 worstNs = 0;
+        QElapsedTimer frameTimer;
+        timer.restart();
+        while (!finished && timer.elapsed() < 2000)
+        {
+            frameTimer.start();
+            QCoreApplication::processEvents();
+            header.render(&image);
+            worstNs = std::max(worstNs, frameTimer.nsecsElapsed());
+            ++frames;
+        }
+        result[name + "_frames"] = frames;
+        result[name + "_ms_per_frame"] = msPer(timer.nsecsElapsed(), frames);
+        result[name + "_worst_frame_ms"] = msPer(worstNs, 1);
+        result[name + "_finished"] = finished;
+    };
+    toggle(true, "collapse");
+    toggle(false, "expand");
+    return result;
+}
+
+QJsonObject HeaderBenchmark::measureTable(int columns) const
+{
+    QElapsedTimer timer;
+    QJsonObject result;
+    result["view"] = "QTableView";
+    result["columns"] = columns;
+    // 单元格总数约10万个，行数至少够滚动几屏
+    const int rows = std::max(256, 100000 / columns);
+    result["rows"] = rows;
+
+    // 偶数列是重复出现的参数值字符串，奇数列是各不相同的测量值
+    timer.start();
+    QStandardItemModel model(rows, columns);
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            QVariant value = (column % 2 == 0) ? QVariant(QString("P%1").arg((row + column) % 16)) : QVariant(row * 0.25 + column);
+            model.setData(model.index(row, column), value);
+        }
+    }
+    result["build_ms"] = msPer(timer.nsecsElapsed(), 1);
+
+    QTableView table;
+    table.setModel(&model);
+    table.resize(m_options.viewport.width(), m_options.viewport.height() > 0 ? m_options.viewport.height() : 1080);
+    table.show();
+    QCoreApplication::processEvents();
+
+    // 每帧滚动一行后重绘整个视口
+    QImage image(table.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    QScrollBar *scrollBar = table.verticalScrollBar();
+    auto scroll = [&]() {
+        timer.restart();
+        for (int frame = 0; frame < m_options.frames; ++frame)
+        {
+            scrollBar->setValue(frame % (scrollBar->maximum() + 1));
+            table.viewport()->render(&image);
+        }
+        return msPer(timer.nsecsElapsed(), m_options.frames);
+    };
+    result["scroll_ms_per_frame"] = scroll();
+
+    FastItemDelegate delegate;
+    table.setItemDelegate(&delegate);
+    result["fast_scroll_ms_per_frame"] = scroll();
+    table.setItemDelegate(nullptr);
+    table.hide();
+
+    // 同样的数据放在按列存储的模型中，EwsTableView按可见列批量绘制
+    ColumnarTableModel columnar(rows, columns);
+    for (int column = 0; column < columns; ++column)
+    {
+        for (int row = 0; row < rows; ++row)
+            columnar.setData(columnar.index(row, column), model.data(model.index(row, column)));
+    }
+    EwsTableView batched;
+    batched.setModel(&columnar);
+    batched.resize(table.size());
+    batched.show();
+    QCoreApplication::processEvents();
+    image = QImage(batched.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    scrollBar = batched.verticalScrollBar();
+    auto scrollBatched = [&]() {
+        timer.restart();
+        for (int frame = 0; frame < m_options.frames; ++frame)
+        {
+            scrollBar->setValue(frame % (scrollBar->maximum() + 1));
+            batched.viewport()->render(&image);
+        }
+        return msPer(timer.nsecsElapsed(), m_options.frames);
+    };
+    result["columnar_scroll_ms_per_frame"] = scrollBatched();
+    batched.set_batched_rendering(true);
+    result["batched_scroll_ms_per_frame"] = scrollBatched();
+    return result;
+}
+
+QJsonObject HeaderBenchmark::measurePaged() const
+{
+    QElapsedTimer timer;
+    QJsonObject result;
+    result["view"] = "PagedTableModel";
+    const qint64 rows = 500000;
+    const int columns = 8;
+    const int budget = 4 * 1024 * 1024;
+    result["rows"] = rows;
+    result["columns"] = columns;
+    result["cache_budget"] = budget;
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath("results.pds");
+    timer.start();
+    if (!BinaryFileDataSource::write(path, rows, columns, [](qint64 row, int column) { return row * 0.5 + column; }))
+        return result;
+    result["build_ms"] = msPer(timer.nsecsElapsed(), 1);
+
+    BinaryFileDataSource source(path);
+    PagedTableModel model(&source);
+    model.setCacheBudget(budget);
+    while (model.canFetchMore(QModelIndex()))
+        model.fetchMore(QModelIndex());
+
+    QTableView table;
+    table.setModel(&model);
+    table.resize(m_options.viewport.width(), m_options.viewport.height() > 0 ? m_options.viewport.height() : 1080);
+    table.show();
+    QCoreApplication::processEvents();
+
+    // 每帧向下翻一屏；帧之间处理事件，让读完的页送回GUI线程
+    QImage image(table.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    QScrollBar *scrollBar = table.verticalScrollBar();
+    const int step = std::max(1, scrollBar->pageStep());
+    int peakBytes = 0;
+    qint64 paintNs = 0;
+    for (int frame = 0; frame < m_options.frames * 4; ++frame)
+    {
+        scrollBar->setValue(int((qint64(frame) * step) % (scrollBar->maximum() + 1)));
+        timer.restart();
+        table.viewport()->render(&image);
+        paintNs += timer.nsecsElapsed();
+        QCoreApplication::processEvents();
+        peakBytes = std::max(peakBytes, model.stats().cachedBytes);
+    }
+    const PagedTableModel::Stats stats = model.stats();
+    result["paged_scroll_ms_per_frame"] = msPer(paintNs, m_options.frames * 4);
+    result["paged_peak_cache_bytes"] = peakBytes;
+    result["paged_pages_read"] = stats.pagesRead;
+    result["paged_pages_skipped"] = stats.pagesSkipped;
+    result["paged_misses"] = stats.misses;
+    return result;
+}
+
+QJsonObject HeaderBenchmark::measureIngestion() const
+{
+    QJsonObject result;
+    result["view"] = "UpdateQueue";
+    const int producers = std::max(2, int(std::thread::hardware_concurrency()) - 1);
+    const int perProducer = 1000000;
+    const int rows = 1000, columns = 100;
+    result["producers"] = producers;
+    result["updates"] = qint64(producers) * perProducer;
+
+    // 生产者满了就让出CPU重试，GUI线程像EwsTableView一样反复drain并批量写入模型
+    UpdateQueue queue;
+    ColumnarTableModel model(rows, columns);
+    std::atomic<qint64> pushNs(0);
+    std::atomic<int> running(producers);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]() {
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < perProducer; ++i)
+            {
+                const int cell = (p * 7919 + i) % (rows * columns);
+                while (!queue.push(cell / columns, cell % columns, i))
+                    std::this_thread::yield();
+            }
+            pushNs += timer.nsecsElapsed();
+            --running;
+        });
+    }
+
+    QVector<CellUpdate> batch;
+    qint64 applyNs = 0;
+    int batches = 0;
+    QElapsedTimer timer;
+    while (running.load() > 0 || queue.size() > 0)
+    {
+        batch.clear();
+        const int count = queue.drain(batch, 1 << 18);
+        if (count == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        timer.start();
+        model.applyUpdates(batch.constData(), count);
+        applyNs += timer.nsecsElapsed();
+        ++batches;
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    const UpdateQueue::Stats stats = queue.stats();
+    // 包含队列满时让出CPU的等待，没有背压时就是push本身的耗时
+    result["push_ns"] = double(pushNs.load()) / std::max<qint64>(1, stats.pushed);
+    result["rejected"] = stats.rejected;
+    result["high_water"] = stats.highWater;
+    result["capacity"] = stats.capacity;
+    result["batches"] = batches;
+    result["apply_ns_per_update"] = double(applyNs) / std::max<qint64>(1, stats.drained);
+    return result;
+}
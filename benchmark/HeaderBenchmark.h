@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QSize>
+#include <QVector>
+
+struct BenchmarkOptions
+{
+    QVector<int> columns = { 10, 100, 1000, 10000, 100000 };
+    QVector<int> levels = { 2, 4, 8 };
+    int frames = 60;          // 绘制/拖动的帧数
+    int hitTests = 10000;     // indexAt的调用次数
+    QSize viewport = QSize(1920, 0); // 高度为0时使用表头的sizeHint
+};
+
+// 对 列数 x 级别数 的每个组合测量：
+//   build       构造表头并设置合并单元格
+//   paint       整个表头绘制一帧，以及带图标时绘制过程中读图标文件的次数(应为0)；
+//               普通单元格的贴图数、绘制层数，打开排序箭头和检查框后的绘制耗时
+//   index_at    一次命中测试
+//   resize_drag 模拟拖动：每帧若干次sectionResized，然后flush并绘制一帧
+//   label_burst 一帧内修改1000个表头文本，换算出的重绘区域
+//   state       保存的布局大小和恢复耗时
+// 另外对每个列数测量单级HCommonHeaderView的构造、绘制和文本排版缓存的命中，
+// 以及一个工具下有 列数 个参数时，HeaderTree折叠/展开整组的调用耗时和动画期间每帧的耗时，
+// 以及表格视口用默认委托、FastItemDelegate、ColumnarTableModel按列批量绘制时滚动一帧的耗时，
+// 以及从50万行的结果文件按页加载(PagedTableModel)时翻页滚动的耗时和页缓存占用，
+// 多个工作线程通过UpdateQueue提交单元格更新时每次push的耗时、背压和批量写入耗时，
+// 结果中view字段区分
+class HeaderBenchmark
+{
+public:
+    explicit HeaderBenchmark(const BenchmarkOptions &options);
+
+    QJsonObject run();
+
+private:
+    QJsonObject measure(int columns, int levels) const;
+    QJsonObject measureCommon(int columns) const;
+    QJsonObject measureCollapse(int columns) const;
+    QJsonObject measureTable(int columns) const;
+    QJsonObject measurePaged() const;
+    QJsonObject measureIngestion() const;
+
+    BenchmarkOptions m_options;
+};
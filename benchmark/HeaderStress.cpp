@@ -0,0 +1,681 @@
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonArray>
+#include <QPainter>
+#include <QStandardItemModel>
+
+#include "BenchHeaderView.h"
+#include "HCommonHeaderView.h"
+#include "HeaderStress.h"
+#include "HeaderTree.h"
+#include "StaticTextCache.h"
+
+namespace
+{
+struct RefSpan
+{
+    int rootLevel;
+    int levelSpan;
+    int start;
+    int sectionSpan;
+};
+
+// 参考实现：所有操作都用最直接的方式完成，不考虑效率
+struct Reference
+{
+    int levels = 0;
+    int sections = 0;
+    int defaultSize = 0;
+    std::vector<RefSpan> spans;
+    std::vector<std::vector<QString>> texts; // [level][section]
+    std::vector<int> levelSizes;
+    std::vector<int> sectionSizes;
+    std::vector<char> hidden;
+
+    int owner(int level, int section) const
+    {
+        int found = -1;
+        for (int i = 0; i < (int)spans.size(); ++i)
+        {
+            const RefSpan &s = spans[i];
+            if (s.rootLevel <= level && level < s.rootLevel + s.levelSpan && s.start <= section && section < s.start + s.sectionSpan)
+            {
+                if (found >= 0)
+                    return -2; // 重叠
+                found = i;
+            }
+        }
+        return found;
+    }
+
+    void setSpan(int level, int section, int levelSpan, int sectionSpan)
+    {
+        levelSpan = std::min(levelSpan, levels - level);
+        sectionSpan = std::min(sectionSpan, sections - section);
+        if (levelSpan <= 0 || sectionSpan <= 0)
+            return;
+        RefSpan span = { level, levelSpan, section, sectionSpan };
+        auto overlaps = [&span](const RefSpan &s) {
+            return s.rootLevel < span.rootLevel + span.levelSpan && span.rootLevel < s.rootLevel + s.levelSpan && s.start < span.start + span.sectionSpan && span.start < s.start + s.sectionSpan;
+        };
+        spans.erase(std::remove_if(spans.begin(), spans.end(), overlaps), spans.end());
+        spans.push_back(span);
+    }
+
+    void insert(int first, int count)
+    {
+        for (RefSpan &s : spans)
+        {
+            if (s.start >= first)
+                s.start += count;
+            else if (s.start + s.sectionSpan > first)
+                s.sectionSpan += count;
+        }
+        for (auto &row : texts)
+            row.insert(row.begin() + first, count, QString());
+        sectionSizes.insert(sectionSizes.begin() + first, count, defaultSize);
+        hidden.insert(hidden.begin() + first, count, 0);
+        sections += count;
+    }
+
+    void remove(int first, int count)
+    {
+        const int last = first + count;
+        std::vector<RefSpan> kept;
+        for (RefSpan s : spans)
+        {
+            const int end = s.start + s.sectionSpan;
+            if (end <= first)
+            {
+                kept.push_back(s);
+            }
+            else if (s.start >= last)
+            {
+                s.start -= count;
+                kept.push_back(s);
+            }
+            else
+            {
+                int remaining = std::max(0, std::min(end, first) - s.start) + std::max(0, end - last);
+                if (remaining > 0)
+                {
+                    s.start = std::min(s.start, first);
+                    s.sectionSpan = remaining;
+                    kept.push_back(s);
+                }
+            }
+        }
+        spans = kept;
+        for (auto &row : texts)
+            row.erase(row.begin() + first, row.begin() + last);
+        sectionSizes.erase(sectionSizes.begin() + first, sectionSizes.begin() + last);
+        hidden.erase(hidden.begin() + first, hidden.begin() + last);
+        sections -= count;
+    }
+
+    int sectionPosition(int section) const
+    {
+        int pos = 0;
+        for (int i = 0; i < section; ++i)
+            pos += hidden[i] ? 0 : sectionSizes[i];
+        return pos;
+    }
+
+    int levelPosition(int level) const
+    {
+        int pos = 0;
+        for (int i = 0; i < level; ++i)
+            pos += levelSizes[i];
+        return pos;
+    }
+
+    int sectionAt(int pos) const
+    {
+        for (int i = 0; i < sections; ++i)
+        {
+            int size = hidden[i] ? 0 : sectionSizes[i];
+            if (pos < size)
+                return i;
+            pos -= size;
+        }
+        return -1;
+    }
+
+    int levelAt(int pos) const
+    {
+        for (int i = 0; i < levels; ++i)
+        {
+            if (pos < levelSizes[i])
+                return i;
+            pos -= levelSizes[i];
+        }
+        return -1;
+    }
+};
+
+class StressRun
+{
+public:
+    StressRun(Qt::Orientation orientation, int levels, int sections)
+        : m_orientation(orientation),
+          m_view(orientation, orientation == Qt::Horizontal ? levels : sections, orientation == Qt::Horizontal ? sections : levels)
+    {
+        m_model = static_cast<MultiLevelHeaderModel *>(m_view.model());
+        m_ref.levels = levels;
+        m_ref.sections = sections;
+        m_ref.defaultSize = m_view.defaultSectionSize();
+        m_ref.texts.assign(levels, std::vector<QString>(sections));
+        m_ref.hidden.assign(sections, 0);
+        for (int level = 0; level < levels; ++level)
+            m_ref.levelSizes.push_back(levelSize(level));
+        for (int section = 0; section < sections; ++section)
+            m_ref.sectionSizes.push_back(sectionSize(section));
+        tile();
+    }
+
+    // 执行一个随机操作，返回操作的描述；之后表头仍被合并单元格铺满
+    QString step(std::mt19937 &rng)
+    {
+        QString operation = mutate(rng);
+        tile();
+        return operation;
+    }
+
+private:
+    // 和表头树一样让合并单元格铺满整个表头：没有被覆盖的单元格补一个1x1的合并单元格
+    void tile()
+    {
+        QVector<RootCell> cells;
+        for (int level = 0; level < m_ref.levels; ++level)
+        {
+            for (int section = 0; section < m_ref.sections; ++section)
+            {
+                if (m_ref.owner(level, section) != -1)
+                    continue;
+                RootCell cell;
+                cell.row = row(level, section);
+                cell.column = column(level, section);
+                cell.span.rowSpan = 1;
+                cell.span.columnSpan = 1;
+                cells.append(cell);
+                m_ref.setSpan(level, section, 1, 1);
+            }
+        }
+        if (!cells.isEmpty())
+            m_view.setCellSpans(cells);
+    }
+
+    QString mutate(std::mt19937 &rng)
+    {
+        auto pick = [&rng](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+        const int kind = pick(0, 99);
+        const int sections = m_ref.sections;
+        const int levels = m_ref.levels;
+
+        if (kind < 8)
+        {
+            // 同一组级别上相邻、互不重叠的几个合并单元格，一次设置
+            int level = pick(0, levels - 1);
+            int levelSpan = pick(1, levels - level);
+            int section = pick(0, sections - 1);
+            QVector<RootCell> cells;
+            QString text = QString("spans(level %1, %2 levels:").arg(level).arg(levelSpan);
+            for (int n = pick(1, 4); n > 0 && section < sections; --n)
+            {
+                int sectionSpan = pick(1, std::min(6, sections - section));
+                RootCell cell;
+                cell.row = row(level, section);
+                cell.column = column(level, section);
+                cell.span.rowSpan = m_orientation == Qt::Horizontal ? levelSpan : sectionSpan;
+                cell.span.columnSpan = m_orientation == Qt::Horizontal ? sectionSpan : levelSpan;
+                cells.append(cell);
+                m_ref.setSpan(level, section, levelSpan, sectionSpan);
+                text += QString(" %1+%2").arg(section).arg(sectionSpan);
+                section += sectionSpan + pick(0, 2);
+            }
+            m_view.setCellSpans(cells);
+            return text + ")";
+        }
+        if (kind < 30)
+        {
+            int level = pick(0, levels - 1);
+            int section = pick(0, sections - 1);
+            int levelSpan = pick(1, levels - level);
+            int sectionSpan = pick(1, std::min(8, sections - section));
+            m_view.setCellSpan(row(level, section), column(level, section), m_orientation == Qt::Horizontal ? levelSpan : sectionSpan, m_orientation == Qt::Horizontal ? sectionSpan : levelSpan);
+            m_ref.setSpan(level, section, levelSpan, sectionSpan);
+            return QString("span(level %1, section %2, %3 x %4)").arg(level).arg(section).arg(levelSpan).arg(sectionSpan);
+        }
+        if (kind < 45)
+        {
+            int level = pick(0, levels - 1);
+            int section = pick(0, sections - 1);
+            QString text = QString::number(pick(0, 999));
+            m_view.setCellText(row(level, section), column(level, section), text);
+            m_ref.texts[level][section] = text;
+            return QString("text(level %1, section %2, %3)").arg(level).arg(section).arg(text);
+        }
+        if (kind < 60)
+        {
+            // QHeaderView不会为隐藏的section发出sectionResized，只调整可见的
+            int section = pick(0, sections - 1);
+            if (m_ref.hidden[section])
+                return QString("noop");
+            int size = pick(30, 150);
+            m_view.resizeSection(section, size);
+            m_view.flushPendingResize();
+            m_ref.sectionSizes[section] = size;
+            return QString("resize(section %1, %2)").arg(section).arg(size);
+        }
+        if (kind < 65)
+        {
+            int level = pick(0, levels - 1);
+            int size = pick(10, 80);
+            if (m_orientation == Qt::Horizontal)
+                m_view.setRowHeight(level, size);
+            else
+                m_view.setColumnWidth(level, size);
+            m_ref.levelSizes[level] = size;
+            return QString("resize(level %1, %2)").arg(level).arg(size);
+        }
+        if (kind < 77)
+        {
+            int first = pick(0, sections);
+            int count = pick(1, 4);
+            m_view.insertSections(first, count);
+            m_ref.insert(first, count);
+            return QString("insert(%1, %2)").arg(first).arg(count);
+        }
+        if (kind < 89)
+        {
+            if (sections <= 1)
+                return QString("noop");
+            int first = pick(0, sections - 1);
+            int count = pick(1, std::min(4, sections - first));
+            if (count >= sections)
+                return QString("noop");
+            m_view.removeSections(first, count);
+            m_ref.remove(first, count);
+            return QString("remove(%1, %2)").arg(first).arg(count);
+        }
+        if (kind < 92)
+        {
+            // 保存后随意改动一下布局，恢复后应当与参考实现完全一致
+            QByteArray state = m_view.saveHeaderState();
+            int section = pick(0, sections - 1);
+            if (!m_ref.hidden[section])
+            {
+                m_view.resizeSection(section, pick(30, 150));
+                m_view.flushPendingResize();
+            }
+            m_view.setCellSpan(0, 0, 1, 1);
+            m_view.setSectionRangeHidden(section, 1, !m_ref.hidden[section]);
+            if (!m_view.restoreHeaderState(state))
+                m_stepError = QString("restoreHeaderState failed");
+            else if (m_view.saveHeaderState() != state)
+                m_stepError = QString("saved state changed after restore");
+            return QString("state(%1 bytes)").arg(state.size());
+        }
+
+        int first = pick(0, sections - 1);
+        int count = pick(1, std::min(6, sections - first));
+        bool hidden = pick(0, 1) == 1;
+        m_view.setSectionRangeHidden(first, count, hidden);
+        std::fill(m_ref.hidden.begin() + first, m_ref.hidden.begin() + first + count, hidden ? 1 : 0);
+        return QString("hide(%1, %2, %3)").arg(first).arg(count).arg(hidden);
+    }
+
+public:
+    // 返回第一个不一致的地方，全部一致时返回空字符串
+    QString verify(std::mt19937 &rng) const
+    {
+        if (!m_stepError.isEmpty())
+            return m_stepError;
+        QString error;
+        if (!m_model->checkInvariants(&error))
+            return error;
+
+        const int levels = m_ref.levels;
+        const int sections = m_ref.sections;
+        if (m_view.levelCount() != levels || m_view.count() != sections)
+            return QString("header is %1 levels x %2 sections, expected %3 x %4").arg(m_view.levelCount()).arg(m_view.count()).arg(levels).arg(sections);
+
+        // 每个单元格的根单元格和文本
+        for (int level = 0; level < levels; ++level)
+        {
+            for (int section = 0; section < sections; ++section)
+            {
+                const int r = row(level, section), c = column(level, section);
+                const int owner = m_ref.owner(level, section);
+                // 每个单元格正好属于一个合并单元格
+                if (owner == -2)
+                    return QString("reference spans overlap at level %1 section %2").arg(level).arg(section);
+                if (owner == -1)
+                    return QString("reference leaves level %1 section %2 uncovered").arg(level).arg(section);
+                int rootRow = -1, rootColumn = -1;
+                if (!m_model->getRootCell(r, c, rootRow, rootColumn))
+                    return QString("cell (%1, %2) has no root").arg(r).arg(c);
+                RootCell typed = m_model->rootOf(r, c);
+                if (!typed.isValid() || typed.row != rootRow || typed.column != rootColumn)
+                    return QString("cell (%1, %2): rootOf (%3, %4) differs from getRootCell").arg(r).arg(c).arg(typed.row).arg(typed.column);
+                const RefSpan &s = m_ref.spans[owner];
+                if (rootRow != row(s.rootLevel, s.start) || rootColumn != column(s.rootLevel, s.start))
+                    return QString("cell (%1, %2): root (%3, %4), expected (%5, %6)").arg(r).arg(c).arg(rootRow).arg(rootColumn).arg(row(s.rootLevel, s.start)).arg(column(s.rootLevel, s.start));
+                QString text = m_model->index(r, c).data(Qt::DisplayRole).toString();
+                if (text != m_ref.texts[level][section])
+                    return QString("cell (%1, %2): text '%3', expected '%4'").arg(r).arg(c).arg(text).arg(m_ref.texts[level][section]);
+            }
+        }
+
+        // 跨度，以及合并单元格的矩形正好铺满整个表头：每个单元格只有一个根(上面已检查)，
+        // 所有合并单元格的面积之和等于表头面积，就没有重叠也没有空隙
+        qint64 spanArea = 0, cellArea = 0;
+        for (const RefSpan &s : m_ref.spans)
+        {
+            QModelIndex root = m_model->index(row(s.rootLevel, s.start), column(s.rootLevel, s.start));
+            const int rowSpan = m_orientation == Qt::Horizontal ? s.levelSpan : s.sectionSpan;
+            const int columnSpan = m_orientation == Qt::Horizontal ? s.sectionSpan : s.levelSpan;
+            if (root.data(ROW_SPAN_ROLE).toInt() != rowSpan || root.data(COLUMN_SPAN_ROLE).toInt() != columnSpan)
+                return QString("root (%1, %2): span %3 x %4, expected %5 x %6").arg(root.row()).arg(root.column()).arg(root.data(ROW_SPAN_ROLE).toInt()).arg(root.data(COLUMN_SPAN_ROLE).toInt()).arg(rowSpan).arg(columnSpan);
+            CellSpan typed = m_model->spanOf(root.row(), root.column());
+            if (typed.rowSpan != rowSpan || typed.columnSpan != columnSpan)
+                return QString("root (%1, %2): spanOf %3 x %4, expected %5 x %6").arg(root.row()).arg(root.column()).arg(typed.rowSpan).arg(typed.columnSpan).arg(rowSpan).arg(columnSpan);
+            spanArea += qint64(m_model->rowSpanHeight(root.row(), rowSpan)) * m_model->columnSpanWidth(root.column(), columnSpan);
+            for (int level = s.rootLevel; level < s.rootLevel + s.levelSpan; ++level)
+            {
+                for (int section = s.start; section < s.start + s.sectionSpan; ++section)
+                    cellArea += qint64(m_ref.levelSizes[level]) * (m_ref.hidden[section] ? 0 : m_ref.sectionSizes[section]);
+            }
+        }
+        if (spanArea != cellArea)
+            return QString("merged cells cover %1 px^2, cells cover %2 px^2").arg(spanArea).arg(cellArea);
+        const qint64 headerArea = qint64(m_ref.levelPosition(levels)) * m_ref.sectionPosition(sections);
+        if (spanArea != headerArea)
+            return QString("merged cells cover %1 px^2, header is %2 px^2").arg(spanArea).arg(headerArea);
+
+        // 尺寸和位置
+        for (int level = 0; level < levels; ++level)
+        {
+            if (levelSize(level) != m_ref.levelSizes[level] || levelPosition(level) != m_ref.levelPosition(level))
+                return QString("level %1: size %2 at %3, expected %4 at %5").arg(level).arg(levelSize(level)).arg(levelPosition(level)).arg(m_ref.levelSizes[level]).arg(m_ref.levelPosition(level));
+        }
+        for (int section = 0; section < sections; ++section)
+        {
+            const bool hidden = m_ref.hidden[section];
+            const int pos = m_ref.sectionPosition(section);
+            if (m_model->isSectionHidden(section) != hidden || m_view.isSectionHidden(section) != hidden)
+                return QString("section %1: hidden model %2 view %3, expected %4").arg(section).arg(m_model->isSectionHidden(section)).arg(m_view.isSectionHidden(section)).arg(hidden);
+            if (sectionSize(section) != m_ref.sectionSizes[section] || sectionPosition(section) != pos)
+                return QString("section %1: model size %2 at %3, expected %4 at %5").arg(section).arg(sectionSize(section)).arg(sectionPosition(section)).arg(m_ref.sectionSizes[section]).arg(pos);
+            if (!hidden && (m_view.sectionSize(section) != m_ref.sectionSizes[section] || m_view.sectionPosition(section) != pos))
+                return QString("section %1: view size %2 at %3, expected %4 at %5").arg(section).arg(m_view.sectionSize(section)).arg(m_view.sectionPosition(section)).arg(m_ref.sectionSizes[section]).arg(pos);
+        }
+
+        // indexAt与逐个累加的结果比较，包括表头外面的点
+        const int sectionTotal = m_ref.sectionPosition(sections);
+        const int levelTotal = m_ref.levelPosition(levels);
+        std::uniform_int_distribution<int> sectionPos(0, sectionTotal + 8);
+        std::uniform_int_distribution<int> levelPos(0, levelTotal + 8);
+        for (int i = 0; i < 32; ++i)
+        {
+            const int s = sectionPos(rng), l = levelPos(rng);
+            const QPoint point = m_orientation == Qt::Horizontal ? QPoint(s, l) : QPoint(l, s);
+            const int section = m_ref.sectionAt(s), level = m_ref.levelAt(l);
+            QModelIndex index = m_view.indexAt(point);
+            const bool expected = section >= 0 && level >= 0;
+            if (index.isValid() != expected || (expected && (index.row() != row(level, section) || index.column() != column(level, section))))
+                return QString("indexAt(%1, %2) = (%3, %4), expected (%5, %6)").arg(point.x()).arg(point.y()).arg(index.row()).arg(index.column()).arg(expected ? row(level, section) : -1).arg(expected ? column(level, section) : -1);
+        }
+        return QString();
+    }
+
+private:
+    int row(int level, int section) const
+    {
+        return m_orientation == Qt::Horizontal ? level : section;
+    }
+
+    int column(int level, int section) const
+    {
+        return m_orientation == Qt::Horizontal ? section : level;
+    }
+
+    int levelSize(int level) const
+    {
+        return m_orientation == Qt::Horizontal ? m_model->getRowHeight(level) : m_model->getColumnWidth(level);
+    }
+
+    int levelPosition(int level) const
+    {
+        return m_orientation == Qt::Horizontal ? m_model->rowPosition(level) : m_model->columnPosition(level);
+    }
+
+    int sectionSize(int section) const
+    {
+        return m_orientation == Qt::Horizontal ? m_model->getColumnWidth(section) : m_model->getRowHeight(section);
+    }
+
+    int sectionPosition(int section) const
+    {
+        return m_orientation == Qt::Horizontal ? m_model->columnPosition(section) : m_model->rowPosition(section);
+    }
+
+    Qt::Orientation m_orientation;
+    BenchHeaderView m_view;
+    MultiLevelHeaderModel *m_model;
+    Reference m_ref;
+    QString m_stepError; // 操作本身检测到的问题
+};
+}
+
+namespace
+{
+// HCommonHeaderView：setHeaderText之后各列的文本和排序属性(除最后一列外都可排序)，
+// 模型插入/删除列后这些属性随列移动
+QString verifyCommonHeader(int columns)
+{
+    QStandardItemModel model(0, columns);
+    HCommonHeaderView header(Qt::Horizontal);
+    header.setModel(&model);
+    QStringList labels;
+    for (int i = 0; i < columns; ++i)
+        labels.append(QString("C%1").arg(i));
+    header.setHeaderText(labels);
+    for (int i = 0; i < columns; ++i)
+    {
+        if (header.sectionText(i) != labels[i])
+            return QString("section %1: text '%2', expected '%3'").arg(i).arg(header.sectionText(i)).arg(labels[i]);
+        if (header.isSectionSortable(i) != (i < columns - 1))
+            return QString("section %1: sortable %2, expected %3").arg(i).arg(header.isSectionSortable(i)).arg(i < columns - 1);
+    }
+
+    model.insertColumns(1, 2);
+    if (header.isSectionSortable(1) || header.isSectionSortable(2))
+        return QString("inserted sections 1..2 are sortable");
+    if (header.sectionText(3) != labels[1] || !header.isSectionSortable(3))
+        return QString("section 3 after insert: text '%1', sortable %2, expected '%3', 1").arg(header.sectionText(3)).arg(header.isSectionSortable(3)).arg(labels[1]);
+    model.removeColumns(0, 3);
+    if (header.sectionText(0) != labels[1] || !header.isSectionSortable(0))
+        return QString("section 0 after remove: text '%1', sortable %2, expected '%3', 1").arg(header.sectionText(0)).arg(header.isSectionSortable(0)).arg(labels[1]);
+    return QString();
+}
+
+// HeaderTree折叠/展开：工具下groups组、每组leaves个参数，先折叠第1组，再折叠、展开整个工具，
+// 最后展开第1组。每一步等动画结束后，与逐个section按祖先的折叠标记算出的隐藏状态比较，
+// 全部展开后各section的尺寸要回到折叠前
+QString verifyCollapse(int groups, int leaves)
+{
+    BenchHeaderView header(Qt::Horizontal, 3, 1);
+    HeaderTree tree(&header);
+    HeaderNode *tool = new HeaderNode("tool");
+    for (int g = 0; g < groups; ++g)
+    {
+        HeaderNode *group = tool->addChild(QString("G%1").arg(g));
+        for (int i = 0; i < leaves; ++i)
+            group->addChild(QString("P%1-%2").arg(g).arg(i));
+    }
+    tree.insertSubtree(nullptr, 0, tool);
+    header.show();
+    QCoreApplication::processEvents();
+    const int sections = tool->leafCount;
+    std::vector<int> sizes(sections);
+    for (int s = 0; s < sections; ++s)
+        sizes[s] = header.sectionSize(s);
+
+    auto toggle = [&](HeaderNode *node, bool collapsed) -> QString {
+        bool finished = false;
+        tree.setCollapsed(node, collapsed, [&finished]() { finished = true; });
+        QElapsedTimer timer;
+        timer.start();
+        while (!finished && timer.elapsed() < 2000)
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 16);
+        if (!finished)
+            return QString("%1 '%2' did not finish").arg(collapsed ? "collapse" : "expand", node->text);
+        for (int s = 0; s < sections; ++s)
+        {
+            // 被某个折叠的祖先隐藏：不是该祖先的第一个section
+            const HeaderNode *leaf = tree.nodeAt(2, s);
+            bool hidden = false;
+            for (const HeaderNode *a = leaf; a && a->parent; a = a->parent)
+                hidden = hidden || (a->collapsed && tree.firstSection(a) != s);
+            if (header.isSectionHidden(s) != hidden)
+                return QString("after %1 '%2': section %3 hidden %4, expected %5").arg(collapsed ? "collapse" : "expand", node->text).arg(s).arg(header.isSectionHidden(s)).arg(hidden);
+        }
+        return QString();
+    };
+
+    HeaderNode *group = tool->children.value(1, tool->children.first());
+    QString error = toggle(group, true);
+    if (error.isEmpty())
+        error = toggle(tool, true);
+    if (error.isEmpty())
+        error = toggle(tool, false);
+    if (error.isEmpty())
+        error = toggle(group, false);
+    for (int s = 0; error.isEmpty() && s < sections; ++s)
+    {
+        if (header.sectionSize(s) != sizes[s])
+            error = QString("section %1 size %2 after expanding, expected %3").arg(s).arg(header.sectionSize(s)).arg(sizes[s]);
+    }
+    return error;
+}
+
+// StaticTextCache画比rect宽的文本时，不能画到rect外面(QPainter::drawText(rect, ...)会裁剪)
+QString verifyTextClip(int flags)
+{
+    const QRect rect(60, 4, 80, 24);
+    QImage image(200, 32, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    const QString label = QString("overlong label ").repeated(20);
+    QPainter painter(&image);
+    painter.setPen(Qt::black);
+    // 第二次命中缓存，两条路径都要检查
+    for (int pass = 0; pass < 2; ++pass)
+        StaticTextCache::instance()->drawText(&painter, rect, flags, label);
+    painter.end();
+    for (int y = 0; y < image.height(); ++y)
+    {
+        for (int x = 0; x < image.width(); ++x)
+        {
+            if (!rect.contains(x, y) && image.pixel(x, y) != QColor(Qt::white).rgb())
+                return QString("pixel (%1, %2) outside %3,%4 %5x%6 painted").arg(x).arg(y).arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height());
+        }
+    }
+    return QString();
+}
+}
+
+HeaderStress::HeaderStress(const StressOptions &options) : m_options(options)
+{
+}
+
+QJsonObject HeaderStress::run()
+{
+    QJsonArray failures;
+    qint64 checks = 0;
+    for (int iteration = 0; iteration < m_options.iterations; ++iteration)
+    {
+        const unsigned seed = m_options.seed + iteration;
+        std::mt19937 rng(seed);
+        auto pick = [&rng](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+        const Qt::Orientation orientation = pick(0, 1) ? Qt::Horizontal : Qt::Vertical;
+        StressRun stress(orientation, pick(1, 6), pick(1, 40));
+        QString error = stress.verify(rng);
+        QString operation = "create";
+        int step = 0;
+        for (; error.isEmpty() && step < m_options.operations; ++step)
+        {
+            operation = stress.step(rng);
+            error = stress.verify(rng);
+            ++checks;
+        }
+        if (!error.isEmpty())
+        {
+            QJsonObject failure;
+            failure["seed"] = qint64(seed);
+            failure["orientation"] = orientation == Qt::Horizontal ? "horizontal" : "vertical";
+            failure["step"] = step;
+            failure["operation"] = operation;
+            failure["error"] = error;
+            failures.append(failure);
+        }
+    }
+
+    // 超过20列是HCommonHeaderView原来的固定上限
+    for (int columns : { 21, 64, 1000 })
+    {
+        const QString error = verifyCommonHeader(columns);
+        ++checks;
+        if (!error.isEmpty())
+        {
+            QJsonObject failure;
+            failure["view"] = "HCommonHeaderView";
+            failure["columns"] = columns;
+            failure["error"] = error;
+            failures.append(failure);
+        }
+    }
+
+    for (const auto &shape : { std::make_pair(4, 3), std::make_pair(20, 100) })
+    {
+        const QString error = verifyCollapse(shape.first, shape.second);
+        ++checks;
+        if (!error.isEmpty())
+        {
+            QJsonObject failure;
+            failure["view"] = "HeaderTree";
+            failure["groups"] = shape.first;
+            failure["leaves"] = shape.second;
+            failure["error"] = error;
+            failures.append(failure);
+        }
+    }
+
+    for (int flags : { int(Qt::AlignLeft | Qt::AlignVCenter), int(Qt::AlignCenter), int(Qt::AlignRight | Qt::AlignVCenter), int(Qt::AlignCenter | Qt::TextWordWrap) })
+    {
+        const QString error = verifyTextClip(flags);
+        ++checks;
+        if (!error.isEmpty())
+        {
+            QJsonObject failure;
+            failure["view"] = "StaticTextCache";
+            failure["flags"] = flags;
+            failure["error"] = error;
+            failures.append(failure);
+        }
+    }
+
+    QJsonObject report;
+    report["iterations"] = m_options.iterations;
+    report["operations"] = m_options.operations;
+    report["checks"] = checks;
+    report["failures"] = failures;
+    return report;
+}
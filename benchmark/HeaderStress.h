@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QJsonObject>
+
+struct StressOptions
+{
+    int iterations = 200;  // 每轮重新创建表头，随机选择方向、级别数和section数
+    int operations = 200;  // 每轮的随机操作数
+    unsigned seed = 1;     // 第i轮使用 seed + i，失败时可以用 --seed 单独重放
+};
+
+// 随机地合并单元格、设置文本、调整尺寸、插入/删除/隐藏section，
+// 每一步之后与一个直接在平铺数组上实现的参考模型比较，并检查：
+//   合并单元格铺满表头：每个单元格正好属于一个合并单元格，且根单元格一致
+//   合并单元格互不重叠，面积之和等于整个表头的面积
+//   各section的位置/尺寸在模型、QHeaderView和参考模型中一致
+//   indexAt与逐个section累加的结果一致
+// 另外检查HCommonHeaderView在超过20列时setHeaderText设置的文本和排序属性，
+// 以及StaticTextCache画过长的标签时裁剪在单元格内，HeaderTree折叠/展开嵌套的大组后
+// 各section的隐藏状态和尺寸
+class HeaderStress
+{
+public:
+    explicit HeaderStress(const StressOptions &options);
+
+    // {"iterations", "operations", "checks", "failures": [...]}
+    QJsonObject run();
+
+private:
+    StressOptions m_options;
+};
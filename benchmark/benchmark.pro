@@ -0,0 +1,22 @@
+# 多级表头性能基准和随机压力测试(--stress)，无界面运行（offscreen平台），结果以JSON输出
+QT       += core gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = headerbench
+DESTDIR = $$PWD/../bin
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../tableview.pri)
+
+SOURCES += \
+    main.cpp \
+    HeaderBenchmark.cpp \
+    HeaderStress.cpp
+
+HEADERS += \
+    BenchHeaderView.h \
+    HeaderBenchmark.h \
+    HeaderStress.h
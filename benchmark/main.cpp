@@ -0,0 +1,93 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#include "HeaderBenchmark.h"
+#include "HeaderStress.h"
+
+static QVector<int> parseList(const QString &text, const QVector<int> &fallback)
+{
+    QVector<int> values;
+    for (const QString &item : text.split(',', QString::SkipEmptyParts))
+    {
+        bool ok = false;
+        int value = item.trimmed().toInt(&ok);
+        if (ok && value > 0)
+            values.append(value);
+    }
+    return values.isEmpty() ? fallback : values;
+}
+
+int main(int argc, char *argv[])
+{
+    // 默认无界面运行，可以用 -platform 或 QT_QPA_PLATFORM 覆盖
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MultiLevelHeaderView benchmark");
+    parser.addHelpOption();
+    QCommandLineOption columnsOption("columns", "Comma separated column counts.", "list");
+    QCommandLineOption levelsOption("levels", "Comma separated level counts.", "list");
+    QCommandLineOption framesOption("frames", "Frames per paint/drag measurement.", "n");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write the JSON report to file.", "file");
+    QCommandLineOption stressOption("stress", "Run n randomized mutation rounds against a reference model instead of the benchmark.", "n");
+    QCommandLineOption operationsOption("operations", "Operations per stress round.", "n");
+    QCommandLineOption seedOption("seed", "Seed of the first stress round.", "seed");
+    parser.addOption(columnsOption);
+    parser.addOption(levelsOption);
+    parser.addOption(framesOption);
+    parser.addOption(outputOption);
+    parser.addOption(stressOption);
+    parser.addOption(operationsOption);
+    parser.addOption(seedOption);
+    parser.process(app);
+
+    QByteArray json;
+    int exitCode = 0;
+    if (parser.isSet(stressOption))
+    {
+        StressOptions options;
+        options.iterations = qMax(1, parser.value(stressOption).toInt());
+        if (parser.isSet(operationsOption))
+            options.operations = qMax(1, parser.value(operationsOption).toInt());
+        if (parser.isSet(seedOption))
+            options.seed = parser.value(seedOption).toUInt();
+
+        QJsonObject report = HeaderStress(options).run();
+        exitCode = report["failures"].toArray().isEmpty() ? 0 : 1;
+        json = QJsonDocument(report).toJson();
+    }
+    else
+    {
+        BenchmarkOptions options;
+        options.columns = parseList(parser.value(columnsOption), options.columns);
+        options.levels = parseList(parser.value(levelsOption), options.levels);
+        if (parser.isSet(framesOption))
+            options.frames = qMax(1, parser.value(framesOption).toInt());
+
+        HeaderBenchmark benchmark(options);
+        json = QJsonDocument(benchmark.run()).toJson();
+    }
+
+    if (parser.isSet(outputOption))
+    {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qCritical("cannot write %s", qPrintable(file.fileName()));
+            return 1;
+        }
+        file.write(json);
+    }
+    else
+    {
+        QTextStream(stdout) << json;
+    }
+    return exitCode;
+}
@@ -3,6 +3,7 @@
 
 #include <QList>
 #include <QVariantMap>
+#include <QVector>
 
 class ToolNode
 {
@@ -12,18 +13,36 @@ public:
     }
     QString name;
     int pos;
+    QString binary; // 运行实验时启动的程序
     QStringList params_list;
     QVariantMap params_dict;
 
 };
 
+// 批量添加工具/参数(例如加载配方)时使用
+struct ParamSpec
+{
+    QString key;
+    QString value; // 参数值列表
+};
+
+struct ToolSpec
+{
+    QString name;
+    QString binary;
+    QVector<ParamSpec> params;
+};
+
 class ExperimentNode
 {
 public:
-    int id;
+    int id = 0;
     QString param_key;
     QString param_value;
-    QString status;
+    QString status; // queued/running/done/failed
+    int row = -1;   // 参数扫描中的表格行
+    QString result; // 程序输出的最后一行
+    qint64 elapsed_ms = 0;
 };
 
 class ExperimentTree
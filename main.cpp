@@ -5,10 +5,19 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    QCoreApplication::setOrganizationName("hqh");
+    QCoreApplication::setApplicationName("testMultiHeader");
     EwsTableView tableView;
     tableView.setMinimumSize(800, 600);
 
     tableView.init_table_header();
+    // 恢复上次调整过的列宽等布局，退出时保存
+    tableView.restore_header_settings();
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, [&tableView]() { tableView.save_header_settings(); });
+    // 表格是顶层窗口，实验进度显示在标题上
+    QObject::connect(&tableView, &EwsTableView::experiment_status, [&tableView](const QString &text) {
+        tableView.setWindowTitle(QStringLiteral("%1 - %2").arg(QCoreApplication::applicationName(), text));
+    });
     tableView.show();
     return a.exec();
 }
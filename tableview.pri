@@ -0,0 +1,56 @@
+# 多级表头和表格组件，demo和benchmark共用
+
+QT += widgets concurrent
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/ColumnarTableModel.cpp \
+    $$PWD/EwsTableView.cpp \
+    $$PWD/ExperimentRunner.cpp \
+    $$PWD/FastItemDelegate.cpp \
+    $$PWD/HCommonHeaderView.cpp \
+    $$PWD/HeaderCommands.cpp \
+    $$PWD/HeaderIconCache.cpp \
+    $$PWD/HeaderInlineEditor.cpp \
+    $$PWD/HeaderProfiler.cpp \
+    $$PWD/HeaderPaintLayers.cpp \
+    $$PWD/HeaderSkinProvider.cpp \
+    $$PWD/HeaderTree.cpp \
+    $$PWD/LabelTable.cpp \
+    $$PWD/MultiLevelHeaderModel.cpp \
+    $$PWD/MultiLevelHeaderView.cpp \
+    $$PWD/PagedDataSource.cpp \
+    $$PWD/PagedTableModel.cpp \
+    $$PWD/RoleProfilingProxyModel.cpp \
+    $$PWD/SectionCounter.cpp \
+    $$PWD/SectionLayout.cpp \
+    $$PWD/StaticTextCache.cpp \
+    $$PWD/TextMetricsCache.cpp \
+    $$PWD/UpdateQueue.cpp
+
+HEADERS += \
+    $$PWD/ColumnarTableModel.h \
+    $$PWD/EwsTableView.h \
+    $$PWD/ExperimentRunner.h \
+    $$PWD/FastItemDelegate.h \
+    $$PWD/HCommonHeaderView.h \
+    $$PWD/HeaderCommands.h \
+    $$PWD/HeaderIconCache.h \
+    $$PWD/HeaderInlineEditor.h \
+    $$PWD/HeaderProfiler.h \
+    $$PWD/HeaderPaintLayers.h \
+    $$PWD/HeaderSkinProvider.h \
+    $$PWD/HeaderTree.h \
+    $$PWD/LabelTable.h \
+    $$PWD/MultiLevelHeaderModel.h \
+    $$PWD/MultiLevelHeaderView.h \
+    $$PWD/PagedDataSource.h \
+    $$PWD/PagedTableModel.h \
+    $$PWD/RoleProfilingProxyModel.h \
+    $$PWD/SectionCounter.h \
+    $$PWD/SectionLayout.h \
+    $$PWD/StaticTextCache.h \
+    $$PWD/TextMetricsCache.h \
+    $$PWD/UpdateQueue.h \
+    $$PWD/data_model.h
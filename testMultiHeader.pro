@@ -17,17 +17,14 @@ DESTDIR = $$PWD/"./bin"
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(tableview.pri)
+
 SOURCES += \
-    EwsTableView.cpp \
     main.cpp \
-    MainWindow.cpp \
-    MultiLevelHeaderView.cpp
+    MainWindow.cpp
 
 HEADERS += \
-    EwsTableView.h \
-    MainWindow.h \
-    MultiLevelHeaderView.h \
-    data_model.h
+    MainWindow.h
 
 FORMS += \
     MainWindow.ui